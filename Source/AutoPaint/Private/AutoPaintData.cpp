@@ -19,4 +19,26 @@ void UAutoPaintData::AssignStaticMesh(const FAssetData& InStaticMeshAssetData)
 {
 	ReferencedStaticMesh = Cast<UStaticMesh>(InStaticMeshAssetData.GetAsset());
 	MarkPackageDirty();
-}
\ No newline at end of file
+}
+
+TArray<FName> UAutoPaintData::GetSectionLayerNames() const
+{
+	TArray<FName> LayerNames;
+	for (const FAutoPaintSectionLayer& SectionLayer : SectionLayers)
+	{
+		if (!SectionLayer.LayerName.IsNone() && LayerNames.Num() < MaxSectionLayers)
+		{
+			LayerNames.AddUnique(SectionLayer.LayerName);
+		}
+	}
+	return LayerNames;
+}
+
+int32 UAutoPaintData::GetSectionMaskChannel(FName InLayerName) const
+{
+	if (!SectionMaskTexture || InLayerName.IsNone() || HasTextureTiles())
+	{
+		return INDEX_NONE;
+	}
+	return SectionMaskLayers.IndexOfByKey(InLayerName);
+}
@@ -8,6 +8,30 @@
 
 class UStaticMesh;
 
+UENUM()
+enum class EAutoPaintCaptureFilter : uint8
+{
+	/** Equal weights over one texel */
+	Box,
+	/** Linear falloff over two texels, smoother edges */
+	Tent
+};
+
+/** Paints a landscape layer where a material slot of the captured mesh is the top surface */
+USTRUCT()
+struct FAutoPaintSectionLayer
+{
+	GENERATED_BODY()
+
+	/** Material slot of the referenced static mesh, every LOD0 section using it is captured */
+	UPROPERTY(EditAnywhere, Category = Default)
+	FName MaterialSlotName;
+
+	/** Several slots may paint the same layer, they share its mask */
+	UPROPERTY(EditAnywhere, Category = Default)
+	FName LayerName;
+};
+
 UCLASS()
 class AUTOPAINT_API UAutoPaintData : public UObject
 {
@@ -15,6 +39,9 @@ class AUTOPAINT_API UAutoPaintData : public UObject
 
 public:
 	static constexpr const TCHAR* PrimaryAssetType = TEXT("AutoPaintData");
+
+	/** Channels of Section Mask Texture */
+	static constexpr int32 MaxSectionLayers = 4;
 	
 	//~ Begin UObject Interface
 	virtual bool IsEditorOnly() const override
@@ -37,6 +64,37 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = Default)
 	TObjectPtr<UTexture> TextureAsset = nullptr;
 
+	/** Tiled capture result, row major. Every tile is a texture in its own package so it can be loaded on demand. */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	TArray<TSoftObjectPtr<UTexture>> TextureTiles;
+
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	FIntPoint TextureTileCount = FIntPoint::ZeroValue;
+
+	/** Texels per tile side at capture time, last row and column may be smaller. */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	int32 TextureTileSize = 0;
+
+	/** Texture Asset stores the signed distance to the edge of the captured mask in G, see FAutoPaintDistanceField */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	bool bTextureHasDistanceField = false;
+
+	/** Texture Asset stores the slope in B and curvature in A, see FAutoPaintSurfaceDerivatives */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	bool bTextureHasDerivatives = false;
+
+	/** Coverage of every section layer in its own channel, same size and UV mapping as Texture Asset */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	TObjectPtr<UTexture> SectionMaskTexture = nullptr;
+
+	/** Layer names in Section Mask Texture channel order (R, G, B, A) at capture time */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	TArray<FName> SectionMaskLayers;
+
+	/** Patch UV rect of the texels covered by the captured mesh */
+	UPROPERTY(VisibleAnywhere, Category = Default)
+	FBox2D MaskUVBounds = FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector);
+
 	// Size in cm for Texture/Preview
 	UPROPERTY(EditAnywhere, Category = Default)
 	FVector2D TextureWorldSize = FVector2D(300.0);
@@ -47,12 +105,48 @@ public:
 	UPROPERTY(EditAnywhere, Category = Capture)
 	FIntPoint SceneCaptureResolution = FIntPoint(32, 32);
 
+	/**
+	 * Sub-pixel jittered captures accumulated per texel. Anti-aliases silhouettes without raising Scene Capture Resolution.
+	 * Only used by the mesh depth pass.
+	 */
+	UPROPERTY(EditAnywhere, Category = Capture, meta = (ClampMin = "1", ClampMax = "64"))
+	int32 CaptureSamples = 1;
+
+	UPROPERTY(EditAnywhere, Category = Capture, meta = (EditCondition = "CaptureSamples > 1"))
+	EAutoPaintCaptureFilter CaptureFilter = EAutoPaintCaptureFilter::Tent;
+
+	/**
+	 * Weightmap layers captured from mesh material slots in the same pass as the heights, one mask channel per distinct
+	 * layer, at most MaxSectionLayers. Needs the mesh depth pass, tiled captures don't capture masks.
+	 */
+	UPROPERTY(EditAnywhere, Category = Capture, meta = (TitleProperty = "LayerName"))
+	TArray<FAutoPaintSectionLayer> SectionLayers;
+
+	/**
+	 * Captures Scene Capture Resolution in tiles of this size (in texels) and streams them to disk one by one,
+	 * so render targets never exceed a tile. 0 captures everything at once into Texture Asset.
+	 */
+	UPROPERTY(EditAnywhere, Category = Capture, meta = (ClampMin = "0", UIMax = "4096"))
+	int32 CaptureTileSize = 0;
+
+	/** Extra texels captured around every tile so post process blur doesn't see tile edges. Should cover the blur radius. */
+	UPROPERTY(EditAnywhere, Category = Capture, meta = (EditCondition = "CaptureTileSize > 0", ClampMin = "0", UIMax = "64"))
+	int32 CaptureTileOverlap = 8;
+
 	/**
 	 * Distance (in unscaled world coordinates) across which to smoothly fall off the patch effects.
 	 */
 	UPROPERTY(EditAnywhere, Category = Render, meta = (ClampMin = "0", UIMax = "2000"))
 	float Falloff = 100;
 
+	/**
+	 * Falloff follows the outline of the captured mesh instead of the circle inscribed in the patch, and the landscape
+	 * is only touched inside the outline. Needs a capture saved with a distance field, tiled captures always use the circle.
+	 * The shape falloff is at most a quarter of the longer patch side, the range of the distance field.
+	 */
+	UPROPERTY(EditAnywhere, Category = Render)
+	bool bShapeFalloff = true;
+
 	// In cm
 	UPROPERTY(EditAnywhere, Category = Render)
 	float HeightWPO = 50.f;
@@ -77,4 +171,18 @@ public:
 	float CameraOrthoWidth = 100.f;
 
 	void AssignStaticMesh(const FAssetData& InStaticMeshAssetData);
+
+	bool IsTiledCapture() const { return CaptureTileSize > 0; }
+	bool HasTextureTiles() const { return TextureTileSize > 0 && TextureTileCount.X > 0 && TextureTileCount.Y > 0 && TextureTiles.Num() == TextureTileCount.X * TextureTileCount.Y; }
+	void ClearTextureTiles() { TextureTiles.Empty(); TextureTileCount = FIntPoint::ZeroValue; TextureTileSize = 0; }
+
+	/** Distinct layer names of Section Layers in mask channel order */
+	TArray<FName> GetSectionLayerNames() const;
+	/** Section Mask Texture channel painting InLayerName, INDEX_NONE if the saved capture has no mask for it */
+	int32 GetSectionMaskChannel(FName InLayerName) const;
+	void ClearSectionMask() { SectionMaskTexture = nullptr; SectionMaskLayers.Empty(); }
+
+	bool UsesShapeFalloff() const { return bShapeFalloff && bTextureHasDistanceField && !HasTextureTiles(); }
+	/** Patch UV rect the patch can affect */
+	FBox2D GetFalloffUVBounds() const { return UsesShapeFalloff() ? MaskUVBounds : FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector); }
 };
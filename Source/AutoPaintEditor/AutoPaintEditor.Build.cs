@@ -25,7 +25,13 @@ public class AutoPaintEditor : ModuleRules
                 "UnrealEd",
                 "AdvancedPreviewScene",
                 "RHI",
-                "RenderCore"
+                "RenderCore",
+                "AssetRegistry",
+                "Json",
+                "ImageCore",
+                "MeshDescription",
+                "StaticMeshDescription",
+                "AutoPaintShaders"
             }
         );
     }
@@ -0,0 +1,297 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintCaptureCommandlet.h"
+
+#include "AutoPaintCaptureSettings.h"
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintData.h"
+#include "AutoPaintMeshRasterizer.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "Serialization/JsonWriter.h"
+
+UAutoPaintCaptureCommandlet::UAutoPaintCaptureCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UAutoPaintCaptureCommandlet::Main(const FString& Params)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	int32 ShardIndex = 0;
+	int32 ShardCount = 1;
+	if (!ParseShard(Params, ShardIndex, ShardCount))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Invalid -Shard argument, expected -Shard=i/N with 0 <= i < N"));
+		return 1;
+	}
+
+	FString ReportPath;
+	if (!FParse::Value(*Params, TEXT("Report="), ReportPath))
+	{
+		ReportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AutoPaint"), FString::Printf(TEXT("CaptureReport_%dof%d.json"), ShardIndex, ShardCount));
+	}
+
+	FString Filter;
+	FParse::Value(*Params, TEXT("Filter="), Filter);
+
+	// Enumerate assets
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(/*bSynchronousSearch = */true);
+
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAssetsByClass(UAutoPaintData::StaticClass()->GetClassPathName(), Assets, /*bSearchSubClasses = */true);
+
+	if (!Filter.IsEmpty())
+	{
+		Assets.RemoveAll([&Filter](const FAssetData& Asset)
+		{
+			return !Asset.PackageName.ToString().StartsWith(Filter);
+		});
+	}
+
+	// Deterministic slice: same sorted list in every process, round robin keeps slices balanced
+	Assets.Sort([](const FAssetData& A, const FAssetData& B)
+	{
+		return A.GetSoftObjectPath().ToString() < B.GetSoftObjectPath().ToString();
+	});
+
+	TArray<FAssetData> ShardAssets;
+	for (int32 Index = ShardIndex; Index < Assets.Num(); Index += ShardCount)
+	{
+		ShardAssets.Add(Assets[Index]);
+	}
+
+	// No RHI: fall back to CPU rasterization
+	const bool bUseCPU = !FApp::CanEverRender();
+
+	UE_LOG(LogAutoPaintCapture, Display, TEXT("Shard %d/%d: %d of %d AutoPaintData assets, %s capture"),
+		ShardIndex, ShardCount, ShardAssets.Num(), Assets.Num(), bUseCPU ? TEXT("CPU") : TEXT("GPU"));
+
+	TArray<FAssetResult> Results;
+	Results.Reserve(ShardAssets.Num());
+
+	int32 NumFailed = 0;
+	for (const FAssetData& Asset : ShardAssets)
+	{
+		FAssetResult& Result = Results.AddDefaulted_GetRef();
+		Result.AssetPath = Asset.GetSoftObjectPath().ToString();
+
+		const double LoadStart = FPlatformTime::Seconds();
+		UAutoPaintData* Data = Cast<UAutoPaintData>(Asset.GetAsset());
+		Result.LoadSeconds = FPlatformTime::Seconds() - LoadStart;
+
+		if (!Data)
+		{
+			Result.Error = TEXT("Failed to load asset");
+		}
+		else
+		{
+			ProcessAsset(Data, bUseCPU, Result);
+		}
+
+		if (!Result.bSuccess)
+		{
+			++NumFailed;
+			UE_LOG(LogAutoPaintCapture, Warning, TEXT("%s: %s"), *Result.AssetPath, *Result.Error);
+		}
+		else
+		{
+			UE_LOG(LogAutoPaintCapture, Display, TEXT("%s: capture %.1f ms, save %.1f ms"), *Result.AssetPath, Result.CaptureSeconds * 1000.0, Result.SaveSeconds * 1000.0);
+		}
+
+		// Keep memory flat over big projects
+		CollectGarbage(RF_NoFlags);
+	}
+
+	FAutoPaintCaptureService::Shutdown();
+
+	const double TotalSeconds = FPlatformTime::Seconds() - StartTime;
+	if (!WriteReport(ReportPath, ShardIndex, ShardCount, bUseCPU, TotalSeconds, Results))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Failed to write report to %s"), *ReportPath);
+		return 1;
+	}
+
+	UE_LOG(LogAutoPaintCapture, Display, TEXT("Done in %.2f s, %d failed. Report: %s"), TotalSeconds, NumFailed, *ReportPath);
+	return NumFailed > 0 ? 1 : 0;
+}
+
+bool UAutoPaintCaptureCommandlet::ParseShard(const FString& Params, int32& OutShardIndex, int32& OutShardCount)
+{
+	OutShardIndex = 0;
+	OutShardCount = 1;
+
+	FString ShardValue;
+	if (!FParse::Value(*Params, TEXT("Shard="), ShardValue))
+	{
+		return true;
+	}
+
+	FString IndexString, CountString;
+	if (!ShardValue.Split(TEXT("/"), &IndexString, &CountString))
+	{
+		return false;
+	}
+
+	if (!IndexString.IsNumeric() || !CountString.IsNumeric())
+	{
+		return false;
+	}
+
+	OutShardIndex = FCString::Atoi(*IndexString);
+	OutShardCount = FCString::Atoi(*CountString);
+	return OutShardCount > 0 && OutShardIndex >= 0 && OutShardIndex < OutShardCount;
+}
+
+bool UAutoPaintCaptureCommandlet::ProcessAsset(UAutoPaintData* InData, bool bInUseCPU, FAssetResult& OutResult) const
+{
+	if (InData->ReferencedStaticMesh.IsNull())
+	{
+		OutResult.Error = TEXT("No ReferencedStaticMesh");
+		return false;
+	}
+
+	const double CaptureStart = FPlatformTime::Seconds();
+	if (!bInUseCPU && InData->IsTiledCapture())
+	{
+		// Tiles are saved while capturing, capture time includes their saves
+		FAutoPaintTileCaptureStats TileStats;
+		if (!FAutoPaintCaptureService::Get().CaptureTiles(InData, TileStats))
+		{
+			OutResult.Error = TEXT("Tiled capture failed");
+			return false;
+		}
+		OutResult.CaptureSeconds = FPlatformTime::Seconds() - CaptureStart;
+		OutResult.NumTiles = TileStats.TileUsedPhysical.Num();
+		OutResult.TileWorkingBytes = TileStats.TileWorkingBytes;
+		for (const uint64 UsedPhysical : TileStats.TileUsedPhysical)
+		{
+			OutResult.PeakTileUsedPhysical = FMath::Max(OutResult.PeakTileUsedPhysical, UsedPhysical);
+		}
+
+		const double SaveStart = FPlatformTime::Seconds();
+		if (!SaveAssetPackage(InData))
+		{
+			OutResult.Error = TEXT("Failed to save package");
+			return false;
+		}
+		OutResult.SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+	}
+	else if (!bInUseCPU)
+	{
+		FAutoPaintCaptureService& CaptureService = FAutoPaintCaptureService::Get();
+
+		UTextureRenderTarget2D* FinalRT = CaptureService.CaptureNow(InData);
+		if (!FinalRT)
+		{
+			OutResult.Error = TEXT("Capture failed");
+			return false;
+		}
+
+		// Capture and draws are queued on render thread, wait to get honest timings
+		FlushRenderingCommands();
+		OutResult.CaptureSeconds = FPlatformTime::Seconds() - CaptureStart;
+
+		const double SaveStart = FPlatformTime::Seconds();
+		const UTexture* Texture = CaptureService.SaveTexture(InData, FinalRT);
+		CaptureService.ReleaseTarget(FinalRT);
+		if (!Texture)
+		{
+			OutResult.Error = TEXT("Failed to create texture from Final RT");
+			return false;
+		}
+		if (!SaveAssetPackage(InData))
+		{
+			OutResult.Error = TEXT("Failed to save package");
+			return false;
+		}
+		OutResult.SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+	}
+	else
+	{
+		TArray<FColor> Pixels;
+		TArray<FColor> SectionMask;
+		if (!FAutoPaintMeshRasterizer::Rasterize(*InData, Pixels, &SectionMask))
+		{
+			OutResult.Error = TEXT("CPU rasterization failed (missing mesh description?)");
+			return false;
+		}
+		OutResult.CaptureSeconds = FPlatformTime::Seconds() - CaptureStart;
+
+		const double SaveStart = FPlatformTime::Seconds();
+		if (!FAutoPaintCaptureService::SaveTexturePixels(InData, InData->SceneCaptureResolution, Pixels))
+		{
+			OutResult.Error = TEXT("Failed to create texture from CPU heights");
+			return false;
+		}
+		FAutoPaintCaptureService::SaveSectionMaskPixels(InData, InData->SceneCaptureResolution, SectionMask, InData->GetSectionLayerNames());
+		if (!SaveAssetPackage(InData))
+		{
+			OutResult.Error = TEXT("Failed to save package");
+			return false;
+		}
+		OutResult.SaveSeconds = FPlatformTime::Seconds() - SaveStart;
+	}
+
+	OutResult.bSuccess = true;
+	return true;
+}
+
+bool UAutoPaintCaptureCommandlet::SaveAssetPackage(UAutoPaintData* InData)
+{
+	return FAutoPaintCaptureService::SavePackage(InData->GetPackage());
+}
+
+bool UAutoPaintCaptureCommandlet::WriteReport(const FString& InPath, int32 InShardIndex, int32 InShardCount, bool bInUsedCPU, double InTotalSeconds, const TArray<FAssetResult>& InResults)
+{
+	TSharedRef<FJsonObject> Root = MakeShared<FJsonObject>();
+	Root->SetNumberField(TEXT("ShardIndex"), InShardIndex);
+	Root->SetNumberField(TEXT("ShardCount"), InShardCount);
+	Root->SetStringField(TEXT("Mode"), bInUsedCPU ? TEXT("CPU") : TEXT("GPU"));
+	Root->SetNumberField(TEXT("TotalSeconds"), InTotalSeconds);
+
+	TArray<TSharedPtr<FJsonValue>> Assets;
+	TArray<TSharedPtr<FJsonValue>> Failures;
+	for (const FAssetResult& Result : InResults)
+	{
+		TSharedRef<FJsonObject> Entry = MakeShared<FJsonObject>();
+		Entry->SetStringField(TEXT("Asset"), Result.AssetPath);
+		Entry->SetBoolField(TEXT("Success"), Result.bSuccess);
+		Entry->SetNumberField(TEXT("LoadMs"), Result.LoadSeconds * 1000.0);
+		Entry->SetNumberField(TEXT("CaptureMs"), Result.CaptureSeconds * 1000.0);
+		Entry->SetNumberField(TEXT("SaveMs"), Result.SaveSeconds * 1000.0);
+		if (Result.NumTiles > 0)
+		{
+			Entry->SetNumberField(TEXT("Tiles"), Result.NumTiles);
+			Entry->SetNumberField(TEXT("TileWorkingMiB"), Result.TileWorkingBytes / (1024.0 * 1024.0));
+			Entry->SetNumberField(TEXT("PeakTileUsedPhysicalMiB"), Result.PeakTileUsedPhysical / (1024.0 * 1024.0));
+		}
+		if (!Result.bSuccess)
+		{
+			Entry->SetStringField(TEXT("Error"), Result.Error);
+			Failures.Add(MakeShared<FJsonValueObject>(Entry));
+		}
+		Assets.Add(MakeShared<FJsonValueObject>(Entry));
+	}
+	Root->SetArrayField(TEXT("Assets"), Assets);
+	Root->SetArrayField(TEXT("Failures"), Failures);
+
+	FString Output;
+	const TSharedRef<TJsonWriter<>> Writer = TJsonWriterFactory<>::Create(&Output);
+	if (!FJsonSerializer::Serialize(Root, Writer))
+	{
+		return false;
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(InPath), /*Tree = */true);
+	return FFileHelper::SaveStringToFile(Output, *InPath);
+}
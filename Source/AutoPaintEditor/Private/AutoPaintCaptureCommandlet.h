@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AutoPaintCaptureCommandlet.generated.h"
+
+class UAutoPaintData;
+
+/**
+ * Recaptures and saves every AutoPaintData asset in the project.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd.exe <Project> -run=AutoPaintCapture [-Shard=i/N] [-Report=<Path.json>] [-Filter=/Game/Path] [-AllowCommandletRendering]
+ *
+ * -Shard=i/N  Process only i-th of N deterministic slices (assets sorted by path, round robin),
+ *             so N processes can run side by side on one machine.
+ * -Report     Output JSON with per asset timings and failures. Defaults to Saved/AutoPaint/CaptureReport_<i>of<N>.json
+ * -Filter     Only assets under this package path.
+ *
+ * Without an RHI (-nullrhi) patches are generated on CPU from the mesh description, see FAutoPaintMeshRasterizer.
+ */
+UCLASS()
+class UAutoPaintCaptureCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAutoPaintCaptureCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+private:
+	struct FAssetResult
+	{
+		FString AssetPath;
+		bool bSuccess = false;
+		FString Error;
+		double LoadSeconds = 0.0;
+		double CaptureSeconds = 0.0;
+		double SaveSeconds = 0.0;
+		int32 NumTiles = 0;
+		int64 TileWorkingBytes = 0;
+		uint64 PeakTileUsedPhysical = 0;
+	};
+
+	static bool ParseShard(const FString& Params, int32& OutShardIndex, int32& OutShardCount);
+
+	bool ProcessAsset(UAutoPaintData* InData, bool bInUseCPU, FAssetResult& OutResult) const;
+	static bool SaveAssetPackage(UAutoPaintData* InData);
+
+	static bool WriteReport(const FString& InPath, int32 InShardIndex, int32 InShardCount, bool bInUsedCPU, double InTotalSeconds, const TArray<FAssetResult>& InResults);
+};
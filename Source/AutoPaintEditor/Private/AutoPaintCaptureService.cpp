@@ -0,0 +1,474 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintCaptureService.h"
+
+#include "AutoPaintCaptureSettings.h"
+#include "AutoPaintData.h"
+#include "AutoPaintDistanceField.h"
+#include "AutoPaintStats.h"
+#include "AutoPaintSurfaceDerivatives.h"
+#include "TextureResource.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Kismet/KismetRenderingLibrary.h"
+#include "Misc/PackageName.h"
+#include "Misc/ScopedSlowTask.h"
+#include "UObject/SavePackage.h"
+#include "UObject/StrongObjectPtr.h"
+
+#define LOCTEXT_NAMESPACE "AutoPaintEditor"
+
+DEFINE_LOG_CATEGORY(LogAutoPaintCapture);
+
+DECLARE_CYCLE_STAT(TEXT("Save Texture"), STAT_AutoPaint_SaveTexture, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Save Package"), STAT_AutoPaint_SavePackage, STATGROUP_AutoPaint);
+
+TUniquePtr<FAutoPaintCaptureService> FAutoPaintCaptureService::Instance;
+
+const TCHAR* FAutoPaintCaptureService::TextureAssetName = TEXT("T_AP_TextureAsset");
+const TCHAR* FAutoPaintCaptureService::SectionMaskAssetName = TEXT("T_AP_SectionMask");
+
+FAutoPaintCaptureService& FAutoPaintCaptureService::Get()
+{
+	if (!Instance)
+	{
+		Instance = MakeUnique<FAutoPaintCaptureService>();
+	}
+	return *Instance;
+}
+
+void FAutoPaintCaptureService::Shutdown()
+{
+	Instance.Reset();
+}
+
+void FAutoPaintCaptureService::GatherMemory(TArray<FAutoPaintMemoryEntry>& OutEntries)
+{
+	if (!Instance)
+	{
+		return;
+	}
+
+	// Settings live in the capturer, which isn't created just to be measured
+	if (const UAutoPaintCaptureSettings* Settings = Instance->Capturer ? Instance->Capturer->GetSettings() : nullptr)
+	{
+		OutEntries.Add({ TEXT("Capture"), TEXT("Scene Capture RT"), AutoPaintMemory::GetTextureBytes(Settings->SceneCaptureRT) });
+		OutEntries.Add({ TEXT("Capture"), TEXT("Normalize RT"), AutoPaintMemory::GetTextureBytes(Settings->NormalizeRT) });
+		OutEntries.Add({ TEXT("Capture"), TEXT("Section Mask RT"), AutoPaintMemory::GetTextureBytes(Settings->SectionMaskRT) });
+	}
+
+	int64 FreeBytes = 0;
+	for (const UTextureRenderTarget2D* Target : Instance->FreeTargets)
+	{
+		FreeBytes += AutoPaintMemory::GetTextureBytes(Target);
+	}
+	OutEntries.Add({ TEXT("Capture"), FString::Printf(TEXT("Free Final RTs (%d)"), Instance->FreeTargets.Num()), FreeBytes });
+}
+
+FAutoPaintCaptureService::~FAutoPaintCaptureService() = default;
+
+void FAutoPaintCaptureService::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObjects(FreeTargets);
+}
+
+TStatId FAutoPaintCaptureService::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FAutoPaintCaptureService, STATGROUP_Tickables);
+}
+
+FAutoPaintCapturer& FAutoPaintCaptureService::GetCapturer()
+{
+	if (!Capturer)
+	{
+		Capturer = MakeUnique<FAutoPaintCapturer>();
+	}
+	return *Capturer;
+}
+
+UAutoPaintCaptureSettings* FAutoPaintCaptureService::GetSettings() const
+{
+	return const_cast<FAutoPaintCaptureService*>(this)->GetCapturer().GetSettings();
+}
+
+UWorld* FAutoPaintCaptureService::GetWorld() const
+{
+	return const_cast<FAutoPaintCaptureService*>(this)->GetCapturer().GetWorld();
+}
+
+void FAutoPaintCaptureService::Tick(float DeltaTime)
+{
+	const double CurrentTime = FPlatformTime::Seconds();
+
+	// One capture per tick: editors never stall each other for more than a single capture
+	for (int32 Index = 0; Index < PendingRequests.Num(); ++Index)
+	{
+		if (PendingRequests[Index].ExecuteTime > CurrentTime)
+		{
+			// Still debouncing
+			continue;
+		}
+
+		FRequest Request = PendingRequests[Index];
+		PendingRequests.RemoveAt(Index);
+
+		UAutoPaintData* Data = Request.Data.Get();
+		if (!Data || !Request.OnComplete.IsBound())
+		{
+			// Editor was closed, nothing to do
+			--Index;
+			continue;
+		}
+
+		UTextureRenderTarget2D* FinalRT = CaptureNow(Data, Request.Stages);
+		if (!Request.OnComplete.ExecuteIfBound(FinalRT) && FinalRT)
+		{
+			ReleaseTarget(FinalRT);
+		}
+		break;
+	}
+}
+
+void FAutoPaintCaptureService::RequestCapture(UAutoPaintData* InData, FOnAutoPaintCaptureComplete InOnComplete, EAutoPaintCaptureStages InStages, float InDelay)
+{
+	if (!InData)
+	{
+		return;
+	}
+
+	const double ExecuteTime = FPlatformTime::Seconds() + InDelay;
+
+	for (FRequest& Request : PendingRequests)
+	{
+		if (Request.Data.Get() == InData)
+		{
+			Request.OnComplete = MoveTemp(InOnComplete);
+			Request.Stages |= InStages;
+			Request.ExecuteTime = ExecuteTime;
+			return;
+		}
+	}
+
+	PendingRequests.Add({ InData, MoveTemp(InOnComplete), InStages, ExecuteTime });
+}
+
+UTextureRenderTarget2D* FAutoPaintCaptureService::CaptureNow(UAutoPaintData* InData, EAutoPaintCaptureStages InStages)
+{
+	if (!InData)
+	{
+		return nullptr;
+	}
+
+	UTextureRenderTarget2D* FinalRT = AcquireTarget(InData->SceneCaptureResolution);
+	if (!FinalRT)
+	{
+		return nullptr;
+	}
+
+	if (!GetCapturer().Capture(InData, FinalRT, InStages))
+	{
+		ReleaseTarget(FinalRT);
+		return nullptr;
+	}
+
+	return FinalRT;
+}
+
+UTextureRenderTarget2D* FAutoPaintCaptureService::AcquireTarget(const FIntPoint& InSize)
+{
+	const ETextureRenderTargetFormat Format = GetSettings()->FRenderTargetFormat;
+	const EPixelFormat PixelFormat = GetPixelFormatFromRenderTargetFormat(Format);
+
+	const int32 FreeIndex = FreeTargets.IndexOfByPredicate([&InSize, PixelFormat](const UTextureRenderTarget2D* Target)
+	{
+		return IsValid(Target) && Target->SizeX == InSize.X && Target->SizeY == InSize.Y && Target->GetFormat() == PixelFormat;
+	});
+
+	if (FreeIndex != INDEX_NONE)
+	{
+		UTextureRenderTarget2D* Target = FreeTargets[FreeIndex];
+		FreeTargets.RemoveAtSwap(FreeIndex);
+		return Target;
+	}
+
+	return UAutoPaintCaptureSettings::GetOrCreateTransientRenderTarget2D(nullptr, TEXT("Final RT"), InSize, Format);
+}
+
+void FAutoPaintCaptureService::ReleaseTarget(UTextureRenderTarget2D* InTarget)
+{
+	if (!IsValid(InTarget))
+	{
+		return;
+	}
+
+	if (UAutoPaintCaptureSettings* Settings = GetSettings(); Settings && Settings->FinalRT == InTarget)
+	{
+		Settings->FinalRT = nullptr;
+	}
+
+	// Oldest free target goes to GC
+	if (FreeTargets.Num() >= MaxFreeTargets)
+	{
+		FreeTargets.RemoveAt(0);
+	}
+	FreeTargets.AddUnique(InTarget);
+}
+
+void FAutoPaintCaptureService::ClearTarget(UTextureRenderTarget2D* InTarget) const
+{
+	if (InTarget)
+	{
+		UKismetRenderingLibrary::ClearRenderTarget2D(GetWorld(), InTarget, FLinearColor::Black);
+	}
+}
+
+UTexture* FAutoPaintCaptureService::SaveTexture(UAutoPaintData* InData, UTextureRenderTarget2D* InFinalRT)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_SaveTexture);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, SaveTexture);
+
+	if (!InData || !InFinalRT)
+	{
+		return nullptr;
+	}
+
+	SaveSectionMask(InData);
+
+	// The distance field and derivatives need the pixels on the CPU, and only fit next to heights of an 8 bit Final RT
+	const EPixelFormat Format = InFinalRT->GetFormat();
+	if (Format == PF_B8G8R8A8 || Format == PF_R8G8B8A8)
+	{
+		TArray<FColor> Pixels;
+		FTextureRenderTargetResource* Resource = InFinalRT->GameThread_GetRenderTargetResource();
+		if (Resource && Resource->ReadPixels(Pixels, FReadSurfaceDataFlags(RCM_UNorm)))
+		{
+			return SaveTexturePixels(InData, FIntPoint(InFinalRT->SizeX, InFinalRT->SizeY), Pixels);
+		}
+	}
+
+	InData->TextureAsset = GetSettings()->RenderTargetCreateStaticTextureEditorOnly(InFinalRT, TextureAssetName, InData);
+	if (InData->TextureAsset)
+	{
+		InData->bTextureHasDistanceField = false;
+		InData->bTextureHasDerivatives = false;
+		// Tiles of an earlier tiled capture would take precedence at apply time
+		InData->ClearTextureTiles();
+	}
+	return InData->TextureAsset;
+}
+
+UTexture* FAutoPaintCaptureService::SaveTexturePixels(UAutoPaintData* InData, const FIntPoint& InSize, TArray<FColor>& InOutPixels)
+{
+	if (!InData)
+	{
+		return nullptr;
+	}
+
+	FBox2D MaskUVBounds;
+	const bool bHasDistanceField = FAutoPaintDistanceField::Encode(InSize, InData->TextureWorldSize, InOutPixels, MaskUVBounds);
+	const bool bHasDerivatives = FAutoPaintSurfaceDerivatives::Encode(InSize, InData->TextureWorldSize, InOutPixels);
+
+	InData->TextureAsset = UAutoPaintCaptureSettings::CreateStaticTextureEditorOnly(InSize, InOutPixels, TextureAssetName, InData);
+	if (InData->TextureAsset)
+	{
+		InData->bTextureHasDistanceField = bHasDistanceField;
+		InData->bTextureHasDerivatives = bHasDerivatives;
+		InData->MaskUVBounds = bHasDistanceField ? MaskUVBounds : FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector);
+		InData->ClearTextureTiles();
+	}
+	return InData->TextureAsset;
+}
+
+UTexture* FAutoPaintCaptureService::SaveSectionMaskPixels(UAutoPaintData* InData, const FIntPoint& InSize, TConstArrayView<FColor> InPixels, const TArray<FName>& InLayerNames)
+{
+	if (!InData)
+	{
+		return nullptr;
+	}
+
+	InData->ClearSectionMask();
+	if (InLayerNames.IsEmpty())
+	{
+		return nullptr;
+	}
+
+	InData->SectionMaskTexture = UAutoPaintCaptureSettings::CreateStaticTextureEditorOnly(InSize, InPixels, SectionMaskAssetName, InData);
+	if (InData->SectionMaskTexture)
+	{
+		InData->SectionMaskLayers = InLayerNames;
+	}
+	return InData->SectionMaskTexture;
+}
+
+void FAutoPaintCaptureService::SaveSectionMask(UAutoPaintData* InData)
+{
+	if (InData->GetSectionLayerNames().IsEmpty())
+	{
+		InData->ClearSectionMask();
+		return;
+	}
+
+	// Section Mask RT is shared, it is gone when another asset was captured since the Final RT being saved. Capturing
+	// again here could save masks that don't match those heights, the asset has to be captured again instead.
+	TArray<FName> LayerNames;
+	UTextureRenderTarget2D* SectionMaskRT = GetCapturer().GetSectionMask(InData, LayerNames);
+	TArray<FLinearColor> Coverage;
+	FTextureRenderTargetResource* Resource = SectionMaskRT ? SectionMaskRT->GameThread_GetRenderTargetResource() : nullptr;
+	if (!Resource || !Resource->ReadLinearColorPixels(Coverage))
+	{
+		UE_LOG(LogAutoPaintCapture, Warning, TEXT("%s: section layers need the mesh depth pass and a capture right before saving, masks weren't saved"), *InData->GetName());
+		InData->ClearSectionMask();
+		return;
+	}
+
+	// Coverage is linear, channels stay in layer order
+	TArray<FColor> Pixels;
+	Pixels.SetNumUninitialized(Coverage.Num());
+	for (int32 Index = 0; Index < Coverage.Num(); ++Index)
+	{
+		Pixels[Index] = Coverage[Index].QuantizeRound();
+	}
+
+	SaveSectionMaskPixels(InData, FIntPoint(SectionMaskRT->SizeX, SectionMaskRT->SizeY), Pixels, LayerNames);
+}
+
+bool FAutoPaintCaptureService::CaptureTiles(UAutoPaintData* InData, FAutoPaintTileCaptureStats& OutStats)
+{
+	if (!InData || !InData->IsTiledCapture())
+	{
+		return false;
+	}
+
+	// Asset may be referenced only from caller stack, GC runs between batches of tiles
+	TStrongObjectPtr<UAutoPaintData> DataGuard(InData);
+
+	const FIntPoint FullResolution = InData->SceneCaptureResolution;
+	const int32 TileSize = InData->CaptureTileSize;
+	const int32 Overlap = InData->CaptureTileOverlap;
+
+	OutStats = FAutoPaintTileCaptureStats();
+	OutStats.TileCount = FIntPoint(FMath::DivideAndRoundUp(FullResolution.X, TileSize), FMath::DivideAndRoundUp(FullResolution.Y, TileSize));
+	OutStats.TileTargetSize = FIntPoint(TileSize + Overlap * 2);
+
+	{
+		const UAutoPaintCaptureSettings* Settings = GetSettings();
+		const int64 NumPixels = static_cast<int64>(OutStats.TileTargetSize.X) * OutStats.TileTargetSize.Y;
+		for (const ETextureRenderTargetFormat Format : { Settings->SCRenderTargetFormat.GetValue(), Settings->NRenderTargetFormat.GetValue(), Settings->FRenderTargetFormat.GetValue() })
+		{
+			OutStats.TileWorkingBytes += NumPixels * GPixelFormats[GetPixelFormatFromRenderTargetFormat(Format)].BlockBytes;
+		}
+		OutStats.TileWorkingBytes += static_cast<int64>(TileSize) * TileSize * sizeof(FColor);
+	}
+
+	const FString TilesPath = InData->GetPackage()->GetName() + TEXT("_Tiles");
+
+	const int32 NumTiles = OutStats.TileCount.X * OutStats.TileCount.Y;
+	TArray<TSoftObjectPtr<UTexture>> Tiles;
+	Tiles.Reserve(NumTiles);
+
+	FScopedSlowTask SlowTask(static_cast<float>(NumTiles), FText::Format(LOCTEXT("CaptureTiles", "Capturing {0} tiles of {1}"), NumTiles, FText::FromString(InData->GetName())));
+	SlowTask.MakeDialog(/*bShowCancelButton = */true);
+
+	for (int32 TileY = 0; TileY < OutStats.TileCount.Y; ++TileY)
+	{
+		for (int32 TileX = 0; TileX < OutStats.TileCount.X; ++TileX)
+		{
+			if (SlowTask.ShouldCancel())
+			{
+				// Tiles saved so far are left on disk, the asset keeps its previous texture or tiles
+				UE_LOG(LogAutoPaintCapture, Display, TEXT("%s: tiled capture cancelled after %d of %d tiles"), *InData->GetName(), Tiles.Num(), NumTiles);
+				return false;
+			}
+			SlowTask.EnterProgressFrame(1.f);
+
+			const FIntPoint TileMin(TileX * TileSize, TileY * TileSize);
+
+			FAutoPaintCaptureTile Tile;
+			Tile.FullResolution = FullResolution;
+			Tile.Rect = FIntRect(TileMin - Overlap, TileMin + TileSize + Overlap);
+
+			UTextureRenderTarget2D* FinalRT = AcquireTarget(OutStats.TileTargetSize);
+			if (!FinalRT)
+			{
+				return false;
+			}
+			if (!GetCapturer().Capture(InData, FinalRT, EAutoPaintCaptureStages::All, &Tile))
+			{
+				ReleaseTarget(FinalRT);
+				return false;
+			}
+
+			// Crop overlap, last row and column may be partial
+			const FIntPoint CropSize(FMath::Min(TileSize, FullResolution.X - TileMin.X), FMath::Min(TileSize, FullResolution.Y - TileMin.Y));
+
+			TArray<FColor> Pixels;
+			FTextureRenderTargetResource* Resource = FinalRT->GameThread_GetRenderTargetResource();
+			const bool bRead = Resource && Resource->ReadPixels(Pixels, FReadSurfaceDataFlags(RCM_UNorm), FIntRect(FIntPoint(Overlap), FIntPoint(Overlap) + CropSize));
+			ReleaseTarget(FinalRT);
+			if (!bRead)
+			{
+				return false;
+			}
+
+			const FString TileName = FString::Printf(TEXT("%s_%d_%d"), TextureAssetName, TileX, TileY);
+			UPackage* TilePackage = CreatePackage(*(TilesPath / TileName));
+			UTexture* TileTexture = UAutoPaintCaptureSettings::CreateStaticTextureEditorOnly(CropSize, Pixels, TileName, TilePackage);
+			if (!TileTexture)
+			{
+				return false;
+			}
+			FAssetRegistryModule::AssetCreated(TileTexture);
+
+			if (!SavePackage(TilePackage))
+			{
+				return false;
+			}
+			Tiles.Add(TileTexture);
+
+			// On disk now, dropped with the next collection
+			TileTexture->ClearFlags(RF_Standalone);
+			Pixels.Empty();
+			if (Tiles.Num() % TilesPerGarbageCollection == 0 || Tiles.Num() == NumTiles)
+			{
+				CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+			}
+
+			const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+			OutStats.TileUsedPhysical.Add(UsedPhysical);
+
+			UE_LOG(LogAutoPaintCapture, Log, TEXT("%s tile %d,%d: target %dx%d, working set %.2f MiB, process %.1f MiB"),
+				*InData->GetName(), TileX, TileY, OutStats.TileTargetSize.X, OutStats.TileTargetSize.Y,
+				OutStats.TileWorkingBytes / (1024.0 * 1024.0), UsedPhysical / (1024.0 * 1024.0));
+		}
+	}
+
+	InData->TextureTiles = MoveTemp(Tiles);
+	InData->TextureTileCount = OutStats.TileCount;
+	InData->TextureTileSize = TileSize;
+	// Stale single texture would not match the tiles
+	InData->TextureAsset = nullptr;
+	InData->bTextureHasDistanceField = false;
+	InData->bTextureHasDerivatives = false;
+	InData->ClearSectionMask();
+	InData->MarkPackageDirty();
+
+	return true;
+}
+
+bool FAutoPaintCaptureService::SavePackage(UPackage* InPackage)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_SavePackage);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, SavePackage);
+
+	InPackage->MarkPackageDirty();
+
+	const FString Filename = FPackageName::LongPackageNameToFilename(InPackage->GetName(), FPackageName::GetAssetPackageExtension());
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error = GError;
+	return UPackage::SavePackage(InPackage, nullptr, *Filename, SaveArgs);
+}
+
+#undef LOCTEXT_NAMESPACE
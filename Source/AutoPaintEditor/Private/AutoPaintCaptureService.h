@@ -0,0 +1,140 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintCapturer.h"
+#include "AutoPaintMemory.h"
+#include "TickableEditorObject.h"
+#include "UObject/GCObject.h"
+
+class UAutoPaintData;
+class UAutoPaintCaptureSettings;
+class UTexture;
+class UTextureRenderTarget2D;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogAutoPaintCapture, Log, All);
+
+/** Numbers of a tiled capture, see FAutoPaintCaptureService::CaptureTiles */
+struct FAutoPaintTileCaptureStats
+{
+	FIntPoint TileCount = FIntPoint::ZeroValue;
+	/** Render target size of one tile, including overlap */
+	FIntPoint TileTargetSize = FIntPoint::ZeroValue;
+	/** Scratch and Final RTs plus CPU readback alive while one tile is processed */
+	int64 TileWorkingBytes = 0;
+	/** Process used physical memory after every tile, row major */
+	TArray<uint64> TileUsedPhysical;
+};
+
+/** Called when queued capture is done. Receiver owns the Final RT lease and must give it back with ReleaseTarget. */
+DECLARE_DELEGATE_OneParam(FOnAutoPaintCaptureComplete, UTextureRenderTarget2D* /*FinalRT*/);
+
+/**
+ * Single capture world, scratch render targets and draw MIDs shared by every open AutoPaint editor.
+ * Created on first use. Capture requests are queued and executed one per tick, so editors only hold
+ * their view state and a leased Final RT from the target pool.
+ */
+class FAutoPaintCaptureService : public FGCObject, public FTickableEditorObject
+{
+public:
+	static FAutoPaintCaptureService& Get();
+	/** Doesn't create the service, for use from destructors */
+	static FAutoPaintCaptureService* TryGet() { return Instance.Get(); }
+	static void Shutdown();
+
+	/** Scratch and pooled Final RTs, see AutoPaintMemory::OnGather */
+	static void GatherMemory(TArray<FAutoPaintMemoryEntry>& OutEntries);
+
+	virtual ~FAutoPaintCaptureService() override;
+
+	//~ Begin FGCObject Interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FAutoPaintCaptureService"); }
+	//~ End FGCObject Interface
+
+	//~ Begin FTickableEditorObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return PendingRequests.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableEditorObject Interface
+
+	UAutoPaintCaptureSettings* GetSettings() const;
+	UWorld* GetWorld() const;
+
+	/**
+	 * Queues capture of the asset. A pending request for the same asset is replaced, its stages are merged
+	 * and its delay restarts, so a burst of edits results in a single capture.
+	 */
+	void RequestCapture(UAutoPaintData* InData, FOnAutoPaintCaptureComplete InOnComplete,
+		EAutoPaintCaptureStages InStages = EAutoPaintCaptureStages::All, float InDelay = 0.f);
+
+	/** Captures immediately (used where there is no editor tick, e.g. commandlets). Returns leased Final RT or nullptr. */
+	UTextureRenderTarget2D* CaptureNow(UAutoPaintData* InData, EAutoPaintCaptureStages InStages = EAutoPaintCaptureStages::All);
+
+	/** Gives leased Final RT back to the pool */
+	void ReleaseTarget(UTextureRenderTarget2D* InTarget);
+
+	void ClearTarget(UTextureRenderTarget2D* InTarget) const;
+
+	/**
+	 * Creates static texture from leased Final RT and assigns it to the asset, together with the section layer masks.
+	 * Recaptures the asset if the masks were overwritten by another asset's capture since InFinalRT was captured.
+	 */
+	UTexture* SaveTexture(UAutoPaintData* InData, UTextureRenderTarget2D* InFinalRT);
+
+	/**
+	 * Adds the mask distance field, slope and curvature to captured pixels (BGRA8), creates static texture from them
+	 * and assigns it to the asset.
+	 */
+	static UTexture* SaveTexturePixels(UAutoPaintData* InData, const FIntPoint& InSize, TArray<FColor>& InOutPixels);
+
+	/** Creates Section Mask Texture from coverage pixels (BGRA8, a layer per channel in InLayerNames order) and assigns it to the asset. */
+	static UTexture* SaveSectionMaskPixels(UAutoPaintData* InData, const FIntPoint& InSize, TConstArrayView<FColor> InPixels, const TArray<FName>& InLayerNames);
+
+	/**
+	 * Captures asset in CaptureTileSize sub-frusta. Every tile is post processed with overlap, cropped, saved to
+	 * its own package next to the asset and released, saved tiles are collected every TilesPerGarbageCollection tiles
+	 * so the full image is never in memory. Shows cancellable progress, a cancelled capture leaves the asset as it was.
+	 * Assigns TextureTiles, the asset package itself is left dirty.
+	 */
+	bool CaptureTiles(UAutoPaintData* InData, FAutoPaintTileCaptureStats& OutStats);
+
+	static bool SavePackage(UPackage* InPackage);
+
+	/** Name of the texture sub-object saved inside AutoPaintData package */
+	static const TCHAR* TextureAssetName;
+	/** Name of the section mask texture sub-object saved inside AutoPaintData package */
+	static const TCHAR* SectionMaskAssetName;
+
+private:
+	FAutoPaintCapturer& GetCapturer();
+
+	UTextureRenderTarget2D* AcquireTarget(const FIntPoint& InSize);
+
+	/** Reads Section Mask RT of the last capture of InData into Section Mask Texture, clears it when nothing was captured */
+	void SaveSectionMask(UAutoPaintData* InData);
+
+	struct FRequest
+	{
+		TWeakObjectPtr<UAutoPaintData> Data;
+		FOnAutoPaintCaptureComplete OnComplete;
+		EAutoPaintCaptureStages Stages = EAutoPaintCaptureStages::All;
+		/** FPlatformTime::Seconds() after which request can run */
+		double ExecuteTime = 0.0;
+	};
+	TArray<FRequest> PendingRequests;
+
+	/** Created on first capture */
+	TUniquePtr<FAutoPaintCapturer> Capturer;
+
+	/** Final RTs not leased by anyone. Bounded by MaxFreeTargets. */
+	TArray<TObjectPtr<UTextureRenderTarget2D>> FreeTargets;
+	static constexpr int32 MaxFreeTargets = 4;
+
+	/** Saved tiles are collected in batches, a collection per tile would dominate large captures */
+	static constexpr int32 TilesPerGarbageCollection = 8;
+
+	static TUniquePtr<FAutoPaintCaptureService> Instance;
+};
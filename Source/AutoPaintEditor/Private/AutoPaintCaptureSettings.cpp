@@ -3,6 +3,8 @@
 
 #include "AutoPaintCaptureSettings.h"
 
+#include "AutoPaintStats.h"
+#include "Engine/Texture2D.h"
 #include "Kismet/KismetRenderingLibrary.h"
 
 UAutoPaintCaptureSettings::UAutoPaintCaptureSettings() :
@@ -20,17 +22,30 @@ void UAutoPaintCaptureSettings::CreateOrUpdateRenderTarget(const FIntPoint& Scen
 {
 	SceneCaptureRT = GetOrCreateTransientRenderTarget2D(SceneCaptureRT, TEXT("Scene Capture RT"), SceneCaptureResolution, SCRenderTargetFormat);
 	NormalizeRT = GetOrCreateTransientRenderTarget2D(NormalizeRT, TEXT("Normalized RT"), SceneCaptureResolution, NRenderTargetFormat);
-	FinalRT = GetOrCreateTransientRenderTarget2D(FinalRT, TEXT("Final RT"), SceneCaptureResolution, FRenderTargetFormat);
 }
 
-void UAutoPaintCaptureSettings::ClearRenderTarget()
+void UAutoPaintCaptureSettings::CreateOrUpdateSectionMaskRenderTarget(const FIntPoint& SceneCaptureResolution)
 {
-	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, SceneCaptureRT, FLinearColor::Black);
-	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, NormalizeRT, FLinearColor::Black);
-	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, FinalRT, FLinearColor::Black);
+	SectionMaskRT = GetOrCreateTransientRenderTarget2D(SectionMaskRT, TEXT("Section Mask RT"), SceneCaptureResolution, RTF_RGBA16f, FLinearColor::Transparent);
 }
 
-void UAutoPaintCaptureSettings::Draw()
+void UAutoPaintCaptureSettings::ClearRenderTarget(UObject* WorldContextObject)
+{
+	UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, SceneCaptureRT, FLinearColor::Black);
+	UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, NormalizeRT, FLinearColor::Black);
+	if (SectionMaskRT)
+	{
+		UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, SectionMaskRT, FLinearColor::Transparent);
+	}
+}
+
+void UAutoPaintCaptureSettings::Draw(UObject* WorldContextObject)
+{
+	DrawNormalize(WorldContextObject);
+	DrawPostProcess(WorldContextObject);
+}
+
+void UAutoPaintCaptureSettings::DrawNormalize(UObject* WorldContextObject)
 {
 	if (!SceneCaptureRT)
 	{
@@ -43,8 +58,16 @@ void UAutoPaintCaptureSettings::Draw()
 	}
 	
 	NormalizeDrawMID->SetTextureParameterValue(FName(TEXT("RT")), SceneCaptureRT);
-	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, NormalizeRT, FLinearColor::Black);
-	UKismetRenderingLibrary::DrawMaterialToRenderTarget(GWorld, NormalizeRT, NormalizeDrawMID);
+	UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, NormalizeRT, FLinearColor::Black);
+	UKismetRenderingLibrary::DrawMaterialToRenderTarget(WorldContextObject, NormalizeRT, NormalizeDrawMID);
+}
+
+void UAutoPaintCaptureSettings::DrawPostProcess(UObject* WorldContextObject)
+{
+	if (!NormalizeRT)
+	{
+		return;
+	}
 
 	if (!FinalRT || !PostProcessDrawMID)
 	{
@@ -52,12 +75,14 @@ void UAutoPaintCaptureSettings::Draw()
 	}
 	
 	PostProcessDrawMID->SetTextureParameterValue(FName(TEXT("RT")), NormalizeRT);
-	UKismetRenderingLibrary::ClearRenderTarget2D(GWorld, FinalRT, FLinearColor::Black);
-	UKismetRenderingLibrary::DrawMaterialToRenderTarget(GWorld, FinalRT, PostProcessDrawMID);
+	UKismetRenderingLibrary::ClearRenderTarget2D(WorldContextObject, FinalRT, FLinearColor::Black);
+	UKismetRenderingLibrary::DrawMaterialToRenderTarget(WorldContextObject, FinalRT, PostProcessDrawMID);
 }
 
 UTexture* UAutoPaintCaptureSettings::RenderTargetCreateStaticTextureEditorOnly(UTextureRenderTarget* InRenderTarget, FString InName, UObject* InOuter)
 {
+	LLM_SCOPE_BYTAG(AutoPaint);
+
 	if (InRenderTarget == nullptr)
 	{
 		return nullptr;
@@ -88,18 +113,74 @@ UTexture* UAutoPaintCaptureSettings::RenderTargetCreateStaticTextureEditorOnly(U
 		// package needs saving
 		NewObj->MarkPackageDirty();
 
-		// Update Compression and Mip settings
-		NewTex->SRGB = false;
-		NewTex->Filter = TextureFilter::TF_Bilinear;
-		NewTex->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
-		NewTex->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
-		NewTex->PostEditChange();
+		ApplyPatchTextureSettings(NewTex);
 
 		return NewTex;
 	}
 	return nullptr;
 }
 
+UTexture* UAutoPaintCaptureSettings::CreateStaticTextureEditorOnly(const FIntPoint& InSize, TConstArrayView<FColor> InPixels, FString InName, UObject* InOuter)
+{
+	LLM_SCOPE_BYTAG(AutoPaint);
+
+	if (InSize.X <= 0 || InSize.Y <= 0 || InPixels.Num() != InSize.X * InSize.Y)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* NewTex = NewObject<UTexture2D>(InOuter, FName(*InName), RF_Public | RF_Standalone | RF_Transactional);
+	if (NewTex == nullptr)
+	{
+		return nullptr;
+	}
+
+	NewTex->Source.Init(InSize.X, InSize.Y, /*NumSlices = */1, /*NumMips = */1, TSF_BGRA8, reinterpret_cast<const uint8*>(InPixels.GetData()));
+	NewTex->MarkPackageDirty();
+
+	ApplyPatchTextureSettings(NewTex);
+
+	return NewTex;
+}
+
+UTexture* UAutoPaintCaptureSettings::CreateStaticHeightTextureEditorOnly(const FIntPoint& InSize, TConstArrayView<uint16> InHeights, FString InName, UObject* InOuter)
+{
+	LLM_SCOPE_BYTAG(AutoPaint);
+
+	if (InSize.X <= 0 || InSize.Y <= 0 || InHeights.Num() != InSize.X * InSize.Y)
+	{
+		return nullptr;
+	}
+
+	UTexture2D* NewTex = NewObject<UTexture2D>(InOuter, FName(*InName), RF_Public | RF_Standalone | RF_Transactional);
+	if (NewTex == nullptr)
+	{
+		return nullptr;
+	}
+
+	NewTex->Source.Init(InSize.X, InSize.Y, /*NumSlices = */1, /*NumMips = */1, TSF_G16, reinterpret_cast<const uint8*>(InHeights.GetData()));
+	NewTex->MarkPackageDirty();
+
+	// Grayscale keeps a 16 bit source as G16, the vector displacement format of ApplyPatchTextureSettings is 8 bit
+	NewTex->SRGB = false;
+	NewTex->Filter = TextureFilter::TF_Bilinear;
+	NewTex->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
+	NewTex->CompressionSettings = TextureCompressionSettings::TC_Grayscale;
+	NewTex->PostEditChange();
+
+	return NewTex;
+}
+
+void UAutoPaintCaptureSettings::ApplyPatchTextureSettings(UTexture* InTexture)
+{
+	// Update Compression and Mip settings
+	InTexture->SRGB = false;
+	InTexture->Filter = TextureFilter::TF_Bilinear;
+	InTexture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
+	InTexture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
+	InTexture->PostEditChange();
+}
+
 UMaterialInterface* UAutoPaintCaptureSettings::GetDefaultVisualizeMaterial() const
 {
 	return DefaultVisualizeMaterial.LoadSynchronous();
@@ -149,6 +230,8 @@ UMaterialInstanceDynamic* UAutoPaintCaptureSettings::GetOrCreateTransientMID(UMa
 UTextureRenderTarget2D* UAutoPaintCaptureSettings::GetOrCreateTransientRenderTarget2D(UTextureRenderTarget2D* InRenderTarget, FName InRenderTargetName, const FIntPoint& InSize, ETextureRenderTargetFormat InFormat, 
 	const FLinearColor& InClearColor, bool bInAutoGenerateMipMaps)
 {
+	LLM_SCOPE_BYTAG(AutoPaint);
+
 	EPixelFormat PixelFormat = GetPixelFormatFromRenderTargetFormat(InFormat);
 	if ((InSize.X <= 0) 
 		|| (InSize.Y <= 0) 
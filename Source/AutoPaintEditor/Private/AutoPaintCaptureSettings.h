@@ -31,12 +31,24 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = SceneCapture)
 	TEnumAsByte<ESceneCaptureSource> CaptureSource;
 
+	/**
+	 * Capture scene depth with a dedicated pass that rasterizes only mesh positions instead of a Scene Capture render.
+	 * Falls back to Scene Capture when the RHI can't fetch vertices manually or Capture Source isn't Scene Depth.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = SceneCapture)
+	bool bUseMeshDepthPass = true;
+
+	/** Section layer coverage of the last capture, float so jittered samples accumulate without banding */
+	UPROPERTY(VisibleAnywhere, Category = SceneCapture, Transient)
+	TObjectPtr<UTextureRenderTarget2D> SectionMaskRT = nullptr;
+
 	UPROPERTY(VisibleAnywhere, Category = Draw, Transient)
 	TObjectPtr<UTextureRenderTarget2D> NormalizeRT = nullptr;
 
 	UPROPERTY(EditAnywhere, config, Category = Draw)
 	TEnumAsByte<ETextureRenderTargetFormat> NRenderTargetFormat;
 
+	/** Leased from FAutoPaintCaptureService target pool for the capture in progress */
 	UPROPERTY(VisibleAnywhere, Category = Draw, Transient)
 	TObjectPtr<UTextureRenderTarget2D> FinalRT = nullptr;
 
@@ -49,8 +61,24 @@ public:
 	UPROPERTY(VisibleAnywhere, Category = Draw, Transient)
 	TObjectPtr<UMaterialInstanceDynamic> PostProcessDrawMID = nullptr;
 
-	UPROPERTY(VisibleAnywhere, Category = Visualize, Transient)
-	TObjectPtr<UMaterialInstanceDynamic> VisualizeMID = nullptr;
+	/** Redraw editor viewport every frame. When off it redraws only on camera input, property changes and finished captures. */
+	UPROPERTY(EditAnywhere, config, Category = Viewport)
+	bool bRealtimeViewport = false;
+
+	/** Preview without sky, environment and post process profile. Applied to newly opened editors. */
+	UPROPERTY(EditAnywhere, config, Category = Viewport)
+	bool bLightweightPreviewScene = false;
+
+	/**
+	 * Recapture while asset properties are edited, re-running only the stages affected by the change.
+	 * Default of newly opened editors, the toolbar toggles it per editor.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = Live)
+	bool bLiveCapture = true;
+
+	/** Seconds without edits (e.g. slider drag) before live recapture runs. Committed values are captured on next tick. */
+	UPROPERTY(EditAnywhere, config, Category = Live, meta = (EditCondition = "bLiveCapture", ClampMin = "0", UIMax = "0.5"))
+	float LiveCaptureDebounce = 0.03f;
 
 	UPROPERTY(EditAnywhere, config, Category = Materials, AdvancedDisplay)
 	TSoftObjectPtr<UMaterialInterface> DefaultVisualizeMaterial;
@@ -61,13 +89,32 @@ public:
 	UPROPERTY(EditAnywhere, config, Category = Materials, AdvancedDisplay)
 	TSoftObjectPtr<UMaterialInterface> DefaultPostProcessDrawMaterial;
 
+	/** Scratch Scene Capture and Normalize RTs. Final RT is provided by the caller. */
 	void CreateOrUpdateRenderTarget(const FIntPoint& SceneCaptureResolution);
-	void ClearRenderTarget();
-
-	void Draw();
+	/** Scratch Section Mask RT, only created for assets with section layers */
+	void CreateOrUpdateSectionMaskRenderTarget(const FIntPoint& SceneCaptureResolution);
+	void ClearRenderTarget(UObject* WorldContextObject);
+
+	void Draw(UObject* WorldContextObject);
+	/** Normalize step only: Scene Capture RT -> Normalize RT */
+	void DrawNormalize(UObject* WorldContextObject);
+	/** Post process step only: Normalize RT -> Final RT */
+	void DrawPostProcess(UObject* WorldContextObject);
 	
 	UTexture* RenderTargetCreateStaticTextureEditorOnly(UTextureRenderTarget* InRenderTarget, FString InName, UObject* InOuter);
 
+	/** Creates static texture from CPU generated BGRA8 pixels (used when there is no RHI to capture with). */
+	static UTexture* CreateStaticTextureEditorOnly(const FIntPoint& InSize, TConstArrayView<FColor> InPixels, FString InName, UObject* InOuter);
+
+	/**
+	 * Creates static texture from 16 bit heights (G16), for heightfields with more precision than the 8 bit patch storage.
+	 * Heights are sampled from R like captured ones, there is no distance field or derivatives next to them.
+	 */
+	static UTexture* CreateStaticHeightTextureEditorOnly(const FIntPoint& InSize, TConstArrayView<uint16> InHeights, FString InName, UObject* InOuter);
+
+	/** Patch textures store raw heights, so they are linear, uncompressed and without mips. */
+	static void ApplyPatchTextureSettings(UTexture* InTexture);
+
 	UMaterialInterface* GetDefaultVisualizeMaterial() const;
 	FSoftObjectPath GetDefaultVisualizeMaterialPath() const { return DefaultVisualizeMaterial.ToSoftObjectPath(); }
 
@@ -0,0 +1,346 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintCapturer.h"
+
+#include "AutoPaintCaptureSettings.h"
+#include "AutoPaintData.h"
+#include "AutoPaintMeshDepthCapture.h"
+#include "AutoPaintStats.h"
+#include "PreviewScene.h"
+#include "StaticMeshResources.h"
+#include "Components/SceneCaptureComponent2D.h"
+#include "Components/StaticMeshComponent.h"
+#include "Engine/StaticMesh.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
+
+DECLARE_CYCLE_STAT(TEXT("Capture"), STAT_AutoPaint_Capture, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Capture Mesh Depth"), STAT_AutoPaint_CaptureMeshDepth, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Capture Scene"), STAT_AutoPaint_CaptureScene, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Capture Normalize"), STAT_AutoPaint_CaptureNormalize, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Capture Post Process"), STAT_AutoPaint_CapturePostProcess, STATGROUP_AutoPaint);
+
+FAutoPaintCapturer::FAutoPaintCapturer()
+{
+	CaptureScene = MakeUnique<FPreviewScene>(FPreviewScene::ConstructionValues()
+		.SetCreateDefaultLighting(false)
+		.SetCreatePhysicsScene(false)
+		.SetTransactional(false)
+		.SetEditor(true));
+
+	Settings = NewObject<UAutoPaintCaptureSettings>(GetTransientPackage());
+	UpdateMIDs();
+
+	CaptureMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+	CaptureScene->AddComponent(CaptureMeshComponent, FTransform::Identity);
+
+	CaptureFloorMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
+	CaptureFloorMeshComponent->SetStaticMesh(LoadObject<UStaticMesh>(nullptr, TEXT("/AutoPaint/Resources/Meshes/S_RenderPlane.S_RenderPlane")));
+	CaptureScene->AddComponent(CaptureFloorMeshComponent, FTransform(FQuat::Identity, FVector::ZeroVector, FVector::OneVector * 10));
+
+	SceneCaptureComponent2D = NewObject<USceneCaptureComponent2D>(GetTransientPackage(), NAME_None, RF_Transient);
+	CaptureScene->AddComponent(SceneCaptureComponent2D, FTransform::Identity);
+}
+
+FAutoPaintCapturer::~FAutoPaintCapturer()
+{
+	if (CaptureScene)
+	{
+		CaptureScene->RemoveComponent(SceneCaptureComponent2D);
+		CaptureScene->RemoveComponent(CaptureFloorMeshComponent);
+		CaptureScene->RemoveComponent(CaptureMeshComponent);
+	}
+}
+
+void FAutoPaintCapturer::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	Collector.AddReferencedObject(CaptureMeshComponent);
+	Collector.AddReferencedObject(CaptureFloorMeshComponent);
+	Collector.AddReferencedObject(SceneCaptureComponent2D);
+	Collector.AddReferencedObject(Settings);
+}
+
+UWorld* FAutoPaintCapturer::GetWorld() const
+{
+	return CaptureScene ? CaptureScene->GetWorld() : nullptr;
+}
+
+void FAutoPaintCapturer::UpdateMIDs()
+{
+	Settings->NormalizeDrawMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(Settings->NormalizeDrawMID, TEXT("Normalize MID"), Settings->GetDefaultNormalizeDrawMaterial());
+	Settings->PostProcessDrawMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(Settings->PostProcessDrawMID, TEXT("Final MID"), Settings->GetDefaultPostProcessDrawMaterial());
+}
+
+FMatrix FAutoPaintCaptureTile::GetClipToTileClip() const
+{
+	// Tile rect in full image NDC, Y points up
+	const FVector2D Min(-1.0 + 2.0 * Rect.Min.X / FullResolution.X, 1.0 - 2.0 * Rect.Max.Y / FullResolution.Y);
+	const FVector2D Max(-1.0 + 2.0 * Rect.Max.X / FullResolution.X, 1.0 - 2.0 * Rect.Min.Y / FullResolution.Y);
+
+	// Scale and offset the rect to [-1, 1], offset is multiplied by clip W so it works for perspective too
+	const FVector2D Scale = FVector2D(2.0) / (Max - Min);
+	const FVector2D Offset = -(Max + Min) / (Max - Min);
+	return FScaleMatrix(FVector(Scale.X, Scale.Y, 1.0)) * FTranslationMatrix(FVector(Offset.X, Offset.Y, 0.0));
+}
+
+void FAutoPaintCapturer::UpdateCaptureComponent(const UAutoPaintData* InData, const FAutoPaintCaptureTile* InTile)
+{
+	TArray<FEngineShowFlagsSetting> ShowFlagsSettings;
+	ShowFlagsSettings.Add({"AmbientOcclusion", false});
+	ShowFlagsSettings.Add({"Fog", false});
+	ShowFlagsSettings.Add({"AtmosphericFog", false});
+	ShowFlagsSettings.Add({ TEXT("NaniteMeshes"), false });
+	ShowFlagsSettings.Add({ TEXT("Atmosphere"), false });
+	ShowFlagsSettings.Add({ TEXT("Bloom"), false });
+	ShowFlagsSettings.Add({ TEXT("Lighting"), false });
+
+	SceneCaptureComponent2D->ShowFlagSettings = ShowFlagsSettings;
+	SceneCaptureComponent2D->bCaptureEveryFrame = false;
+	SceneCaptureComponent2D->bCaptureOnMovement = false;
+	SceneCaptureComponent2D->PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
+	SceneCaptureComponent2D->PostProcessBlendWeight = 1.f;
+	SceneCaptureComponent2D->CaptureSource = Settings->CaptureSource;
+
+	SceneCaptureComponent2D->ProjectionType = InData->ProjectionType;
+	SceneCaptureComponent2D->OrthoWidth = InData->CameraOrthoWidth;
+	SceneCaptureComponent2D->FOVAngle = InData->CameraFOV;
+
+	const FVector Location = FVector::UpVector * InData->CameraDistance;
+	SceneCaptureComponent2D->SetRelativeLocation(Location);
+	SceneCaptureComponent2D->SetRelativeRotation(InData->CameraRotation);
+	SceneCaptureComponent2D->UpdateBounds();
+
+	SceneCaptureComponent2D->bUseCustomProjectionMatrix = InTile != nullptr;
+	if (InTile)
+	{
+		FMatrix WorldToView, ViewToClip;
+		GetViewMatrices(InData, InTile->FullResolution, WorldToView, ViewToClip);
+		SceneCaptureComponent2D->CustomProjectionMatrix = ViewToClip * InTile->GetClipToTileClip();
+	}
+}
+
+bool FAutoPaintCapturer::Capture(UAutoPaintData* InData, UTextureRenderTarget2D* InFinalRT, EAutoPaintCaptureStages InStages, const FAutoPaintCaptureTile* InTile)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_Capture);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, Capture);
+
+	if (!InData || !InFinalRT)
+	{
+		return false;
+	}
+
+	// Scratch RTs are shared between assets, post process alone is only valid on top of this asset's capture
+	if (!EnumHasAnyFlags(InStages, EAutoPaintCaptureStages::Capture) && (NormalizedData.Get() != InData || InTile))
+	{
+		InStages |= EAutoPaintCaptureStages::Capture;
+	}
+
+	const FIntPoint Resolution = InTile ? InTile->Rect.Size() : InData->SceneCaptureResolution;
+
+	Settings->FinalRT = InFinalRT;
+
+	if (EnumHasAnyFlags(InStages, EAutoPaintCaptureStages::Capture))
+	{
+		NormalizedData.Reset();
+		SectionMaskData.Reset();
+		SectionMaskLayers.Reset();
+
+		UStaticMesh* StaticMesh = InData->ReferencedStaticMesh.LoadSynchronous();
+		if (!StaticMesh)
+		{
+			return false;
+		}
+
+		Settings->CreateOrUpdateRenderTarget(Resolution);
+		if (!Settings->SceneCaptureRT)
+		{
+			return false;
+		}
+
+		CaptureMeshComponent->SetStaticMesh(StaticMesh);
+		CaptureMeshComponent->SetRelativeLocation(InData->WorldOffset);
+
+		// Capture
+		if (CanUseMeshDepthPass())
+		{
+			CaptureMeshDepth(InData, StaticMesh, InTile);
+		}
+		else
+		{
+			RenderSceneCapture(InData, InTile);
+		}
+
+		// Draw
+		if (TObjectPtr<UMaterialInstanceDynamic>& MID = Settings->NormalizeDrawMID)
+		{
+			MID->SetScalarParameterValue(TEXT("CameraDistance"), InData->CameraDistance);
+			// @todo: pivot isn't bottom point?
+			MID->SetScalarParameterValue(TEXT("ObjectHeight"), CaptureMeshComponent->Bounds.BoxExtent.Z * 2.f);
+		}
+
+		{
+			SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CaptureNormalize);
+			Settings->DrawNormalize(GetWorld());
+		}
+		// Normalize RT holds only one tile of a tiled capture, nothing to reuse
+		if (!InTile)
+		{
+			NormalizedData = InData;
+		}
+
+		// Don't keep the mesh alive between captures of different assets
+		CaptureMeshComponent->SetStaticMesh(nullptr);
+	}
+
+	if (TObjectPtr<UMaterialInstanceDynamic>& MID = Settings->PostProcessDrawMID)
+	{
+		// Distance is in UV of the target, keep it the same in texels of the full image
+		const float TileScale = InTile ? static_cast<float>(InTile->FullResolution.X) / Resolution.X : 1.f;
+		MID->SetScalarParameterValue(TEXT("Distance"), InData->BlurDistance * TileScale);
+	}
+
+	{
+		SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CapturePostProcess);
+		CSV_SCOPED_TIMING_STAT(AutoPaint, CapturePostProcess);
+		Settings->DrawPostProcess(GetWorld());
+	}
+
+	return true;
+}
+
+bool FAutoPaintCapturer::CanUseMeshDepthPass() const
+{
+	return Settings->bUseMeshDepthPass && Settings->CaptureSource == SCS_SceneDepth && FAutoPaintMeshDepthCaptureGPUInterface::IsSupported();
+}
+
+void FAutoPaintCapturer::CaptureMeshDepth(const UAutoPaintData* InData, const UStaticMesh* InStaticMesh, const FAutoPaintCaptureTile* InTile)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CaptureMeshDepth);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, CaptureMeshDepth);
+
+	UTextureRenderTarget2D* DepthRT = Settings->SceneCaptureRT;
+
+	FMatrix WorldToView, ViewToClip;
+	GetViewMatrices(InData, InTile ? InTile->FullResolution : FIntPoint(DepthRT->SizeX, DepthRT->SizeY), WorldToView, ViewToClip);
+	if (InTile)
+	{
+		ViewToClip = ViewToClip * InTile->GetClipToTileClip();
+	}
+
+	FAutoPaintMeshDepthCaptureDispatchParams Params;
+	Params.DepthResult = DepthRT;
+	Params.WorldToView = FMatrix44f(WorldToView);
+	Params.ViewToClip = FMatrix44f(ViewToClip);
+	// Largest R16F value, the floor normally covers the whole view anyway
+	Params.ClearDepth = 65504.f;
+	Params.NumSamples = InData->CaptureSamples;
+	Params.bTentFilter = InData->CaptureFilter == EAutoPaintCaptureFilter::Tent;
+
+	FAutoPaintMeshDepthCaptureMesh& CapturedMesh = Params.Meshes.Add_GetRef({ InStaticMesh->GetRenderData(), FMatrix44f(CaptureMeshComponent->GetComponentTransform().ToMatrixWithScale()) });
+
+	// Mask channels follow distinct layer names, sections reach them through their material slot
+	const TArray<FName> LayerNames = InData->GetSectionLayerNames();
+	const FStaticMeshRenderData* RenderData = InStaticMesh->GetRenderData();
+	if (!InTile && LayerNames.Num() > 0 && RenderData && RenderData->LODResources.Num() > 0)
+	{
+		const TArray<FStaticMaterial>& StaticMaterials = InStaticMesh->GetStaticMaterials();
+		for (const FStaticMeshSection& Section : RenderData->LODResources[0].Sections)
+		{
+			int32 Channel = INDEX_NONE;
+			if (StaticMaterials.IsValidIndex(Section.MaterialIndex))
+			{
+				const FName SlotName = StaticMaterials[Section.MaterialIndex].MaterialSlotName;
+				const FAutoPaintSectionLayer* SectionLayer = InData->SectionLayers.FindByPredicate([SlotName](const FAutoPaintSectionLayer& Layer)
+				{
+					return Layer.MaterialSlotName == SlotName;
+				});
+				Channel = SectionLayer ? LayerNames.IndexOfByKey(SectionLayer->LayerName) : INDEX_NONE;
+			}
+			CapturedMesh.SectionChannels.Add(Channel);
+		}
+
+		Settings->CreateOrUpdateSectionMaskRenderTarget(FIntPoint(DepthRT->SizeX, DepthRT->SizeY));
+		Params.SectionMaskResult = Settings->SectionMaskRT;
+	}
+
+	if (const UStaticMesh* FloorMesh = CaptureFloorMeshComponent->GetStaticMesh())
+	{
+		Params.Meshes.Add({ FloorMesh->GetRenderData(), FMatrix44f(CaptureFloorMeshComponent->GetComponentTransform().ToMatrixWithScale()) });
+	}
+
+	FAutoPaintMeshDepthCaptureGPUInterface::Dispatch(Params);
+
+	if (Params.SectionMaskResult)
+	{
+		SectionMaskData = InData;
+		SectionMaskLayers = LayerNames;
+	}
+}
+
+void FAutoPaintCapturer::RenderSceneCapture(const UAutoPaintData* InData, const FAutoPaintCaptureTile* InTile)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CaptureScene);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, CaptureScene);
+
+	UpdateCaptureComponent(InData, InTile);
+
+	SceneCaptureComponent2D->TextureTarget = Settings->SceneCaptureRT;
+
+	SceneCaptureComponent2D->ClearShowOnlyComponents();
+	SceneCaptureComponent2D->ShowOnlyActors.Empty();
+	SceneCaptureComponent2D->ShowOnlyComponent(CaptureMeshComponent);
+	if (CaptureFloorMeshComponent->GetStaticMesh())
+	{
+		SceneCaptureComponent2D->ShowOnlyComponent(CaptureFloorMeshComponent);
+	}
+	SceneCaptureComponent2D->CaptureScene();
+
+	// Avoid keeping references to Captured components
+	SceneCaptureComponent2D->ClearShowOnlyComponents();
+	SceneCaptureComponent2D->TextureTarget = nullptr;
+}
+
+void FAutoPaintCapturer::GetViewMatrices(const UAutoPaintData* InData, const FIntPoint& InSize, FMatrix& OutWorldToView, FMatrix& OutViewToClip)
+{
+	const FVector Location = FVector::UpVector * InData->CameraDistance;
+
+	// Engine view space: X right, Y up, Z forward
+	OutWorldToView = FTranslationMatrix(-Location) * FInverseRotationMatrix(InData->CameraRotation) * FMatrix(
+		FPlane(0, 0, 1, 0),
+		FPlane(1, 0, 0, 0),
+		FPlane(0, 1, 0, 0),
+		FPlane(0, 0, 0, 1));
+
+	const float AspectRatio = InSize.Y > 0 ? static_cast<float>(InSize.X) / InSize.Y : 1.f;
+	if (InData->ProjectionType == ECameraProjectionMode::Orthographic)
+	{
+		const float HalfWidth = InData->CameraOrthoWidth * 0.5f;
+		// Clip depth only has to stay in range, captured depth comes from view space
+		OutViewToClip = FReversedZOrthoMatrix(HalfWidth, HalfWidth / AspectRatio, 1.f / UE_OLD_HALF_WORLD_MAX, 0.f);
+	}
+	else
+	{
+		const float HalfFOV = FMath::DegreesToRadians(InData->CameraFOV) * 0.5f;
+		OutViewToClip = FReversedZPerspectiveMatrix(HalfFOV, HalfFOV, 1.f, AspectRatio, GNearClippingPlane, GNearClippingPlane);
+	}
+}
+
+UTextureRenderTarget2D* FAutoPaintCapturer::GetSectionMask(const UAutoPaintData* InData, TArray<FName>& OutLayerNames) const
+{
+	if (!InData || SectionMaskData.Get() != InData || !Settings->SectionMaskRT)
+	{
+		return nullptr;
+	}
+
+	OutLayerNames = SectionMaskLayers;
+	return Settings->SectionMaskRT;
+}
+
+void FAutoPaintCapturer::ClearRenderTargets()
+{
+	NormalizedData.Reset();
+	SectionMaskData.Reset();
+	SectionMaskLayers.Reset();
+	Settings->ClearRenderTarget(GetWorld());
+}
@@ -0,0 +1,104 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/GCObject.h"
+
+class FPreviewScene;
+class UAutoPaintData;
+class UAutoPaintCaptureSettings;
+class UStaticMesh;
+class UStaticMeshComponent;
+class USceneCaptureComponent2D;
+class UTextureRenderTarget2D;
+
+/** Capture pipeline steps, lets live edits re-run only what a property change affects */
+enum class EAutoPaintCaptureStages : uint8
+{
+	None = 0,
+	/** Scene capture of the mesh and normalize draw */
+	Capture = 1 << 0,
+	/** Post process (blur) draw into Final RT */
+	PostProcess = 1 << 1,
+	All = Capture | PostProcess
+};
+ENUM_CLASS_FLAGS(EAutoPaintCaptureStages);
+
+/** Part of a capture that doesn't fit a single render target, in texels of the full Scene Capture Resolution image */
+struct FAutoPaintCaptureTile
+{
+	FIntPoint FullResolution = FIntPoint::ZeroValue;
+	/** Captured rect including overlap for the post process, may extend past the full image */
+	FIntRect Rect;
+
+	/** Sub-frustum: maps full image clip space onto this tile */
+	FMatrix GetClipToTileClip() const;
+};
+
+/**
+ * Capture-only world with the components required to render an AutoPaint asset into
+ * the capture settings render targets. Doesn't depend on any editor UI.
+ * Owned by FAutoPaintCaptureService, use that instead of creating new ones.
+ */
+class FAutoPaintCapturer : public FGCObject
+{
+public:
+	FAutoPaintCapturer();
+	virtual ~FAutoPaintCapturer() override;
+
+	//~ Begin FGCObject Interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FAutoPaintCapturer"); }
+	//~ End FGCObject Interface
+
+	UAutoPaintCaptureSettings* GetSettings() const { return Settings; }
+	UWorld* GetWorld() const;
+
+	/**
+	 * Captures asset mesh and runs normalize and post process draws into InFinalRT.
+	 * Stages without Capture reuse Normalize RT when it still holds this asset, otherwise everything runs.
+	 * With InTile only that part of the projection is captured, scratch RTs and InFinalRT are tile sized.
+	 */
+	bool Capture(UAutoPaintData* InData, UTextureRenderTarget2D* InFinalRT, EAutoPaintCaptureStages InStages = EAutoPaintCaptureStages::All,
+		const FAutoPaintCaptureTile* InTile = nullptr);
+
+	void ClearRenderTargets();
+
+	/**
+	 * Section Mask RT if it holds the section layers of InData from the last capture, with the layer names in channel
+	 * order. Only the mesh depth pass captures masks, and never per tile.
+	 */
+	UTextureRenderTarget2D* GetSectionMask(const UAutoPaintData* InData, TArray<FName>& OutLayerNames) const;
+
+	/** Matches view and projection of the Scene Capture set up in UpdateCaptureComponent */
+	static void GetViewMatrices(const UAutoPaintData* InData, const FIntPoint& InSize, FMatrix& OutWorldToView, FMatrix& OutViewToClip);
+
+private:
+	void UpdateMIDs();
+	void UpdateCaptureComponent(const UAutoPaintData* InData, const FAutoPaintCaptureTile* InTile);
+
+	bool CanUseMeshDepthPass() const;
+	/**
+	 * Scene depth of the capture mesh and floor into Scene Capture RT, see FAutoPaintMeshDepthCaptureGPUInterface.
+	 * Section layers of a full capture are written into Section Mask RT by the same dispatch.
+	 */
+	void CaptureMeshDepth(const UAutoPaintData* InData, const UStaticMesh* InStaticMesh, const FAutoPaintCaptureTile* InTile);
+	/** Full Scene Capture render into Scene Capture RT */
+	void RenderSceneCapture(const UAutoPaintData* InData, const FAutoPaintCaptureTile* InTile);
+
+	TUniquePtr<FPreviewScene> CaptureScene;
+
+	TObjectPtr<UStaticMeshComponent> CaptureMeshComponent = nullptr;
+	TObjectPtr<UStaticMeshComponent> CaptureFloorMeshComponent = nullptr;
+	TObjectPtr<USceneCaptureComponent2D> SceneCaptureComponent2D = nullptr;
+
+	TObjectPtr<UAutoPaintCaptureSettings> Settings = nullptr;
+
+	/** Asset whose normalized capture is currently in Normalize RT */
+	TWeakObjectPtr<const UAutoPaintData> NormalizedData;
+
+	/** Asset whose section layers are currently in Section Mask RT, and their names in channel order */
+	TWeakObjectPtr<const UAutoPaintData> SectionMaskData;
+	TArray<FName> SectionMaskLayers;
+};
@@ -0,0 +1,205 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintDistanceField.h"
+
+#include "Async/ParallelFor.h"
+
+namespace AutoPaintDistanceField
+{
+	static constexpr float Infinity = TNumericLimits<float>::Max();
+
+	// Lines are transformed in bands, each band has its own scratch memory
+	static constexpr int32 LinesPerBand = 16;
+
+	struct FScratch
+	{
+		TArray<float> Input;
+		TArray<float> Output;
+		TArray<int32> Sites;
+		TArray<float> Bounds;
+
+		void Init(int32 InNum)
+		{
+			Input.SetNumUninitialized(InNum);
+			Output.SetNumUninitialized(InNum);
+			Sites.SetNumUninitialized(InNum);
+			Bounds.SetNumUninitialized(InNum + 1);
+		}
+	};
+
+	// Squared distance transform of one line (Felzenszwalb & Huttenlocher), lower envelope of the parabolas
+	// rooted at every finite sample. Spacing is the world distance between samples.
+	static void TransformLine(FScratch& Scratch, int32 InNum, float InSpacing)
+	{
+		const float* F = Scratch.Input.GetData();
+		int32* V = Scratch.Sites.GetData();
+		float* Z = Scratch.Bounds.GetData();
+
+		int32 K = INDEX_NONE;
+		for (int32 Q = 0; Q < InNum; ++Q)
+		{
+			if (F[Q] == Infinity)
+			{
+				continue;
+			}
+
+			const float XQ = Q * InSpacing;
+			if (K == INDEX_NONE)
+			{
+				K = 0;
+				V[0] = Q;
+				Z[0] = -Infinity;
+				Z[1] = Infinity;
+				continue;
+			}
+
+			float S;
+			while (true)
+			{
+				const float XV = V[K] * InSpacing;
+				S = ((F[Q] + XQ * XQ) - (F[V[K]] + XV * XV)) / (2.f * (XQ - XV));
+				if (S > Z[K])
+				{
+					break;
+				}
+				// Z[0] is -Infinity, so K never drops below 0
+				--K;
+			}
+
+			++K;
+			V[K] = Q;
+			Z[K] = S;
+			Z[K + 1] = Infinity;
+		}
+
+		float* D = Scratch.Output.GetData();
+		if (K == INDEX_NONE)
+		{
+			for (int32 P = 0; P < InNum; ++P)
+			{
+				D[P] = Infinity;
+			}
+			return;
+		}
+
+		K = 0;
+		for (int32 P = 0; P < InNum; ++P)
+		{
+			const float XP = P * InSpacing;
+			while (Z[K + 1] < XP)
+			{
+				++K;
+			}
+			const float Delta = XP - V[K] * InSpacing;
+			D[P] = Delta * Delta + F[V[K]];
+		}
+	}
+
+	// Squared world distance from every texel to the nearest texel where bIsSite matches InSiteValue.
+	// The grid is padded by one outside texel on every side, so the texture border counts as an edge.
+	static void Transform(const TBitArray<>& InInside, const FIntPoint& InPaddedSize, const FVector2f& InSpacing, bool bInSitesInside, TArray<float>& OutDistances)
+	{
+		const int32 Width = InPaddedSize.X;
+		const int32 Height = InPaddedSize.Y;
+		OutDistances.SetNumUninitialized(Width * Height);
+
+		// Columns
+		ParallelFor(FMath::DivideAndRoundUp(Width, LinesPerBand), [&](int32 BandIndex)
+		{
+			FScratch Scratch;
+			Scratch.Init(Height);
+
+			const int32 MaxX = FMath::Min((BandIndex + 1) * LinesPerBand, Width);
+			for (int32 X = BandIndex * LinesPerBand; X < MaxX; ++X)
+			{
+				for (int32 Y = 0; Y < Height; ++Y)
+				{
+					Scratch.Input[Y] = InInside[Y * Width + X] == bInSitesInside ? 0.f : Infinity;
+				}
+				TransformLine(Scratch, Height, InSpacing.Y);
+				for (int32 Y = 0; Y < Height; ++Y)
+				{
+					OutDistances[Y * Width + X] = Scratch.Output[Y];
+				}
+			}
+		});
+
+		// Rows
+		ParallelFor(FMath::DivideAndRoundUp(Height, LinesPerBand), [&](int32 BandIndex)
+		{
+			FScratch Scratch;
+			Scratch.Init(Width);
+
+			const int32 MaxY = FMath::Min((BandIndex + 1) * LinesPerBand, Height);
+			for (int32 Y = BandIndex * LinesPerBand; Y < MaxY; ++Y)
+			{
+				float* Row = &OutDistances[Y * Width];
+				FMemory::Memcpy(Scratch.Input.GetData(), Row, Width * sizeof(float));
+				TransformLine(Scratch, Width, InSpacing.X);
+				FMemory::Memcpy(Row, Scratch.Output.GetData(), Width * sizeof(float));
+			}
+		});
+	}
+}
+
+bool FAutoPaintDistanceField::Encode(const FIntPoint& InSize, const FVector2D& InWorldSize, TArray<FColor>& InOutPixels, FBox2D& OutMaskUVBounds)
+{
+	using namespace AutoPaintDistanceField;
+
+	if (InSize.X <= 0 || InSize.Y <= 0 || InOutPixels.Num() != InSize.X * InSize.Y || InWorldSize.X <= 0 || InWorldSize.Y <= 0)
+	{
+		return false;
+	}
+
+	const FIntPoint PaddedSize = InSize + FIntPoint(2, 2);
+	TBitArray<> Inside(false, PaddedSize.X * PaddedSize.Y);
+
+	FIntRect MaskRect(InSize, FIntPoint::ZeroValue);
+	for (int32 Y = 0; Y < InSize.Y; ++Y)
+	{
+		for (int32 X = 0; X < InSize.X; ++X)
+		{
+			if (InOutPixels[Y * InSize.X + X].R > 0)
+			{
+				Inside[(Y + 1) * PaddedSize.X + X + 1] = true;
+				MaskRect.Min = MaskRect.Min.ComponentMin(FIntPoint(X, Y));
+				MaskRect.Max = MaskRect.Max.ComponentMax(FIntPoint(X + 1, Y + 1));
+			}
+		}
+	}
+
+	if (MaskRect.IsEmpty())
+	{
+		return false;
+	}
+
+	const FVector2f Spacing = FVector2f(InWorldSize) / FVector2f(InSize);
+
+	// Inside texels measure to the nearest outside texel and the other way around
+	TArray<float> ToOutside;
+	TArray<float> ToInside;
+	Transform(Inside, PaddedSize, Spacing, /*bInSitesInside = */false, ToOutside);
+	Transform(Inside, PaddedSize, Spacing, /*bInSitesInside = */true, ToInside);
+
+	// The edge lies half way between an inside and an outside texel center
+	const float HalfTexel = 0.5f * FMath::Min(Spacing.X, Spacing.Y);
+	const float DistanceToEncoded = 1.f / (2.f * UVRange * static_cast<float>(FMath::Max(InWorldSize.X, InWorldSize.Y)));
+
+	ParallelFor(InSize.Y, [&](int32 Y)
+	{
+		for (int32 X = 0; X < InSize.X; ++X)
+		{
+			const int32 PaddedIndex = (Y + 1) * PaddedSize.X + X + 1;
+			const float Distance = Inside[PaddedIndex]
+				? FMath::Sqrt(ToOutside[PaddedIndex]) - HalfTexel
+				: HalfTexel - FMath::Sqrt(ToInside[PaddedIndex]);
+
+			const float Encoded = FMath::Clamp(0.5f + Distance * DistanceToEncoded, 0.f, 1.f);
+			InOutPixels[Y * InSize.X + X].G = (uint8)FMath::RoundToInt(Encoded * 255.f);
+		}
+	});
+
+	OutMaskUVBounds = FBox2D(FVector2D(MaskRect.Min) / FVector2D(InSize), FVector2D(MaskRect.Max) / FVector2D(InSize));
+	return true;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Signed distance to the edge of the captured mask, stored next to the heights so patches can fall off along the
+ * outline of the mesh instead of a circle. Texels with a non zero height (R) are inside, the capture floor and
+ * everything past the texture border are outside.
+ *
+ * G = 0.5 + Distance / (2 * UVRange * max(WorldSize)), positive inside. Must match GetShapeDistanceAlpha.
+ */
+struct FAutoPaintDistanceField
+{
+	/** Largest encoded distance as a fraction of the longer patch side, must match SHAPE_DISTANCE_RANGE in AutoPaintShapeFalloff.ush */
+	static constexpr float UVRange = 0.25f;
+
+	/**
+	 * Writes the signed distance into G of InOutPixels (InSize, BGRA8) and returns the patch UV rect of the mask.
+	 * Returns false and leaves pixels untouched if nothing was captured.
+	 */
+	static bool Encode(const FIntPoint& InSize, const FVector2D& InWorldSize, TArray<FColor>& InOutPixels, FBox2D& OutMaskUVBounds);
+};
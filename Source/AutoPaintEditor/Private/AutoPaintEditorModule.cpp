@@ -2,10 +2,32 @@
 
 #include "AssetToolsModule.h"
 #include "AssetTypeActions_AutoPaintSettings.h"
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintData.h"
+#include "AutoPaintMemory.h"
 #include "ContentBrowserModule.h"
+#include "Engine/Texture.h"
+#include "UObject/UObjectIterator.h"
 
 #define LOCTEXT_NAMESPACE "FAutoPaintEditorModule"
 
+namespace AutoPaintEditorModule
+{
+	/** Texture of every loaded AutoPaint asset, tiles only while they are loaded */
+	static void GatherAssetMemory(TArray<FAutoPaintMemoryEntry>& OutEntries)
+	{
+		for (const UAutoPaintData* Data : TObjectRange<UAutoPaintData>())
+		{
+			int64 Bytes = AutoPaintMemory::GetTextureBytes(Data->TextureAsset);
+			for (const TSoftObjectPtr<UTexture>& Tile : Data->TextureTiles)
+			{
+				Bytes += AutoPaintMemory::GetTextureBytes(Tile.Get());
+			}
+			OutEntries.Add({ TEXT("Assets"), Data->GetPathName(), Bytes });
+		}
+	}
+}
+
 void FAutoPaintEditorModule::StartupModule()
 {
 	if (FModuleManager::Get().IsModuleLoaded("ContentBrowser"))
@@ -23,10 +45,18 @@ void FAutoPaintEditorModule::StartupModule()
 		AssetTypeAction = MakeShared<FAssetTypeActions_AutoPaintSettings>();
 		AssetTools.RegisterAssetTypeActions(AssetTypeAction.ToSharedRef());
 	}
+
+	GatherAssetMemoryHandle = AutoPaintMemory::OnGather().AddStatic(&AutoPaintEditorModule::GatherAssetMemory);
+	GatherCaptureMemoryHandle = AutoPaintMemory::OnGather().AddStatic(&FAutoPaintCaptureService::GatherMemory);
 }
 
 void FAutoPaintEditorModule::ShutdownModule()
 {
+	AutoPaintMemory::OnGather().Remove(GatherAssetMemoryHandle);
+	AutoPaintMemory::OnGather().Remove(GatherCaptureMemoryHandle);
+
+	FAutoPaintCaptureService::Shutdown();
+
 	if (FModuleManager::Get().IsModuleLoaded("ContentBrowser"))
 	{
 		FContentBrowserModule& ContentBrowserModule = FModuleManager::LoadModuleChecked<FContentBrowserModule>(TEXT("ContentBrowser"));
@@ -5,15 +5,26 @@
 
 #include "AdvancedPreviewScene.h"
 #include "AutoPaintCaptureSettings.h"
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintCapturer.h"
 #include "AutoPaintData.h"
+#include "AutoPaintMemory.h"
 #include "SAutoPaintEditorViewport.h"
+#include "SAutoPaintMemoryPanel.h"
 #include "Components/StaticMeshComponent.h"
-#include "Components/SceneCaptureComponent2D.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "Materials/MaterialInstanceDynamic.h"
 
 const FName FAutoPaintEditorToolkit::ViewportTabId(TEXT("AutoPaintEditor_Viewport"));
 const FName FAutoPaintEditorToolkit::DetailsTabId(TEXT("AutoPaintEditor_Details"));
 const FName FAutoPaintEditorToolkit::SettingsTabId(TEXT("AutoPaintEditor_Settings"));
+const FName FAutoPaintEditorToolkit::MemoryTabId(TEXT("AutoPaintEditor_Memory"));
+
+FAutoPaintEditorToolkit::~FAutoPaintEditorToolkit()
+{
+	AutoPaintMemory::OnGather().Remove(GatherMemoryHandle);
+	ReleaseCapturedRT();
+}
 
 void FAutoPaintEditorToolkit::RegisterTabSpawners(const TSharedRef<FTabManager>& InTabManager)
 {
@@ -62,10 +73,89 @@ void FAutoPaintEditorToolkit::AddReferencedObjects(FReferenceCollector& Collecto
 	Collector.AddReferencedObject(EditAsset);
 	Collector.AddReferencedObject(PreviewMeshComponent);
 	Collector.AddReferencedObject(CameraMeshComponent);
-	Collector.AddReferencedObject(SceneCaptureComponent2D);
 	Collector.AddReferencedObject(FloorMeshComponent);
-	Collector.AddReferencedObject(CaptureFloorMeshComponent);
 	Collector.AddReferencedObject(Settings);
+	Collector.AddReferencedObject(CapturedRT);
+	Collector.AddReferencedObject(VisualizeMID);
+}
+
+void FAutoPaintEditorToolkit::NotifyPostChange(const FPropertyChangedEvent& PropertyChangedEvent, FProperty* PropertyThatChanged)
+{
+	const FName PropertyName = PropertyChangedEvent.GetMemberPropertyName();
+	if (PropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintCaptureSettings, bRealtimeViewport))
+	{
+		if (Viewport && Settings)
+		{
+			Viewport->SetRealtime(Settings->bRealtimeViewport);
+		}
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, HeightWPO))
+	{
+		// Only visualization depends on it
+		if (VisualizeMID && EditAsset)
+		{
+			VisualizeMID->SetScalarParameterValue(TEXT("HeightWPO"), EditAsset->HeightWPO);
+		}
+	}
+	else if (PropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, TextureWorldSize))
+	{
+		UpdateFloorMeshComponent();
+	}
+	else if (IsLiveCaptureEnabled())
+	{
+		const EAutoPaintCaptureStages Stages = GetStagesForProperty(PropertyName);
+		if (Stages != EAutoPaintCaptureStages::None)
+		{
+			UpdatePreviewMeshComponent();
+			UpdateCameraComponent();
+			RequestLiveCapture(Stages, PropertyChangedEvent.ChangeType == EPropertyChangeType::Interactive);
+		}
+	}
+
+	RefreshViewport();
+}
+
+void FAutoPaintEditorToolkit::PostUndo(bool bSuccess)
+{
+	UpdatePreviewMeshComponent();
+	UpdateCameraComponent();
+	UpdateFloorMeshComponent();
+
+	if (VisualizeMID && EditAsset)
+	{
+		VisualizeMID->SetScalarParameterValue(TEXT("HeightWPO"), EditAsset->HeightWPO);
+	}
+
+	if (IsLiveCaptureEnabled())
+	{
+		RequestLiveCapture(EAutoPaintCaptureStages::All, false);
+	}
+
+	RefreshViewport();
+}
+
+EAutoPaintCaptureStages FAutoPaintEditorToolkit::GetStagesForProperty(FName InPropertyName)
+{
+	if (InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, BlurDistance))
+	{
+		return EAutoPaintCaptureStages::PostProcess;
+	}
+
+	if (InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, WorldOffset) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, SceneCaptureResolution) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CaptureSamples) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CaptureFilter) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, SectionLayers) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, ProjectionType) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CameraDistance) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CameraRotation) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CameraFOV) ||
+		InPropertyName == GET_MEMBER_NAME_CHECKED(UAutoPaintData, CameraOrthoWidth))
+	{
+		return EAutoPaintCaptureStages::All;
+	}
+
+	return EAutoPaintCaptureStages::None;
 }
 
 void FAutoPaintEditorToolkit::InitAutoPaintAssetEditor(EToolkitMode::Type Mode,
@@ -74,30 +164,32 @@ void FAutoPaintEditorToolkit::InitAutoPaintAssetEditor(EToolkitMode::Type Mode,
 	EditAsset = Cast<UAutoPaintData>(ObjectToEdit);
 	EditAsset->SetFlags(RF_Transactional);
 
-	Settings = NewObject<UAutoPaintCaptureSettings>(GetTransientPackage());
+	Settings = FAutoPaintCaptureService::Get().GetSettings();
+	bLiveCapture = Settings && Settings->bLiveCapture;
 	UpdateMIDs();
 	
 	PreviewMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
 	UpdatePreviewMeshComponent();
 
-	SceneCaptureComponent2D = NewObject<USceneCaptureComponent2D>(GetTransientPackage(), NAME_None, RF_Transient);
 	CameraMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
 	UpdateCameraComponent();
 
 	FloorMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
 	UpdateFloorMeshComponent();
 	
-	CaptureFloorMeshComponent = NewObject<UStaticMeshComponent>(GetTransientPackage(), NAME_None, RF_Transient);
-	UpdateCaptureFloorMeshComponent();
-	
 	UpdateVisualizeMID((EditAsset) ? EditAsset->TextureAsset : nullptr);
 
 	GEditor->RegisterForUndo(this);
 
+	GatherMemoryHandle = AutoPaintMemory::OnGather().AddSPLambda(this, [this](TArray<FAutoPaintMemoryEntry>& OutEntries)
+	{
+		OutEntries.Add({ TEXT("Editors"), EditAsset ? EditAsset->GetName() : FString(), AutoPaintMemory::GetTextureBytes(CapturedRT) });
+	});
+
 	CreateInternalWidgets();
 
 	// clang-format off
-	TSharedRef<FTabManager::FLayout> StandaloneDefaultLayout = FTabManager::NewLayout( "Standalone_AutoPaintEditor_Layout_v1.1" )
+	TSharedRef<FTabManager::FLayout> StandaloneDefaultLayout = FTabManager::NewLayout( "Standalone_AutoPaintEditor_Layout_v1.2" )
 	->AddArea
 	(
 		FTabManager::NewPrimaryArea() ->SetOrientation(Orient_Vertical)
@@ -116,6 +208,7 @@ void FAutoPaintEditorToolkit::InitAutoPaintAssetEditor(EToolkitMode::Type Mode,
 				->SetSizeCoefficient(0.3f)
 				->AddTab( DetailsTabId, ETabState::OpenedTab )
 				->AddTab( SettingsTabId, ETabState::OpenedTab)
+				->AddTab( MemoryTabId, ETabState::OpenedTab)
 				->SetForegroundTab(DetailsTabId)
 			)
 		)
@@ -155,6 +248,8 @@ void FAutoPaintEditorToolkit::CreateInternalWidgets()
 	
 	Viewport = SNew(SAutoPaintEditorViewport)
 	.AutoPaintEditorPtr(SharedThis(this));
+
+	MemoryPanel = SNew(SAutoPaintMemoryPanel);
 }
 
 void FAutoPaintEditorToolkit::BuildToolbar(FToolBarBuilder& ToolBarBuilder)
@@ -181,6 +276,17 @@ void FAutoPaintEditorToolkit::BuildToolbar(FToolBarBuilder& ToolBarBuilder)
 			INVTEXT("Captures mesh to render targets"),
 			FSlateIcon(FAppStyle::GetAppStyleSetName(), "ClassIcon.SceneCaptureComponent2D"));
 
+		ToolBarBuilder.AddToolBarButton(
+			FUIAction(
+				FExecuteAction::CreateSP(this, &FAutoPaintEditorToolkit::ToggleLiveCapture),
+				FCanExecuteAction(),
+				FIsActionChecked::CreateSP(this, &FAutoPaintEditorToolkit::IsLiveCaptureEnabled)),
+			NAME_None,
+			INVTEXT("Live"),
+			INVTEXT("Recapture while editing properties, re-running only affected stages"),
+			FSlateIcon(FAppStyle::GetAppStyleSetName(), "Icons.Refresh"),
+			EUserInterfaceActionType::ToggleButton);
+
 		ToolBarBuilder.AddToolBarButton(
 			FUIAction(FExecuteAction::CreateLambda([this]
 			{
@@ -199,6 +305,7 @@ void FAutoPaintEditorToolkit::RegisterTabs(TArray<FTab>& OutTabs) const
 	OutTabs.Add({ ViewportTabId, INVTEXT("Viewport"), "LevelEditor.Tabs.Viewports", Viewport });
 	OutTabs.Add({ DetailsTabId, INVTEXT("Details"), "LevelEditor.Tabs.Details", DetailsView });
 	OutTabs.Add({ SettingsTabId, INVTEXT("Settings"), "LevelEditor.Tabs.Details", SettingsView });
+	OutTabs.Add({ MemoryTabId, INVTEXT("Memory"), "LevelEditor.Tabs.StatsViewer", MemoryPanel });
 }
 
 UStaticMesh* FAutoPaintEditorToolkit::GetEditAssetStaticMesh() const
@@ -228,11 +335,6 @@ void FAutoPaintEditorToolkit::UpdatePreviewMeshComponent()
 	}
 }
 
-USceneCaptureComponent2D* FAutoPaintEditorToolkit::GetCaptureComponent() const
-{
-	return SceneCaptureComponent2D;
-}
-
 UStaticMeshComponent* FAutoPaintEditorToolkit::GetCameraComponent() const
 {
 	return CameraMeshComponent;
@@ -240,45 +342,14 @@ UStaticMeshComponent* FAutoPaintEditorToolkit::GetCameraComponent() const
 
 void FAutoPaintEditorToolkit::UpdateCameraComponent()
 {
-	if (SceneCaptureComponent2D)
+	if (CameraMeshComponent)
 	{
-		TArray<FEngineShowFlagsSetting> ShowFlagsSettings;
-		ShowFlagsSettings.Add({"AmbientOcclusion", false});
-		ShowFlagsSettings.Add({"Fog", false});
-		ShowFlagsSettings.Add({"AtmosphericFog", false});
-		ShowFlagsSettings.Add({ TEXT("NaniteMeshes"), false });
-		ShowFlagsSettings.Add({ TEXT("Atmosphere"), false });
-		ShowFlagsSettings.Add({ TEXT("Bloom"), false });
-		ShowFlagsSettings.Add({ TEXT("Lighting"), false });
-
-		SceneCaptureComponent2D->ShowFlagSettings = ShowFlagsSettings;
-		SceneCaptureComponent2D->bCaptureEveryFrame = false;
-		SceneCaptureComponent2D->bCaptureOnMovement = false;
-		SceneCaptureComponent2D->PrimitiveRenderMode = ESceneCapturePrimitiveRenderMode::PRM_UseShowOnlyList;
-		SceneCaptureComponent2D->PostProcessBlendWeight = 1.f;
-
-		if (Settings)
-		{
-			SceneCaptureComponent2D->CaptureSource = Settings->CaptureSource;
-		}
-
 		if (EditAsset)
 		{
-			SceneCaptureComponent2D->ProjectionType = EditAsset->ProjectionType;
-			SceneCaptureComponent2D->OrthoWidth = EditAsset->CameraOrthoWidth;
-			SceneCaptureComponent2D->FOVAngle = EditAsset->CameraFOV;
-			
+			// Mirrors the capture camera placement, see FAutoPaintCapturer::UpdateCaptureComponent
 			const FVector Location = FVector::UpVector * EditAsset->CameraDistance;
-			SceneCaptureComponent2D->SetRelativeLocation(Location);
-			SceneCaptureComponent2D->SetRelativeRotation(EditAsset->CameraRotation);
-			SceneCaptureComponent2D->UpdateBounds();
-		}
-	}
-	if (CameraMeshComponent)
-	{
-		if (SceneCaptureComponent2D)
-		{
-			CameraMeshComponent->SetupAttachment(SceneCaptureComponent2D);
+			CameraMeshComponent->SetRelativeLocation(Location);
+			CameraMeshComponent->SetRelativeRotation(EditAsset->CameraRotation);
 		}
 		if (!CameraMeshComponent->GetStaticMesh())
 		{
@@ -309,28 +380,9 @@ void FAutoPaintEditorToolkit::UpdateFloorMeshComponent()
 			FloorMeshComponent->SetStaticMesh(LoadObject<UStaticMesh>(nullptr, TEXT("/AutoPaint/Resources/Meshes/S_VisualizePlane.S_VisualizePlane")));
 		}
 
-		if (Settings && Settings->VisualizeMID)
+		if (VisualizeMID)
 		{
-			FloorMeshComponent->SetMaterial(0, Settings->VisualizeMID);
-		}
-	}
-}
-
-UStaticMeshComponent* FAutoPaintEditorToolkit::GetCaptureFloorMeshComponent() const
-{
-	return CaptureFloorMeshComponent;
-}
-
-void FAutoPaintEditorToolkit::UpdateCaptureFloorMeshComponent()
-{
-	if (CaptureFloorMeshComponent)
-	{
-		CaptureFloorMeshComponent->SetRelativeLocation(FVector::ZeroVector);
-		CaptureFloorMeshComponent->SetRelativeScale3D(FVector::OneVector * 10);
-		
-		if (!CaptureFloorMeshComponent->GetStaticMesh())
-		{
-			CaptureFloorMeshComponent->SetStaticMesh(LoadObject<UStaticMesh>(nullptr, TEXT("/AutoPaint/Resources/Meshes/S_RenderPlane.S_RenderPlane")));
+			FloorMeshComponent->SetMaterial(0, VisualizeMID);
 		}
 	}
 }
@@ -340,91 +392,101 @@ FBoxSphereBounds FAutoPaintEditorToolkit::GetComponentsBounds() const
 	FBox Box(ForceInit);
 	if (GetPreviewMeshComponent())
 		Box += GetPreviewMeshComponent()->Bounds.GetBox();
-	if (GetCaptureComponent())
-		Box += GetCaptureComponent()->Bounds.GetBox();
+	if (GetCameraComponent())
+		Box += GetCameraComponent()->Bounds.GetBox();
 	const FVector Extents = Box.GetExtent() * 1.5;
 	return FBoxSphereBounds(Box.GetCenter(), Extents, Extents.Size());
 }
 
 void FAutoPaintEditorToolkit::Capture()
 {
-	UpdateRenderTargets();
 	UpdatePreviewMeshComponent();
 	UpdateCameraComponent();
 	UpdateFloorMeshComponent();
-	
-	// Capture
-	if (SceneCaptureComponent2D)
-	{
-		if (Settings && Settings->SceneCaptureRT)
-			SceneCaptureComponent2D->TextureTarget = Settings->SceneCaptureRT;
-		
-		SceneCaptureComponent2D->ClearShowOnlyComponents();
-		SceneCaptureComponent2D->ShowOnlyActors.Empty();
-
-		if (PreviewMeshComponent && PreviewMeshComponent->GetStaticMesh())
-		{
-			SceneCaptureComponent2D->ShowOnlyComponent(PreviewMeshComponent);
-		}
-		if (CaptureFloorMeshComponent && CaptureFloorMeshComponent->GetStaticMesh())
-		{
-			SceneCaptureComponent2D->ShowOnlyComponent(CaptureFloorMeshComponent);
-		}
-		SceneCaptureComponent2D->CaptureScene();
-
-		// Avoid keeping references to Captured components
-		SceneCaptureComponent2D->ClearShowOnlyComponents();
-		SceneCaptureComponent2D->TextureTarget = nullptr;
-	}
 
-	// Draw
-	if (Settings)
+	if (EditAsset && EditAsset->IsTiledCapture())
 	{
-		if (TObjectPtr<UMaterialInstanceDynamic>& MID = Settings->NormalizeDrawMID)
+		// Tiles go straight to disk, there is no single Final RT to preview
+		FAutoPaintTileCaptureStats TileStats;
+		if (!FAutoPaintCaptureService::Get().CaptureTiles(EditAsset, TileStats))
 		{
-			MID->SetScalarParameterValue(TEXT("CameraDistance"), EditAsset->CameraDistance);
-			// @todo: pivot isn't bottom point?
-			MID->SetScalarParameterValue(TEXT("ObjectHeight"), PreviewMeshComponent->Bounds.BoxExtent.Z * 2.f);
+			// @todo: Error
+			return;
 		}
-
-		if (TObjectPtr<UMaterialInstanceDynamic>& MID = Settings->PostProcessDrawMID)
-		{
-			MID->SetScalarParameterValue(TEXT("Distance"), EditAsset->BlurDistance);
-		}
-		
-		Settings->Draw();
+		RefreshViewport();
+		return;
 	}
 
-	// Update
-	UpdateVisualizeMID(Settings ? Settings->FinalRT : nullptr);
+	FAutoPaintCaptureService::Get().RequestCapture(EditAsset, FOnAutoPaintCaptureComplete::CreateSP(this, &FAutoPaintEditorToolkit::OnCaptureComplete));
 }
 
-void FAutoPaintEditorToolkit::UpdateRenderTargets()
+void FAutoPaintEditorToolkit::RequestLiveCapture(EAutoPaintCaptureStages InStages, bool bInInteractive)
 {
-	if (!EditAsset)
+	if (!EditAsset || !Settings)
 	{
 		// @todo: Error
 		return;
 	}
 
-	if (!Settings)
+	if (EditAsset->IsTiledCapture())
+	{
+		// Tiled capture saves packages, only run it on explicit Capture
+		return;
+	}
+
+	// Committed values run on next tick, drags wait until they pause
+	const float Delay = bInInteractive ? Settings->LiveCaptureDebounce : 0.f;
+	FAutoPaintCaptureService::Get().RequestCapture(EditAsset, FOnAutoPaintCaptureComplete::CreateSP(this, &FAutoPaintEditorToolkit::OnCaptureComplete), InStages, Delay);
+}
+
+bool FAutoPaintEditorToolkit::IsLiveCaptureEnabled() const
+{
+	return bLiveCapture;
+}
+
+void FAutoPaintEditorToolkit::ToggleLiveCapture()
+{
+	bLiveCapture = !bLiveCapture;
+}
+
+void FAutoPaintEditorToolkit::OnCaptureComplete(UTextureRenderTarget2D* InFinalRT)
+{
+	ReleaseCapturedRT();
+	CapturedRT = InFinalRT;
+
+	if (!CapturedRT)
 	{
 		// @todo: Error
 		return;
 	}
 
-	Settings->CreateOrUpdateRenderTarget(EditAsset->SceneCaptureResolution);
+	// Update
+	UpdateVisualizeMID(CapturedRT);
+	RefreshViewport();
+}
+
+void FAutoPaintEditorToolkit::ReleaseCapturedRT()
+{
+	if (CapturedRT)
+	{
+		if (FAutoPaintCaptureService* CaptureService = FAutoPaintCaptureService::TryGet())
+		{
+			CaptureService->ReleaseTarget(CapturedRT);
+		}
+		CapturedRT = nullptr;
+	}
 }
 
 void FAutoPaintEditorToolkit::ClearRenderTargets()
 {
-	if (!Settings)
+	if (!CapturedRT)
 	{
 		// @todo: Error
 		return;
 	}
 
-	Settings->ClearRenderTarget();
+	FAutoPaintCaptureService::Get().ClearTarget(CapturedRT);
+	RefreshViewport();
 }
 
 void FAutoPaintEditorToolkit::UpdateMIDs()
@@ -435,9 +497,7 @@ void FAutoPaintEditorToolkit::UpdateMIDs()
 		return;
 	}
 	
-	Settings->NormalizeDrawMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(Settings->NormalizeDrawMID, TEXT("Normalize MID"), Settings->GetDefaultNormalizeDrawMaterial());
-	Settings->PostProcessDrawMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(Settings->PostProcessDrawMID, TEXT("Final MID"), Settings->GetDefaultPostProcessDrawMaterial());
-	Settings->VisualizeMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(Settings->VisualizeMID, TEXT("Visualize MID"), Settings->GetDefaultVisualizeMaterial());
+	VisualizeMID = UAutoPaintCaptureSettings::GetOrCreateTransientMID(VisualizeMID, TEXT("Visualize MID"), Settings->GetDefaultVisualizeMaterial());
 }
 
 void FAutoPaintEditorToolkit::UpdateVisualizeMID(UTexture* InTexture)
@@ -454,20 +514,19 @@ void FAutoPaintEditorToolkit::UpdateVisualizeMID(UTexture* InTexture)
 		return;
 	}
 
-	TObjectPtr<UMaterialInstanceDynamic>& MID = Settings->VisualizeMID;
-	if (!MID)
+	if (!VisualizeMID)
 	{
 		// @todo: Error
 		return;
 	}
 
-	MID->SetTextureParameterValue(TEXT("Texture"), InTexture);
-	MID->SetScalarParameterValue(TEXT("HeightWPO"), EditAsset->HeightWPO);
+	VisualizeMID->SetTextureParameterValue(TEXT("Texture"), InTexture);
+	VisualizeMID->SetScalarParameterValue(TEXT("HeightWPO"), EditAsset->HeightWPO);
 }
 
 void FAutoPaintEditorToolkit::SetTextureToData()
 {
-	if (!Settings)
+	if (!CapturedRT)
 	{
 		// @todo: Error
 		return;
@@ -479,7 +538,16 @@ void FAutoPaintEditorToolkit::SetTextureToData()
 		return;
 	}
 
-	EditAsset->TextureAsset = Settings->RenderTargetCreateStaticTextureEditorOnly(Settings->FinalRT, TEXT("T_AP_TextureAsset"), EditAsset);
+	FAutoPaintCaptureService::Get().SaveTexture(EditAsset, CapturedRT);
 
 	UpdateVisualizeMID(EditAsset->TextureAsset);
+	RefreshViewport();
+}
+
+void FAutoPaintEditorToolkit::RefreshViewport() const
+{
+	if (Viewport)
+	{
+		Viewport->RefreshViewport();
+	}
 }
@@ -6,11 +6,15 @@
 #include "Misc/NotifyHook.h"
 #include "EditorUndoClient.h"
 
+enum class EAutoPaintCaptureStages : uint8;
+
 class UAutoPaintData;
 class SAutoPaintEditorViewport;
+class SAutoPaintMemoryPanel;
 class UStaticMeshComponent;
-class USceneCaptureComponent2D;
 class UAutoPaintCaptureSettings;
+class UMaterialInstanceDynamic;
+class UTextureRenderTarget2D;
 
 class FAutoPaintEditorToolkit final : public FAssetEditorToolkit, public FGCObject, public FNotifyHook, public FEditorUndoClient
 {
@@ -24,6 +28,8 @@ class FAutoPaintEditorToolkit final : public FAssetEditorToolkit, public FGCObje
 	
 public:
 	const FString ToolkitName = "AutoPaintEditor";
+
+	virtual ~FAutoPaintEditorToolkit() override;
 	
 	//~ Begin IToolkit Interface
 	virtual void RegisterTabSpawners(const TSharedRef<FTabManager>& InTabManager) override;
@@ -39,6 +45,15 @@ public:
 	virtual FString GetReferencerName() const override { return ToolkitName; }
 	//~ End FGCObject Interface
 
+	//~ Begin FNotifyHook Interface
+	virtual void NotifyPostChange(const FPropertyChangedEvent& PropertyChangedEvent, FProperty* PropertyThatChanged) override;
+	//~ End FNotifyHook Interface
+
+	//~ Begin FEditorUndoClient Interface
+	virtual void PostUndo(bool bSuccess) override;
+	virtual void PostRedo(bool bSuccess) override { PostUndo(bSuccess); }
+	//~ End FEditorUndoClient Interface
+
 	void InitAutoPaintAssetEditor(EToolkitMode::Type Mode, const TSharedPtr<IToolkitHost>& InitToolkitHost, UObject* ObjectToEdit);
 
 	UStaticMesh* GetEditAssetStaticMesh() const;
@@ -46,21 +61,23 @@ public:
 	UMeshComponent* GetPreviewMeshComponent() const;
 	void UpdatePreviewMeshComponent();
 
-	USceneCaptureComponent2D* GetCaptureComponent() const;
 	UStaticMeshComponent* GetCameraComponent() const;
 	void UpdateCameraComponent();
 
 	UStaticMeshComponent* GetFloorMeshComponent() const;
 	void UpdateFloorMeshComponent();
 
-	UStaticMeshComponent* GetCaptureFloorMeshComponent() const;
-	void UpdateCaptureFloorMeshComponent();
-
 	FBoxSphereBounds GetComponentsBounds() const;
 
+	/** Queues capture on the shared capture service */
 	void Capture();
+
+	/** Live mode: queues debounced capture of only the given stages */
+	void RequestLiveCapture(EAutoPaintCaptureStages InStages, bool bInInteractive);
+
+	bool IsLiveCaptureEnabled() const;
+	void ToggleLiveCapture();
 	
-	void UpdateRenderTargets();
 	void ClearRenderTargets();
 
 	void UpdateMIDs();
@@ -69,6 +86,9 @@ public:
 
 	void SetTextureToData();
 
+	/** Viewport isn't realtime by default, call after anything visible in it changes */
+	void RefreshViewport() const;
+
 private:
 	TObjectPtr<UAutoPaintData> EditAsset = nullptr;
 	
@@ -76,13 +96,27 @@ private:
 	TObjectPtr<UStaticMeshComponent> PreviewMeshComponent = nullptr;
 	TObjectPtr<UStaticMeshComponent> CameraMeshComponent = nullptr;
 	TObjectPtr<UStaticMeshComponent> FloorMeshComponent = nullptr;
-	TObjectPtr<UStaticMeshComponent> CaptureFloorMeshComponent = nullptr;
-
-	/** Component for capture render targets */
-	TObjectPtr<USceneCaptureComponent2D> SceneCaptureComponent2D = nullptr;
 
+	/** Shared capture settings, owned by FAutoPaintCaptureService */
 	TObjectPtr<UAutoPaintCaptureSettings> Settings = nullptr;
 
+	/** Live capture of this editor only, starts from UAutoPaintCaptureSettings::bLiveCapture */
+	bool bLiveCapture = true;
+
+	/** Last captured Final RT, leased from FAutoPaintCaptureService */
+	TObjectPtr<UTextureRenderTarget2D> CapturedRT = nullptr;
+
+	TObjectPtr<UMaterialInstanceDynamic> VisualizeMID = nullptr;
+
+	void OnCaptureComplete(UTextureRenderTarget2D* InFinalRT);
+	void ReleaseCapturedRT();
+
+	/** Reports CapturedRT under the edited asset, see AutoPaintMemory::OnGather */
+	FDelegateHandle GatherMemoryHandle;
+
+	/** Maps edited asset property to the capture stages it invalidates */
+	static EAutoPaintCaptureStages GetStagesForProperty(FName InPropertyName);
+
 	TSharedPtr<SAutoPaintEditorViewport> Viewport;
 
 	void CreateInternalWidgets();
@@ -93,9 +127,11 @@ private:
 
 	TSharedPtr<IDetailsView> DetailsView;
 	TSharedPtr<IDetailsView> SettingsView;
+	TSharedPtr<SAutoPaintMemoryPanel> MemoryPanel;
 
 	/**	Graph editor tab */
 	static const FName ViewportTabId;
 	static const FName DetailsTabId;
 	static const FName SettingsTabId;
+	static const FName MemoryTabId;
 };
\ No newline at end of file
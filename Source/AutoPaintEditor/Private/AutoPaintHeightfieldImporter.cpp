@@ -0,0 +1,351 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintHeightfieldImporter.h"
+
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintCaptureSettings.h"
+#include "AutoPaintData.h"
+#include "AutoPaintStats.h"
+#include "ImageCore.h"
+#include "ImageUtils.h"
+#include "Async/MappedFileHandle.h"
+#include "Async/ParallelFor.h"
+#include "Async/TaskGraphInterfaces.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Dom/JsonObject.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/StrongObjectPtr.h"
+
+DECLARE_CYCLE_STAT(TEXT("Import Heightfield"), STAT_AutoPaint_ImportHeightfield, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Convert Heightfield Tiles"), STAT_AutoPaint_ConvertHeightfieldTiles, STATGROUP_AutoPaint);
+
+namespace AutoPaintHeightfieldImport
+{
+	struct FSidecar
+	{
+		FIntPoint RawSize = FIntPoint::ZeroValue;
+		TOptional<FVector2D> WorldSize;
+		TOptional<float> HeightRange;
+		double InputMin = 0.0;
+		double InputMax = 1.0;
+	};
+
+	bool LoadSidecar(const FString& InPath, FSidecar& OutSidecar, FString& OutError)
+	{
+		FString Text;
+		if (!FFileHelper::LoadFileToString(Text, *InPath))
+		{
+			UE_LOG(LogAutoPaintCapture, Warning, TEXT("No sidecar at %s, Texture World Size and Height WPO are kept"), *InPath);
+			return true;
+		}
+
+		TSharedPtr<FJsonObject> Root;
+		if (!FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Text), Root) || !Root.IsValid())
+		{
+			OutError = FString::Printf(TEXT("Failed to parse sidecar %s"), *InPath);
+			return false;
+		}
+
+		Root->TryGetNumberField(TEXT("Width"), OutSidecar.RawSize.X);
+		Root->TryGetNumberField(TEXT("Height"), OutSidecar.RawSize.Y);
+
+		double WorldSizeX = 0.0, WorldSizeY = 0.0;
+		if (Root->TryGetNumberField(TEXT("WorldSizeX"), WorldSizeX) && Root->TryGetNumberField(TEXT("WorldSizeY"), WorldSizeY))
+		{
+			OutSidecar.WorldSize = FVector2D(WorldSizeX, WorldSizeY);
+		}
+
+		double HeightRange = 0.0;
+		if (Root->TryGetNumberField(TEXT("HeightRange"), HeightRange))
+		{
+			OutSidecar.HeightRange = static_cast<float>(HeightRange);
+		}
+
+		Root->TryGetNumberField(TEXT("InputMin"), OutSidecar.InputMin);
+		Root->TryGetNumberField(TEXT("InputMax"), OutSidecar.InputMax);
+		if (OutSidecar.InputMax == OutSidecar.InputMin)
+		{
+			OutError = FString::Printf(TEXT("Sidecar %s: InputMin and InputMax are equal"), *InPath);
+			return false;
+		}
+		return true;
+	}
+
+	/** Source heights, either rows of a memory-mapped RAW or a decoded image */
+	class FSource
+	{
+	public:
+		bool Open(const FString& InPath, const FIntPoint& InRawSize, FString& OutError)
+		{
+			const FString Extension = FPaths::GetExtension(InPath);
+			if (Extension.Equals(TEXT("raw"), ESearchCase::IgnoreCase) || Extension.Equals(TEXT("r16"), ESearchCase::IgnoreCase))
+			{
+				MappedFile.Reset(FPlatformFileManager::Get().GetPlatformFile().OpenMapped(*InPath));
+				if (!MappedFile)
+				{
+					OutError = FString::Printf(TEXT("Failed to map %s"), *InPath);
+					return false;
+				}
+
+				const int64 FileSize = MappedFile->GetFileSize();
+				Size = InRawSize;
+				if (Size.X <= 0 || Size.Y <= 0)
+				{
+					Size = FIntPoint(FMath::FloorToInt32(FMath::Sqrt(static_cast<double>(FileSize / sizeof(uint16)))));
+				}
+				if (Size.X <= 0 || static_cast<int64>(Size.X) * Size.Y * sizeof(uint16) != FileSize)
+				{
+					OutError = FString::Printf(TEXT("%s: %dx%d doesn't match %lld bytes of 16 bit heights, set Width and Height in the sidecar"),
+						*InPath, Size.X, Size.Y, FileSize);
+					return false;
+				}
+				return true;
+			}
+
+			FImage Image;
+			if (!FImageUtils::LoadImage(*InPath, Image))
+			{
+				OutError = FString::Printf(TEXT("Failed to decode %s"), *InPath);
+				return false;
+			}
+			Image.ChangeFormat(ERawImageFormat::R32F, EGammaSpace::Linear);
+			Size = FIntPoint(Image.SizeX, Image.SizeY);
+			DecodedHeights = MoveTemp(Image.RawData);
+			return true;
+		}
+
+		FIntPoint GetSize() const { return Size; }
+		bool IsMapped() const { return MappedFile.IsValid(); }
+
+		/** Maps the rows of InRect, only the pages of its columns are touched. Nothing to map for decoded images. */
+		TUniquePtr<IMappedFileRegion> MapRows(const FIntRect& InRect) const
+		{
+			if (!MappedFile)
+			{
+				return nullptr;
+			}
+			const int64 RowBytes = static_cast<int64>(Size.X) * sizeof(uint16);
+			return TUniquePtr<IMappedFileRegion>(MappedFile->MapRegion(InRect.Min.Y * RowBytes, InRect.Height() * RowBytes));
+		}
+
+		/** 16 bit patch heights of InRect, thread safe. InRows is the region mapped for InRect. */
+		void ConvertTile(const FIntRect& InRect, const IMappedFileRegion* InRows, double InInputMin, double InInputMax, TArray<uint16>& OutPixels) const
+		{
+			const double InputScale = 1.0 / (InInputMax - InInputMin);
+			auto Encode = [InInputMin, InputScale](double Value)
+			{
+				const double Stored = FMath::Clamp((Value - InInputMin) * InputScale, 0.0, 1.0);
+				return static_cast<uint16>(FMath::RoundToInt(Stored * 65535.0));
+			};
+
+			const int32 Width = InRect.Width();
+			OutPixels.SetNumUninitialized(InRect.Area());
+			for (int32 Y = InRect.Min.Y; Y < InRect.Max.Y; ++Y)
+			{
+				uint16* OutRow = OutPixels.GetData() + static_cast<int64>(Y - InRect.Min.Y) * Width;
+				if (InRows)
+				{
+					const uint16* Row = reinterpret_cast<const uint16*>(InRows->GetMappedPtr()) + static_cast<int64>(Y - InRect.Min.Y) * Size.X;
+					for (int32 X = InRect.Min.X; X < InRect.Max.X; ++X)
+					{
+						OutRow[X - InRect.Min.X] = Encode(Row[X] / 65535.0);
+					}
+				}
+				else
+				{
+					const float* Row = reinterpret_cast<const float*>(DecodedHeights.GetData()) + static_cast<int64>(Y) * Size.X;
+					for (int32 X = InRect.Min.X; X < InRect.Max.X; ++X)
+					{
+						OutRow[X - InRect.Min.X] = Encode(Row[X]);
+					}
+				}
+			}
+		}
+
+	private:
+		FIntPoint Size = FIntPoint::ZeroValue;
+		TUniquePtr<IMappedFileHandle> MappedFile;
+		/** R32F, only for compressed sources */
+		TArray64<uint8> DecodedHeights;
+	};
+}
+
+FString FAutoPaintHeightfieldImporter::GetDefaultSidecarPath(const FString& InSourcePath)
+{
+	return FPaths::ChangeExtension(InSourcePath, TEXT("json"));
+}
+
+bool FAutoPaintHeightfieldImporter::Import(UAutoPaintData* InData, const FString& InSourcePath, const FString& InSidecarPath, int32 InTileSize,
+	FAutoPaintHeightfieldImportStats& OutStats, FString& OutError)
+{
+	using namespace AutoPaintHeightfieldImport;
+
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_ImportHeightfield);
+	LLM_SCOPE_BYTAG(AutoPaint);
+
+	if (!InData || InTileSize <= 0)
+	{
+		OutError = TEXT("No asset or tile size");
+		return false;
+	}
+
+	// Asset may be referenced only from caller stack, GC runs between batches
+	TStrongObjectPtr<UAutoPaintData> DataGuard(InData);
+
+	FSidecar Sidecar;
+	if (!LoadSidecar(InSidecarPath, Sidecar, OutError))
+	{
+		return false;
+	}
+
+	FSource Source;
+	if (!Source.Open(InSourcePath, Sidecar.RawSize, OutError))
+	{
+		return false;
+	}
+
+	const FIntPoint Size = Source.GetSize();
+	OutStats = FAutoPaintHeightfieldImportStats();
+	OutStats.SourceSize = Size;
+
+	if (Sidecar.WorldSize.IsSet())
+	{
+		InData->TextureWorldSize = Sidecar.WorldSize.GetValue();
+	}
+	if (Sidecar.HeightRange.IsSet())
+	{
+		InData->HeightWPO = Sidecar.HeightRange.GetValue();
+	}
+	// Tiles are cropped from a source at this resolution, see UAutoPaintLandscapePatchComponent::GetPatchSourceResolution
+	InData->SceneCaptureResolution = Size;
+	InData->ClearSectionMask();
+
+	if (Size.X <= InTileSize && Size.Y <= InTileSize)
+	{
+		TArray<uint16> Pixels;
+		{
+			const FIntRect Rect(FIntPoint::ZeroValue, Size);
+			TUniquePtr<IMappedFileRegion> Rows = Source.MapRows(Rect);
+			if (Source.IsMapped() && !Rows)
+			{
+				OutError = TEXT("Failed to map the source rows");
+				return false;
+			}
+			Source.ConvertTile(Rect, Rows.Get(), Sidecar.InputMin, Sidecar.InputMax, Pixels);
+		}
+		OutStats.BatchWorkingBytes = Pixels.Num() * Pixels.GetTypeSize();
+
+		InData->TextureAsset = UAutoPaintCaptureSettings::CreateStaticHeightTextureEditorOnly(Size, Pixels, FAutoPaintCaptureService::TextureAssetName, InData);
+		if (!InData->TextureAsset)
+		{
+			OutError = TEXT("Failed to create texture");
+			return false;
+		}
+		// The whole heightfield applies, valleys at InputMin included. No distance field, so no mask to fall off along.
+		InData->bTextureHasDistanceField = false;
+		InData->bTextureHasDerivatives = false;
+		InData->MaskUVBounds = FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector);
+		InData->ClearTextureTiles();
+		InData->MarkPackageDirty();
+		return true;
+	}
+
+	OutStats.TileCount = FIntPoint(FMath::DivideAndRoundUp(Size.X, InTileSize), FMath::DivideAndRoundUp(Size.Y, InTileSize));
+	const int32 NumTiles = OutStats.TileCount.X * OutStats.TileCount.Y;
+	const int32 BatchSize = FMath::Clamp(FTaskGraphInterface::Get().GetNumWorkerThreads() + 1, 1, NumTiles);
+	OutStats.BatchWorkingBytes = static_cast<int64>(BatchSize) * InTileSize * InTileSize * sizeof(uint16);
+
+	const FString TilesPath = InData->GetPackage()->GetName() + TEXT("_Tiles");
+
+	TArray<TSoftObjectPtr<UTexture>> Tiles;
+	Tiles.Reserve(NumTiles);
+
+	struct FTile
+	{
+		FIntPoint Coordinates;
+		FIntRect Rect;
+		TUniquePtr<IMappedFileRegion> Rows;
+		TArray<uint16> Pixels;
+	};
+	TArray<FTile> Batch;
+	Batch.Reserve(BatchSize);
+
+	for (int32 FirstTile = 0; FirstTile < NumTiles; FirstTile += BatchSize)
+	{
+		// Mapping isn't guaranteed to be thread safe, only the conversion runs in parallel
+		Batch.Reset();
+		for (int32 TileIndex = FirstTile; TileIndex < FMath::Min(FirstTile + BatchSize, NumTiles); ++TileIndex)
+		{
+			FTile& Tile = Batch.AddDefaulted_GetRef();
+			Tile.Coordinates = FIntPoint(TileIndex % OutStats.TileCount.X, TileIndex / OutStats.TileCount.X);
+			const FIntPoint TileMin = Tile.Coordinates * InTileSize;
+			Tile.Rect = FIntRect(TileMin, FIntPoint(FMath::Min(TileMin.X + InTileSize, Size.X), FMath::Min(TileMin.Y + InTileSize, Size.Y)));
+			Tile.Rows = Source.MapRows(Tile.Rect);
+			if (Source.IsMapped() && !Tile.Rows)
+			{
+				OutError = FString::Printf(TEXT("Failed to map the source rows of tile %d,%d"), Tile.Coordinates.X, Tile.Coordinates.Y);
+				return false;
+			}
+		}
+
+		{
+			SCOPE_CYCLE_COUNTER(STAT_AutoPaint_ConvertHeightfieldTiles);
+			ParallelFor(Batch.Num(), [&Batch, &Source, &Sidecar](int32 Index)
+			{
+				FTile& Tile = Batch[Index];
+				Source.ConvertTile(Tile.Rect, Tile.Rows.Get(), Sidecar.InputMin, Sidecar.InputMax, Tile.Pixels);
+			});
+		}
+
+		for (FTile& Tile : Batch)
+		{
+			// Source pages of the tile aren't needed past the conversion
+			Tile.Rows.Reset();
+
+			const FString TileName = FString::Printf(TEXT("%s_%d_%d"), FAutoPaintCaptureService::TextureAssetName, Tile.Coordinates.X, Tile.Coordinates.Y);
+			UPackage* TilePackage = CreatePackage(*(TilesPath / TileName));
+			UTexture* TileTexture = UAutoPaintCaptureSettings::CreateStaticHeightTextureEditorOnly(Tile.Rect.Size(), Tile.Pixels, TileName, TilePackage);
+			if (!TileTexture)
+			{
+				OutError = FString::Printf(TEXT("Failed to create texture of tile %d,%d"), Tile.Coordinates.X, Tile.Coordinates.Y);
+				return false;
+			}
+			FAssetRegistryModule::AssetCreated(TileTexture);
+
+			if (!FAutoPaintCaptureService::SavePackage(TilePackage))
+			{
+				OutError = FString::Printf(TEXT("Failed to save tile %d,%d"), Tile.Coordinates.X, Tile.Coordinates.Y);
+				return false;
+			}
+			Tiles.Add(TileTexture);
+
+			// On disk now, drop it before the next batch
+			TileTexture->ClearFlags(RF_Standalone);
+			Tile.Pixels.Empty();
+		}
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+
+		const uint64 UsedPhysical = FPlatformMemory::GetStats().UsedPhysical;
+		OutStats.BatchUsedPhysical.Add(UsedPhysical);
+
+		UE_LOG(LogAutoPaintCapture, Log, TEXT("%s: %d of %d tiles, working set %.2f MiB, process %.1f MiB"),
+			*InData->GetName(), Tiles.Num(), NumTiles, OutStats.BatchWorkingBytes / (1024.0 * 1024.0), UsedPhysical / (1024.0 * 1024.0));
+	}
+
+	InData->TextureTiles = MoveTemp(Tiles);
+	InData->TextureTileCount = OutStats.TileCount;
+	InData->TextureTileSize = InTileSize;
+	// Stale single texture would not match the tiles
+	InData->TextureAsset = nullptr;
+	InData->bTextureHasDistanceField = false;
+	InData->bTextureHasDerivatives = false;
+	InData->MaskUVBounds = FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector);
+	InData->MarkPackageDirty();
+
+	return true;
+}
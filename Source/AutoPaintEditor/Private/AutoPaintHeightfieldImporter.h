@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAutoPaintData;
+
+/** Numbers of an import, see FAutoPaintHeightfieldImporter::Import */
+struct FAutoPaintHeightfieldImportStats
+{
+	FIntPoint SourceSize = FIntPoint::ZeroValue;
+	/** Zero when the source fits in a single texture */
+	FIntPoint TileCount = FIntPoint::ZeroValue;
+	/** Converted pixels of the tiles converted in parallel, the mapped source pages are about as many */
+	int64 BatchWorkingBytes = 0;
+	/** Process used physical memory after every batch of tiles */
+	TArray<uint64> BatchUsedPhysical;
+};
+
+/**
+ * Turns a heightfield made in an external tool into AutoPaintData without a mesh or a capture. 16 bit little endian
+ * RAW sources are memory-mapped, tiles only touch the source pages of their own rows and columns. PNG and EXR are
+ * compressed and can't be read per tile, they are decoded as a whole before the tiles are cut.
+ *
+ * Heights are sampled from R like captured ones, but stored as G16 to keep the precision of the source. There is no
+ * distance field or derivatives next to them, so the whole heightfield applies (no mask, shape falloff or derived
+ * weightmaps) and the falloff is the one of tiled captures. Metadata comes from a JSON sidecar:
+ *   Width, Height            RAW size in texels. A square size is inferred from the file size when missing.
+ *   WorldSizeX, WorldSizeY   Texture World Size in cm.
+ *   HeightRange              Height WPO, cm between InputMin and InputMax.
+ *   InputMin, InputMax       Source values at the bottom and the top of the range, 16 bit values are normalized to [0, 1].
+ *                            Defaults to [0, 1], EXR values are used as they are.
+ */
+class FAutoPaintHeightfieldImporter
+{
+public:
+	/**
+	 * Imports InSourcePath into InData. Sources larger than InTileSize are converted in tiles, a batch of tiles in
+	 * parallel, each tile saved to its own package next to the asset and released before the next batch, so memory
+	 * is bounded by the tile size whatever the source size. Assigns TextureTiles, the asset package is left dirty.
+	 */
+	static bool Import(UAutoPaintData* InData, const FString& InSourcePath, const FString& InSidecarPath, int32 InTileSize,
+		FAutoPaintHeightfieldImportStats& OutStats, FString& OutError);
+
+	/** Sidecar next to the source, with a .json extension */
+	static FString GetDefaultSidecarPath(const FString& InSourcePath);
+};
@@ -0,0 +1,86 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintImportCommandlet.h"
+
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintData.h"
+#include "AutoPaintHeightfieldImporter.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+
+UAutoPaintImportCommandlet::UAutoPaintImportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UAutoPaintImportCommandlet::Main(const FString& Params)
+{
+	const double StartTime = FPlatformTime::Seconds();
+
+	FString SourcePath;
+	FString AssetPath;
+	if (!FParse::Value(*Params, TEXT("Source="), SourcePath) || !FParse::Value(*Params, TEXT("Asset="), AssetPath))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Expected -Source=<Path.raw|png|exr> -Asset=/Game/Path/Name"));
+		return 1;
+	}
+
+	FText Reason;
+	if (!FPackageName::IsValidLongPackageName(AssetPath, /*bIncludeReadOnlyRoots = */false, &Reason))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Invalid -Asset %s: %s"), *AssetPath, *Reason.ToString());
+		return 1;
+	}
+
+	FString SidecarPath;
+	if (!FParse::Value(*Params, TEXT("Sidecar="), SidecarPath))
+	{
+		SidecarPath = FAutoPaintHeightfieldImporter::GetDefaultSidecarPath(SourcePath);
+	}
+
+	int32 TileSize = DefaultTileSize;
+	FParse::Value(*Params, TEXT("TileSize="), TileSize);
+	if (TileSize <= 0)
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Invalid -TileSize %d"), TileSize);
+		return 1;
+	}
+
+	// Reimports keep the render settings of the existing asset
+	const FString AssetName = FPackageName::GetLongPackageAssetName(AssetPath);
+	UAutoPaintData* Data = LoadObject<UAutoPaintData>(nullptr, *(AssetPath + TEXT(".") + AssetName), nullptr, LOAD_NoWarn | LOAD_Quiet);
+	if (!Data)
+	{
+		Data = NewObject<UAutoPaintData>(CreatePackage(*AssetPath), FName(*AssetName), RF_Public | RF_Standalone | RF_Transactional);
+		FAssetRegistryModule::AssetCreated(Data);
+	}
+
+	FAutoPaintHeightfieldImportStats Stats;
+	FString Error;
+	if (!FAutoPaintHeightfieldImporter::Import(Data, SourcePath, SidecarPath, TileSize, Stats, Error))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("%s: %s"), *SourcePath, *Error);
+		return 1;
+	}
+
+	if (!FAutoPaintCaptureService::SavePackage(Data->GetPackage()))
+	{
+		UE_LOG(LogAutoPaintCapture, Error, TEXT("Failed to save %s"), *AssetPath);
+		return 1;
+	}
+
+	uint64 PeakUsedPhysical = 0;
+	for (const uint64 UsedPhysical : Stats.BatchUsedPhysical)
+	{
+		PeakUsedPhysical = FMath::Max(PeakUsedPhysical, UsedPhysical);
+	}
+
+	UE_LOG(LogAutoPaintCapture, Display, TEXT("Imported %dx%d %s into %s, %dx%d tiles, working set %.2f MiB, peak process %.1f MiB, done in %.2f s"),
+		Stats.SourceSize.X, Stats.SourceSize.Y, *SourcePath, *AssetPath, Stats.TileCount.X, Stats.TileCount.Y,
+		Stats.BatchWorkingBytes / (1024.0 * 1024.0), PeakUsedPhysical / (1024.0 * 1024.0), FPlatformTime::Seconds() - StartTime);
+	return 0;
+}
@@ -0,0 +1,32 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AutoPaintImportCommandlet.generated.h"
+
+/**
+ * Imports an external 16 bit heightfield as AutoPaintData, see FAutoPaintHeightfieldImporter.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd.exe <Project> -run=AutoPaintImport -Source=<Path.raw|png|exr> -Asset=/Game/Path/Name [-Sidecar=<Path.json>] [-TileSize=2048]
+ *
+ * -Asset     Created when missing, otherwise its texture or tiles are replaced.
+ * -Sidecar   Metadata of the source. Defaults to the source path with a .json extension.
+ * -TileSize  Texels per tile side, sources that fit in one tile are saved as a single texture.
+ */
+UCLASS()
+class UAutoPaintImportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAutoPaintImportCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+	static constexpr int32 DefaultTileSize = 2048;
+};
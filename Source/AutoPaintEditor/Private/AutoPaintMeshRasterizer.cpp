@@ -0,0 +1,267 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintMeshRasterizer.h"
+
+#include "AutoPaintCapturer.h"
+#include "AutoPaintData.h"
+#include "MeshDescription.h"
+#include "StaticMeshAttributes.h"
+#include "Async/ParallelFor.h"
+#include "Engine/StaticMesh.h"
+
+namespace AutoPaintMeshRasterizer
+{
+	struct FTriangle
+	{
+		FVector2f P0, P1, P2;
+		/** 1 / clip W and view depth / clip W per corner, interpolated linearly in screen space */
+		float InvW0, InvW1, InvW2;
+		float DepthOverW0, DepthOverW1, DepthOverW2;
+		FIntRect PixelBounds;
+		/** Section layer channel of the material slot, INDEX_NONE if it isn't captured */
+		int8 Channel;
+	};
+
+	// Rows are rasterized in bands, each band touches only its own rows so bands can run in parallel.
+	static constexpr int32 RowsPerBand = 16;
+}
+
+bool FAutoPaintMeshRasterizer::Rasterize(const UAutoPaintData& InData, TArray<FColor>& OutPixels, TArray<FColor>* OutSectionMask)
+{
+	TArray<float> Heights;
+	TArray<bool> Covered;
+	TArray<int8> SectionChannels;
+	if (!RasterizeHeights(InData, Heights, Covered, OutSectionMask ? &SectionChannels : nullptr))
+	{
+		return false;
+	}
+
+	EncodeHeights(Heights, Covered, OutPixels);
+
+	if (OutSectionMask)
+	{
+		OutSectionMask->Init(FColor(0, 0, 0, 0), SectionChannels.Num());
+		for (int32 Index = 0; Index < SectionChannels.Num(); ++Index)
+		{
+			// Channel order R, G, B, A
+			switch (SectionChannels[Index])
+			{
+			case 0: (*OutSectionMask)[Index].R = 255; break;
+			case 1: (*OutSectionMask)[Index].G = 255; break;
+			case 2: (*OutSectionMask)[Index].B = 255; break;
+			case 3: (*OutSectionMask)[Index].A = 255; break;
+			default: break;
+			}
+		}
+	}
+	return true;
+}
+
+bool FAutoPaintMeshRasterizer::RasterizeHeights(const UAutoPaintData& InData, TArray<float>& OutHeights, TArray<bool>& OutCovered, TArray<int8>* OutSectionChannels)
+{
+	using namespace AutoPaintMeshRasterizer;
+
+	UStaticMesh* StaticMesh = InData.ReferencedStaticMesh.LoadSynchronous();
+	if (!StaticMesh)
+	{
+		return false;
+	}
+
+	const FMeshDescription* MeshDescription = StaticMesh->GetMeshDescription(0);
+	if (!MeshDescription)
+	{
+		return false;
+	}
+
+	const FIntPoint Resolution = InData.SceneCaptureResolution;
+	if (Resolution.X <= 0 || Resolution.Y <= 0)
+	{
+		return false;
+	}
+
+	FStaticMeshConstAttributes Attributes(*MeshDescription);
+	TVertexAttributesConstRef<FVector3f> Positions = Attributes.GetVertexPositions();
+	TPolygonGroupAttributesConstRef<FName> SlotNames = Attributes.GetPolygonGroupMaterialSlotNames();
+
+	// Mask channels follow distinct layer names, triangles reach them through the material slot of their polygon group
+	const TArray<FName> LayerNames = InData.GetSectionLayerNames();
+	TMap<FPolygonGroupID, int8> PolygonGroupChannels;
+	if (OutSectionChannels)
+	{
+		for (const FPolygonGroupID PolygonGroupID : MeshDescription->PolygonGroups().GetElementIDs())
+		{
+			const FName SlotName = SlotNames.IsValid() ? SlotNames[PolygonGroupID] : NAME_None;
+			const FAutoPaintSectionLayer* SectionLayer = InData.SectionLayers.FindByPredicate([SlotName](const FAutoPaintSectionLayer& Layer)
+			{
+				return Layer.MaterialSlotName == SlotName;
+			});
+			PolygonGroupChannels.Add(PolygonGroupID, (int8)(SectionLayer ? LayerNames.IndexOfByKey(SectionLayer->LayerName) : INDEX_NONE));
+		}
+	}
+
+	const FVector3f Offset = FVector3f(InData.WorldOffset);
+
+	// Same view and projection as the GPU capture, so camera rotation, distance, FOV and ortho width all apply
+	FMatrix WorldToView, ViewToClip;
+	FAutoPaintCapturer::GetViewMatrices(&InData, Resolution, WorldToView, ViewToClip);
+	const FMatrix44f WorldToView44f(WorldToView);
+	const FMatrix44f ViewToClip44f(ViewToClip);
+
+	// Same as ObjectHeight for M_NormalizeDraw: full height of mesh bounds (placed at WorldOffset)
+	FBox3f Bounds(ForceInit);
+	for (const FVertexID VertexID : MeshDescription->Vertices().GetElementIDs())
+	{
+		Bounds += Positions[VertexID] + Offset;
+	}
+	const float ObjectHeight = Bounds.GetSize().Z;
+	const float InvObjectHeight = ObjectHeight > UE_KINDA_SMALL_NUMBER ? 1.f / ObjectHeight : 0.f;
+	const float CameraDistance = InData.CameraDistance;
+
+	TArray<FTriangle> Triangles;
+	Triangles.Reserve(MeshDescription->Triangles().Num());
+	for (const FTriangleID TriangleID : MeshDescription->Triangles().GetElementIDs())
+	{
+		TArrayView<const FVertexID> Vertices = MeshDescription->GetTriangleVertices(TriangleID);
+
+		FVector2f Pixel[3];
+		float InvW[3];
+		float Depth[3];
+		bool bBehindCamera = false;
+		for (int32 Corner = 0; Corner < 3; ++Corner)
+		{
+			const FVector4f View = WorldToView44f.TransformPosition(Positions[Vertices[Corner]] + Offset);
+			const FVector4f Clip = ViewToClip44f.TransformFVector4(View);
+			if (Clip.W <= UE_KINDA_SMALL_NUMBER)
+			{
+				bBehindCamera = true;
+				break;
+			}
+
+			// Clip space Y is up, pixel rows go down
+			InvW[Corner] = 1.f / Clip.W;
+			Pixel[Corner] = FVector2f(Clip.X * InvW[Corner] + 1.f, 1.f - Clip.Y * InvW[Corner]) * 0.5f * FVector2f(Resolution);
+			Depth[Corner] = View.Z;
+		}
+		if (bBehindCamera)
+		{
+			// Not clipped against the near plane, the capture camera is expected to see the whole mesh
+			continue;
+		}
+
+		const FVector2f Min = FVector2f::Min(Pixel[0], FVector2f::Min(Pixel[1], Pixel[2]));
+		const FVector2f Max = FVector2f::Max(Pixel[0], FVector2f::Max(Pixel[1], Pixel[2]));
+		const FIntRect PixelBounds(
+			FMath::Clamp(FMath::FloorToInt(Min.X), 0, Resolution.X),
+			FMath::Clamp(FMath::FloorToInt(Min.Y), 0, Resolution.Y),
+			FMath::Clamp(FMath::CeilToInt(Max.X) + 1, 0, Resolution.X),
+			FMath::Clamp(FMath::CeilToInt(Max.Y) + 1, 0, Resolution.Y));
+
+		if (PixelBounds.IsEmpty())
+		{
+			// Outside of the view
+			continue;
+		}
+
+		FTriangle& Triangle = Triangles.AddDefaulted_GetRef();
+		Triangle.P0 = Pixel[0];
+		Triangle.P1 = Pixel[1];
+		Triangle.P2 = Pixel[2];
+		Triangle.InvW0 = InvW[0];
+		Triangle.InvW1 = InvW[1];
+		Triangle.InvW2 = InvW[2];
+		Triangle.DepthOverW0 = Depth[0] * InvW[0];
+		Triangle.DepthOverW1 = Depth[1] * InvW[1];
+		Triangle.DepthOverW2 = Depth[2] * InvW[2];
+		Triangle.PixelBounds = PixelBounds;
+		const int8* Channel = PolygonGroupChannels.Find(MeshDescription->GetTrianglePolygonGroup(TriangleID));
+		Triangle.Channel = Channel ? *Channel : (int8)INDEX_NONE;
+	}
+
+	// Nearest view depth per texel, texels the mesh doesn't cover stay on the capture floor at zero height
+	TArray<float> Depths;
+	Depths.Init(UE_BIG_NUMBER, Resolution.X * Resolution.Y);
+	if (OutSectionChannels)
+	{
+		OutSectionChannels->Init(INDEX_NONE, Resolution.X * Resolution.Y);
+	}
+
+	const int32 NumBands = FMath::DivideAndRoundUp(Resolution.Y, RowsPerBand);
+	ParallelFor(NumBands, [&](int32 BandIndex)
+	{
+		const int32 BandMinY = BandIndex * RowsPerBand;
+		const int32 BandMaxY = FMath::Min(BandMinY + RowsPerBand, Resolution.Y);
+
+		for (const FTriangle& Triangle : Triangles)
+		{
+			const int32 MinY = FMath::Max(Triangle.PixelBounds.Min.Y, BandMinY);
+			const int32 MaxY = FMath::Min(Triangle.PixelBounds.Max.Y, BandMaxY);
+			if (MinY >= MaxY)
+			{
+				continue;
+			}
+
+			const FVector2f E0 = Triangle.P1 - Triangle.P0;
+			const FVector2f E1 = Triangle.P2 - Triangle.P0;
+			const float Area = E0.X * E1.Y - E0.Y * E1.X;
+			if (FMath::Abs(Area) < UE_SMALL_NUMBER)
+			{
+				continue;
+			}
+			const float InvArea = 1.f / Area;
+
+			for (int32 Y = MinY; Y < MaxY; ++Y)
+			{
+				for (int32 X = Triangle.PixelBounds.Min.X; X < Triangle.PixelBounds.Max.X; ++X)
+				{
+					// Sample at texel center
+					const FVector2f P = FVector2f(X + 0.5f, Y + 0.5f) - Triangle.P0;
+					const float B1 = (P.X * E1.Y - P.Y * E1.X) * InvArea;
+					const float B2 = (E0.X * P.Y - E0.Y * P.X) * InvArea;
+					const float B0 = 1.f - B1 - B2;
+					if (B0 < 0.f || B1 < 0.f || B2 < 0.f)
+					{
+						continue;
+					}
+
+					// Perspective correct, W is 1 for orthographic
+					const float InvW = B0 * Triangle.InvW0 + B1 * Triangle.InvW1 + B2 * Triangle.InvW2;
+					const float NewDepth = (B0 * Triangle.DepthOverW0 + B1 * Triangle.DepthOverW1 + B2 * Triangle.DepthOverW2) / InvW;
+					float& Depth = Depths[Y * Resolution.X + X];
+					if (NewDepth < Depth)
+					{
+						Depth = NewDepth;
+						// Topmost triangle decides the layer, same as the nearest depth on GPU
+						if (OutSectionChannels)
+						{
+							(*OutSectionChannels)[Y * Resolution.X + X] = Triangle.Channel;
+						}
+					}
+				}
+			}
+		}
+	});
+
+	// Same inputs as M_NormalizeDraw: height above the pivot is the camera distance minus the captured depth
+	OutHeights.SetNumUninitialized(Depths.Num());
+	OutCovered.SetNumUninitialized(Depths.Num());
+	for (int32 Index = 0; Index < Depths.Num(); ++Index)
+	{
+		OutCovered[Index] = Depths[Index] < UE_BIG_NUMBER;
+		OutHeights[Index] = OutCovered[Index] ? FMath::Clamp((CameraDistance - Depths[Index]) * InvObjectHeight, 0.f, 1.f) : 0.f;
+	}
+
+	return true;
+}
+
+void FAutoPaintMeshRasterizer::EncodeHeights(TConstArrayView<float> InHeights, TConstArrayView<bool> InCovered, TArray<FColor>& OutPixels)
+{
+	check(InHeights.Num() == InCovered.Num());
+
+	OutPixels.SetNumUninitialized(InHeights.Num());
+	for (int32 Index = 0; Index < InHeights.Num(); ++Index)
+	{
+		const uint8 Value = (uint8)FMath::Clamp(FMath::RoundToInt(InHeights[Index] * 255.f), 0, 255);
+		OutPixels[Index] = FColor(Value, Value, Value, InCovered[Index] ? 255 : 0);
+	}
+}
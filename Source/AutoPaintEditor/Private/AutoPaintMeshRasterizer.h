@@ -0,0 +1,36 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class UAutoPaintData;
+class UStaticMesh;
+
+/**
+ * CPU fallback for the capture pipeline, used when there is no RHI (e.g. -nullrhi build machines).
+ * Rasterizes the source mesh description through the view and projection of FAutoPaintCapturer::GetViewMatrices and
+ * keeps the nearest view depth per texel, normalized with CameraDistance and the mesh height the same way
+ * M_NormalizeDraw does for captured depth.
+ *
+ * Limits compared to the GPU capture: one sample per texel at its center, triangles with a corner behind the camera
+ * are dropped instead of clipped, and the material post process (blur) isn't reproduced.
+ */
+struct FAutoPaintMeshRasterizer
+{
+	/**
+	 * Rasterizes asset mesh into OutPixels (SceneCaptureResolution, BGRA8). Returns false if the asset has no usable mesh.
+	 * OutSectionMask receives the section layers of the topmost triangle per texel, a layer per channel like
+	 * FAutoPaintMeshDepthCaptureDispatchParams::SectionMaskResult but without anti-aliasing.
+	 */
+	static bool Rasterize(const UAutoPaintData& InData, TArray<FColor>& OutPixels, TArray<FColor>* OutSectionMask = nullptr);
+
+	/**
+	 * Same as above, but keeps normalized float heights, whether the mesh covers the texel and the section layer channel
+	 * (or INDEX_NONE) of every texel.
+	 */
+	static bool RasterizeHeights(const UAutoPaintData& InData, TArray<float>& OutHeights, TArray<bool>& OutCovered, TArray<int8>* OutSectionChannels = nullptr);
+
+	/** Encodes normalized heights the same way Final RT stores them, alpha is the mesh coverage. */
+	static void EncodeHeights(TConstArrayView<float> InHeights, TConstArrayView<bool> InCovered, TArray<FColor>& OutPixels);
+};
@@ -0,0 +1,66 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintSurfaceDerivatives.h"
+
+#include "Async/ParallelFor.h"
+
+bool FAutoPaintSurfaceDerivatives::Encode(const FIntPoint& InSize, const FVector2D& InWorldSize, TArray<FColor>& InOutPixels)
+{
+	if (InSize.X <= 0 || InSize.Y <= 0 || InOutPixels.Num() != InSize.X * InSize.Y || InWorldSize.X <= 0 || InWorldSize.Y <= 0)
+	{
+		return false;
+	}
+
+	const int32 Width = InSize.X;
+	const int32 Height = InSize.Y;
+
+	// 8 bit heights step between texels, the 3x3 stencils below smooth that out. Edge texels repeat.
+	TArray<float> Heights;
+	Heights.SetNumUninitialized(Width * Height);
+	for (int32 Index = 0; Index < Heights.Num(); ++Index)
+	{
+		Heights[Index] = InOutPixels[Index].R / 255.f;
+	}
+	auto GetHeight = [&Heights, Width, Height](int32 X, int32 Y)
+	{
+		return Heights[FMath::Clamp(Y, 0, Height - 1) * Width + FMath::Clamp(X, 0, Width - 1)];
+	};
+
+	const FVector2f Spacing = FVector2f(InWorldSize) / FVector2f(InSize);
+	const float PatchLength = static_cast<float>(FMath::Max(InWorldSize.X, InWorldSize.Y));
+
+	ParallelFor(Height, [&](int32 Y)
+	{
+		for (int32 X = 0; X < Width; ++X)
+		{
+			float H[3][3];
+			for (int32 OffsetY = -1; OffsetY <= 1; ++OffsetY)
+			{
+				for (int32 OffsetX = -1; OffsetX <= 1; ++OffsetX)
+				{
+					H[OffsetY + 1][OffsetX + 1] = GetHeight(X + OffsetX, Y + OffsetY);
+				}
+			}
+
+			// Sobel
+			const float GradientX = ((H[0][2] + 2.f * H[1][2] + H[2][2]) - (H[0][0] + 2.f * H[1][0] + H[2][0])) / (8.f * Spacing.X);
+			const float GradientY = ((H[2][0] + 2.f * H[2][1] + H[2][2]) - (H[0][0] + 2.f * H[0][1] + H[0][2])) / (8.f * Spacing.Y);
+			const float Gradient = FMath::Sqrt(GradientX * GradientX + GradientY * GradientY) * PatchLength;
+
+			// Laplacian of the [1 2 1] smoothed heights
+			const float SecondX = ((H[0][0] + 2.f * H[1][0] + H[2][0]) - 2.f * (H[0][1] + 2.f * H[1][1] + H[2][1]) + (H[0][2] + 2.f * H[1][2] + H[2][2])) / (4.f * Spacing.X * Spacing.X);
+			const float SecondY = ((H[0][0] + 2.f * H[0][1] + H[0][2]) - 2.f * (H[1][0] + 2.f * H[1][1] + H[1][2]) + (H[2][0] + 2.f * H[2][1] + H[2][2])) / (4.f * Spacing.Y * Spacing.Y);
+			const float Curvature = -(SecondX + SecondY) * PatchLength * PatchLength;
+
+			const float EncodedSlope = FMath::Atan(Gradient / GradientRange) / HALF_PI;
+			const float EncodedCurvature = 0.5f + FMath::Atan(Curvature / CurvatureRange) / PI;
+
+			FColor& Pixel = InOutPixels[Y * Width + X];
+			Pixel.B = (uint8)FMath::Clamp(FMath::RoundToInt(EncodedSlope * 255.f), 0, 255);
+			Pixel.A = (uint8)FMath::Clamp(FMath::RoundToInt(EncodedCurvature * 255.f), 0, 255);
+		}
+	});
+
+	return true;
+}
@@ -0,0 +1,24 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Slope and curvature of the captured heights, stored next to them so weightmap layers can be painted from the
+ * surface shape without a mask texture per layer. Both are measured on the stored height (0..1 in R) over the
+ * longer patch side, so they don't depend on HeightWPO or the patch scale, which are applied at apply time.
+ *
+ * B = atan(|Gradient| / GradientRange) / (PI / 2), A = 0.5 + atan(Curvature / CurvatureRange) / PI with curvature
+ * positive on ridges. Must match GetDerivedWeight.
+ */
+struct FAutoPaintSurfaceDerivatives
+{
+	/** Must match DERIVED_GRADIENT_RANGE */
+	static constexpr float GradientRange = 4.f;
+	/** Must match DERIVED_CURVATURE_RANGE */
+	static constexpr float CurvatureRange = 64.f;
+
+	/** Writes slope into B and curvature into A of InOutPixels (InSize, BGRA8). */
+	static bool Encode(const FIntPoint& InSize, const FVector2D& InWorldSize, TArray<FColor>& InOutPixels);
+};
@@ -5,10 +5,11 @@
 
 #include "AdvancedPreviewScene.h"
 #include "AssetViewerSettings.h"
+#include "AutoPaintCaptureService.h"
+#include "AutoPaintCaptureSettings.h"
 #include "AutoPaintEditorToolkit.h"
 #include "ComponentReregisterContext.h"
 #include "UnrealWidget.h"
-#include "Components/SceneCaptureComponent2D.h"
 
 #define LOCTEXT_NAMESPACE "AutoPaintEditor"
 
@@ -16,7 +17,7 @@
 class FAutoPaintEditorViewportClient : public FEditorViewportClient
 {
 public:
-	FAutoPaintEditorViewportClient(TWeakPtr<FAutoPaintEditorToolkit> InEditor, FAdvancedPreviewScene& InPreviewScene, const TSharedRef<SAutoPaintEditorViewport>& InEditorViewport);
+	FAutoPaintEditorViewportClient(TWeakPtr<FAutoPaintEditorToolkit> InEditor, FPreviewScene& InPreviewScene, FAdvancedPreviewScene* InAdvancedPreviewScene, const TSharedRef<SAutoPaintEditorViewport>& InEditorViewport);
 
 	// FEditorViewportClient interface
 	virtual bool InputKey(const FInputKeyEventArgs& EventArgs) override;
@@ -34,17 +35,22 @@ public:
 	*/
 	void FocusViewportOnBounds(const FBoxSphereBounds Bounds, bool bInstant = false);
 
+	/** Ticks preview world and redraws on next frame */
+	void RequestRedraw();
+
 private:
+	/** Preview world is ticked only while realtime or when redraw was requested */
+	bool bWorldTickRequested = true;
 
 	/** Pointer back to the material editor tool that owns us */
 	TWeakPtr<FAutoPaintEditorToolkit> EditorPtr;
 
-	/** Preview Scene - uses advanced preview settings */
+	/** Preview Scene - uses advanced preview settings, null for lightweight preview */
 	class FAdvancedPreviewScene* AdvancedPreviewScene;
 };
 
 
-FAutoPaintEditorViewportClient::FAutoPaintEditorViewportClient(TWeakPtr<FAutoPaintEditorToolkit> InEditor, FAdvancedPreviewScene& InPreviewScene, const TSharedRef<SAutoPaintEditorViewport>& InEditorViewport)
+FAutoPaintEditorViewportClient::FAutoPaintEditorViewportClient(TWeakPtr<FAutoPaintEditorToolkit> InEditor, FPreviewScene& InPreviewScene, FAdvancedPreviewScene* InAdvancedPreviewScene, const TSharedRef<SAutoPaintEditorViewport>& InEditorViewport)
 	: FEditorViewportClient(nullptr, &InPreviewScene, StaticCastSharedRef<SEditorViewport>(InEditorViewport))
 	, EditorPtr(InEditor)
 {
@@ -70,15 +76,25 @@ FAutoPaintEditorViewportClient::FAutoPaintEditorViewportClient(TWeakPtr<FAutoPai
 	// Don't want to display the widget in this viewport
 	Widget->SetDefaultVisibility(false);
 
-	AdvancedPreviewScene = &InPreviewScene;
+	AdvancedPreviewScene = InAdvancedPreviewScene;
 }
 
 void FAutoPaintEditorViewportClient::Tick(float DeltaSeconds)
 {
 	FEditorViewportClient::Tick(DeltaSeconds);
 
-	// Tick the preview scene world.
-	PreviewScene->GetWorld()->Tick(LEVELTICK_All, DeltaSeconds);
+	// Tick the preview scene world. Preview components are static, so without realtime it's enough to flush their updates before redraw.
+	if (IsRealtime() || bWorldTickRequested)
+	{
+		bWorldTickRequested = false;
+		PreviewScene->GetWorld()->Tick(LEVELTICK_All, DeltaSeconds);
+	}
+}
+
+void FAutoPaintEditorViewportClient::RequestRedraw()
+{
+	bWorldTickRequested = true;
+	Invalidate();
 }
 
 void FAutoPaintEditorViewportClient::Draw(FViewport* InViewport,FCanvas* Canvas)
@@ -100,7 +116,10 @@ bool FAutoPaintEditorViewportClient::InputKey(const FInputKeyEventArgs& EventArg
 	// Handle viewport screenshot.
 	bHandled |= InputTakeScreenshot(EventArgs.Viewport, EventArgs.Key, EventArgs.Event);
 
-	bHandled |= AdvancedPreviewScene->HandleInputKey(EventArgs);
+	if (AdvancedPreviewScene != nullptr)
+	{
+		bHandled |= AdvancedPreviewScene->HandleInputKey(EventArgs);
+	}
 
 	return bHandled;
 }
@@ -111,7 +130,7 @@ bool FAutoPaintEditorViewportClient::InputAxis(FViewport* InViewport, FInputDevi
 
 	if (!bDisableInput)
 	{
-		bResult = AdvancedPreviewScene->HandleViewportInput(InViewport, DeviceId, Key, Delta, DeltaTime, NumSamples, bGamepad);
+		bResult = AdvancedPreviewScene != nullptr && AdvancedPreviewScene->HandleViewportInput(InViewport, DeviceId, Key, Delta, DeltaTime, NumSamples, bGamepad);
 		if (bResult)
 		{
 			Invalidate();
@@ -181,11 +200,22 @@ void SAutoPaintEditorViewport::Construct(const FArguments& InArgs)
 {
 	AutoPaintEditorPtr = InArgs._AutoPaintEditorPtr;
 	
-	AdvancedPreviewScene = MakeShareable(new FAdvancedPreviewScene(FPreviewScene::ConstructionValues()));
-	AdvancedPreviewScene->SetFloorVisibility(false, true);
+	const UAutoPaintCaptureSettings* CaptureSettings = FAutoPaintCaptureService::Get().GetSettings();
+	if (CaptureSettings && CaptureSettings->bLightweightPreviewScene)
+	{
+		// Default lights only: no sky sphere, environment cube map or post process profile
+		PreviewScene = MakeShareable(new FPreviewScene(FPreviewScene::ConstructionValues().SetCreatePhysicsScene(false)));
+	}
+	else
+	{
+		TSharedPtr<FAdvancedPreviewScene> NewAdvancedPreviewScene = MakeShareable(new FAdvancedPreviewScene(FPreviewScene::ConstructionValues()));
+		NewAdvancedPreviewScene->SetFloorVisibility(false, true);
+		AdvancedPreviewScene = NewAdvancedPreviewScene.Get();
+		PreviewScene = NewAdvancedPreviewScene;
+	}
 
 	// restore last used feature level
-	UWorld* PreviewWorld = AdvancedPreviewScene->GetWorld();
+	UWorld* PreviewWorld = PreviewScene->GetWorld();
 	if (PreviewWorld != nullptr)
 	{
 		PreviewWorld->ChangeFeatureLevel(GWorld->GetFeatureLevel());
@@ -202,17 +232,18 @@ void SAutoPaintEditorViewport::Construct(const FArguments& InArgs)
 	{
 		auto AutoPaintEditor = AutoPaintEditorPtr.Pin();
 		AddComponent(AutoPaintEditor->GetPreviewMeshComponent());
-		AddComponent(AutoPaintEditor->GetCaptureComponent());
 		AddComponent(AutoPaintEditor->GetCameraComponent());
 		AddComponent(AutoPaintEditor->GetFloorMeshComponent());
-		// AddComponent(AutoPaintEditor->GetCaptureFloorMeshComponent()); // DEBUG
 	}
 	
-	UAssetViewerSettings* Settings = UAssetViewerSettings::Get();
-	const int32 ProfileIndex = AdvancedPreviewScene->GetCurrentProfileIndex();
-	if (Settings->Profiles.IsValidIndex(ProfileIndex))
+	if (AdvancedPreviewScene != nullptr)
 	{
-		AdvancedPreviewScene->SetEnvironmentVisibility(Settings->Profiles[ProfileIndex].bShowEnvironment, true);
+		UAssetViewerSettings* Settings = UAssetViewerSettings::Get();
+		const int32 ProfileIndex = AdvancedPreviewScene->GetCurrentProfileIndex();
+		if (Settings->Profiles.IsValidIndex(ProfileIndex))
+		{
+			AdvancedPreviewScene->SetEnvironmentVisibility(Settings->Profiles[ProfileIndex].bShowEnvironment, true);
+		}
 	}
 
 	// OnPropertyChangedHandle = FCoreUObjectDelegates::FOnObjectPropertyChanged::FDelegate::CreateRaw(this, &SMaterialEditor3DPreviewViewport::OnPropertyChanged);
@@ -242,9 +273,10 @@ void SAutoPaintEditorViewport::AddReferencedObjects(FReferenceCollector& Collect
 
 TSharedRef<FEditorViewportClient> SAutoPaintEditorViewport::MakeEditorViewportClient()
 {
-	EditorViewportClient = MakeShareable( new FAutoPaintEditorViewportClient(AutoPaintEditorPtr, *AdvancedPreviewScene.Get(), SharedThis(this)) );
+	EditorViewportClient = MakeShareable( new FAutoPaintEditorViewportClient(AutoPaintEditorPtr, *PreviewScene.Get(), AdvancedPreviewScene, SharedThis(this)) );
 	// UAssetViewerSettings::Get()->OnAssetViewerSettingsChanged().AddRaw(this, &SAutoPaintEditorViewport::OnAssetViewerSettingsChanged);
-	EditorViewportClient->SetRealtime(true);
+	const UAutoPaintCaptureSettings* CaptureSettings = FAutoPaintCaptureService::Get().GetSettings();
+	EditorViewportClient->SetRealtime(CaptureSettings && CaptureSettings->bRealtimeViewport);
 	EditorViewportClient->SetViewLocation( FVector::ZeroVector );
 	EditorViewportClient->SetViewRotation( FRotator(-15.0f, -90.0f, 0.0f) );
 	EditorViewportClient->SetViewLocationForOrbiting( FVector::ZeroVector );
@@ -269,6 +301,23 @@ void SAutoPaintEditorViewport::PopulateViewportOverlays(TSharedRef<SOverlay> Ove
 	SEditorViewport::PopulateViewportOverlays(Overlay);
 }
 
+void SAutoPaintEditorViewport::RefreshViewport()
+{
+	if (EditorViewportClient.IsValid())
+	{
+		EditorViewportClient->RequestRedraw();
+	}
+}
+
+void SAutoPaintEditorViewport::SetRealtime(bool bInRealtime)
+{
+	if (EditorViewportClient.IsValid() && EditorViewportClient->IsRealtime() != bInRealtime)
+	{
+		EditorViewportClient->SetRealtime(bInRealtime);
+		EditorViewportClient->RequestRedraw();
+	}
+}
+
 bool SAutoPaintEditorViewport::IsVisible() const
 {
 	return SEditorViewport::IsVisible();
@@ -289,23 +338,23 @@ void SAutoPaintEditorViewport::OnFocusViewportToSelection()
 
 void SAutoPaintEditorViewport::AddComponent(USceneComponent* SceneComponent) const
 {
-	if (!ensure(AdvancedPreviewScene))
+	if (!ensure(PreviewScene))
 	{
 		return;
 	}
 
 	FComponentReregisterContext ReregisterContext(SceneComponent);;
-	AdvancedPreviewScene->AddComponent(SceneComponent, SceneComponent->GetRelativeTransform());
+	PreviewScene->AddComponent(SceneComponent, SceneComponent->GetRelativeTransform());
 }
 
 void SAutoPaintEditorViewport::DestroyComponent(USceneComponent* SceneComponent) const
 {
-	if (!ensure(AdvancedPreviewScene))
+	if (!ensure(PreviewScene))
 	{
 		return;
 	}
 
-	AdvancedPreviewScene->RemoveComponent(SceneComponent);
+	PreviewScene->RemoveComponent(SceneComponent);
 }
 
 #undef LOCTEXT_NAMESPACE
\ No newline at end of file
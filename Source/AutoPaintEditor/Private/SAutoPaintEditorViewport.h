@@ -46,7 +46,12 @@ public:
 	virtual void OnFloatingButtonClicked() override {}
 	//~ End ICommonEditorViewportToolbarInfoProvider Interface
 	
-	TSharedRef<FAdvancedPreviewScene> GetPreviewScene() { return AdvancedPreviewScene.ToSharedRef(); }
+	TSharedRef<FPreviewScene> GetPreviewScene() { return PreviewScene.ToSharedRef(); }
+
+	/** Redraws viewport once, used when it isn't realtime */
+	void RefreshViewport();
+
+	void SetRealtime(bool bInRealtime);
 	
 protected:
 	//~ Begin SEditorViewport Interface
@@ -68,6 +73,9 @@ private:
 	/** Level viewport client */
 	TSharedPtr<class FAutoPaintEditorViewportClient> EditorViewportClient;
 	
-	/** Preview Scene - uses advanced preview settings */
-	TSharedPtr<FAdvancedPreviewScene> AdvancedPreviewScene;
+	/** Preview Scene - advanced preview scene unless lightweight preview is enabled in capture settings */
+	TSharedPtr<FPreviewScene> PreviewScene;
+
+	/** Same as PreviewScene when it uses advanced preview settings, otherwise null */
+	FAdvancedPreviewScene* AdvancedPreviewScene = nullptr;
 };
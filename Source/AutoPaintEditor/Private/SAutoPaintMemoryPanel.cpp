@@ -0,0 +1,153 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "SAutoPaintMemoryPanel.h"
+
+#include "Widgets/Input/SButton.h"
+#include "Widgets/Layout/SBox.h"
+#include "Widgets/Text/STextBlock.h"
+
+#define LOCTEXT_NAMESPACE "AutoPaintEditor"
+
+namespace AutoPaintMemoryPanel
+{
+	static const FName CategoryColumn(TEXT("Category"));
+	static const FName NameColumn(TEXT("Name"));
+	static const FName BytesColumn(TEXT("Bytes"));
+}
+
+void SAutoPaintMemoryPanel::Construct(const FArguments& InArgs)
+{
+	ChildSlot
+	[
+		SNew(SVerticalBox)
+		+ SVerticalBox::Slot()
+		.AutoHeight()
+		.Padding(4.f)
+		[
+			SNew(SHorizontalBox)
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0.f, 0.f, 4.f, 0.f)
+			[
+				SNew(SButton)
+				.Text(LOCTEXT("MemoryRefresh", "Refresh"))
+				.OnClicked_Lambda([this]
+				{
+					Refresh();
+					return FReply::Handled();
+				})
+			]
+			+ SHorizontalBox::Slot()
+			.AutoWidth()
+			.Padding(0.f, 0.f, 4.f, 0.f)
+			[
+				SNew(SButton)
+				.Text(LOCTEXT("MemoryResetPeak", "Reset Peak"))
+				.ToolTipText(LOCTEXT("MemoryResetPeakTooltip", "Forget the largest transient allocation seen so far"))
+				.OnClicked_Lambda([]
+				{
+					AutoPaintMemory::ResetPeakTransientBytes();
+					return FReply::Handled();
+				})
+			]
+			+ SHorizontalBox::Slot()
+			.FillWidth(1.f)
+			.VAlign(VAlign_Center)
+			[
+				SNew(STextBlock)
+				.Text(this, &SAutoPaintMemoryPanel::GetSummaryText)
+			]
+		]
+		+ SVerticalBox::Slot()
+		.FillHeight(1.f)
+		[
+			SAssignNew(ListView, SListView<FEntryPtr>)
+			.ListItemsSource(&Entries)
+			.OnGenerateRow(this, &SAutoPaintMemoryPanel::OnGenerateRow)
+			.HeaderRow
+			(
+				SNew(SHeaderRow)
+				+ SHeaderRow::Column(AutoPaintMemoryPanel::CategoryColumn)
+				.DefaultLabel(LOCTEXT("MemoryCategory", "Category"))
+				.FillWidth(0.2f)
+				+ SHeaderRow::Column(AutoPaintMemoryPanel::NameColumn)
+				.DefaultLabel(LOCTEXT("MemoryName", "Name"))
+				.FillWidth(0.6f)
+				+ SHeaderRow::Column(AutoPaintMemoryPanel::BytesColumn)
+				.DefaultLabel(LOCTEXT("MemoryBytes", "Size"))
+				.FillWidth(0.2f)
+			)
+		]
+	];
+
+	Refresh();
+}
+
+void SAutoPaintMemoryPanel::Refresh()
+{
+	Entries.Reset();
+	TotalBytes = 0;
+	for (FAutoPaintMemoryEntry& Entry : AutoPaintMemory::Gather())
+	{
+		TotalBytes += Entry.Bytes;
+		Entries.Add(MakeShared<FAutoPaintMemoryEntry>(MoveTemp(Entry)));
+	}
+
+	if (ListView)
+	{
+		ListView->RequestListRefresh();
+	}
+}
+
+TSharedRef<ITableRow> SAutoPaintMemoryPanel::OnGenerateRow(FEntryPtr InEntry, const TSharedRef<STableViewBase>& InOwnerTable) const
+{
+	class SEntryRow : public SMultiColumnTableRow<FEntryPtr>
+	{
+	public:
+		SLATE_BEGIN_ARGS( SEntryRow ){}
+		SLATE_END_ARGS()
+
+		void Construct(const FArguments& InArgs, const TSharedRef<STableViewBase>& InOwnerTable, FEntryPtr InEntry)
+		{
+			Entry = InEntry;
+			SMultiColumnTableRow<FEntryPtr>::Construct(FSuperRowType::FArguments(), InOwnerTable);
+		}
+
+		virtual TSharedRef<SWidget> GenerateWidgetForColumn(const FName& InColumnName) override
+		{
+			FText Text;
+			if (InColumnName == AutoPaintMemoryPanel::CategoryColumn)
+			{
+				Text = FText::FromString(Entry->Category);
+			}
+			else if (InColumnName == AutoPaintMemoryPanel::NameColumn)
+			{
+				Text = FText::FromString(Entry->Name);
+			}
+			else
+			{
+				Text = FormatBytes(Entry->Bytes);
+			}
+			return SNew(STextBlock).Text(Text);
+		}
+
+	private:
+		FEntryPtr Entry;
+	};
+
+	return SNew(SEntryRow, InOwnerTable, InEntry);
+}
+
+FText SAutoPaintMemoryPanel::GetSummaryText() const
+{
+	return FText::Format(LOCTEXT("MemorySummary", "Held {0}, transient last update {1}, peak {2}"),
+		FormatBytes(TotalBytes), FormatBytes(AutoPaintMemory::GetLastTransientBytes()), FormatBytes(AutoPaintMemory::GetPeakTransientBytes()));
+}
+
+FText SAutoPaintMemoryPanel::FormatBytes(int64 InBytes)
+{
+	return FText::AsMemory(InBytes, EMemoryUnitStandard::IEC);
+}
+
+#undef LOCTEXT_NAMESPACE
@@ -0,0 +1,37 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintMemory.h"
+#include "Widgets/DeclarativeSyntaxSupport.h"
+#include "Widgets/SCompoundWidget.h"
+#include "Widgets/Views/SListView.h"
+
+/**
+ * Bytes held per AutoPaint asset, editor, capture target and landscape, see AutoPaintMemory::Gather,
+ * plus the transient RDG bytes of the last and the largest landscape update. Refreshed on demand.
+ */
+class SAutoPaintMemoryPanel : public SCompoundWidget
+{
+public:
+	SLATE_BEGIN_ARGS( SAutoPaintMemoryPanel ){}
+	SLATE_END_ARGS()
+
+	void Construct(const FArguments& InArgs);
+
+	void Refresh();
+
+private:
+	using FEntryPtr = TSharedPtr<FAutoPaintMemoryEntry>;
+
+	TSharedRef<ITableRow> OnGenerateRow(FEntryPtr InEntry, const TSharedRef<STableViewBase>& InOwnerTable) const;
+	FText GetSummaryText() const;
+
+	static FText FormatBytes(int64 InBytes);
+
+	TArray<FEntryPtr> Entries;
+	int64 TotalBytes = 0;
+
+	TSharedPtr<SListView<FEntryPtr>> ListView;
+};
@@ -12,4 +12,6 @@ public:
 protected:
     TSharedPtr<class FAssetTypeActions_AutoPaintSettings> AssetTypeAction;
     FDelegateHandle ContentBrowserAssetsExtenderDelegateHandle;
+    FDelegateHandle GatherAssetMemoryHandle;
+    FDelegateHandle GatherCaptureMemoryHandle;
 };
@@ -0,0 +1,323 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintInstancedTexturePatchPS.h"
+
+#include "AutoPaintPatchAtlas.h"
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
+#include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "PixelShaderUtils.h"
+#include "LandscapeUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Instanced Texture Patch (RT)"), STAT_AutoPaint_InstancedTexturePatch_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintInstancedTexturePatch, TEXT("AutoPaint Instanced Texture Patch"));
+
+namespace AutoPaintInstancedTexturePatch
+{
+	/** float4 per instance, must match the shader */
+	constexpr int32 InstanceDataStride = 5;
+}
+
+BEGIN_SHADER_PARAMETER_STRUCT(FAutoPaintInstancedTexturePatchParameters, )
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSource)
+	// Atlas bucket arrays used by the pass, see FAutoPaintPatchAtlas
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2DArray<float4>, InAtlas0)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2DArray<float4>, InAtlas1)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2DArray<float4>, InAtlas2)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2DArray<float4>, InAtlas3)
+	SHADER_PARAMETER_SAMPLER(SamplerState, InPatchSampler)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float4>, InInstanceData)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, InBinOffsets)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, InBinInstances)
+	SHADER_PARAMETER(FUintVector2, InBinOrigin)
+	SHADER_PARAMETER(uint32, InNumBinsX)
+	// Weightmap only, see FApplyLandscapeTextureWeightPatchPS. Slope range w is non zero for a derived weight pass.
+	SHADER_PARAMETER(FVector4f, InDerivedSlopeRange)
+	SHADER_PARAMETER(FVector4f, InDerivedCurvatureRange)
+	RENDER_TARGET_BINDING_SLOTS() // Holds our output
+END_SHADER_PARAMETER_STRUCT()
+
+class FApplyInstancedTextureHeightPatchPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyInstancedTextureHeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyInstancedTextureHeightPatchPS, FGlobalShader);
+
+public:
+	using FParameters = FAutoPaintInstancedTexturePatchParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("APPLY_INSTANCED_PATCH"), 1);
+		OutEnvironment.SetDefine(TEXT("BIN_SIZE"), FAutoPaintInstancedTexturePatchGPUInterface::BinSize);
+		OutEnvironment.SetDefine(TEXT("INSTANCE_DATA_STRIDE"), AutoPaintInstancedTexturePatch::InstanceDataStride);
+	}
+};
+
+class FApplyInstancedTextureWeightPatchPS : public FApplyInstancedTextureHeightPatchPS
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyInstancedTextureWeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyInstancedTextureWeightPatchPS, FApplyInstancedTextureHeightPatchPS);
+
+public:
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FApplyInstancedTextureHeightPatchPS::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("INSTANCED_WEIGHT_PATCH"), 1);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FApplyInstancedTextureHeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintTexturePatchPS.usf", "ApplyInstancedTexturePatch", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FApplyInstancedTextureWeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintTexturePatchPS.usf", "ApplyInstancedTexturePatch", SF_Pixel);
+
+namespace AutoPaintInstancedTexturePatch
+{
+	/** Binned pass applying instances [InFirst, InEnd), which sample at most MaxBucketsPerPass atlas buckets */
+	void AddInstancesPass(FRDGBuilder& GraphBuilder, FRDGTextureRef DestinationTexture, const FAutoPaintInstancedTexturePatchDispatchParams& Params,
+		TConstArrayView<FAutoPaintPatchAtlas::FSlot> PatchSlots, TConstArrayView<int32> PassBuckets, int32 InFirst, int32 InEnd)
+	{
+		constexpr int32 BinSize = FAutoPaintInstancedTexturePatchGPUInterface::BinSize;
+
+		auto IsApplied = [&PatchSlots](const FAutoPaintTexturePatchInstance& Instance)
+		{
+			return !Instance.DestinationBounds.IsEmpty() && PatchSlots.IsValidIndex(Instance.PatchIndex) && PatchSlots[Instance.PatchIndex].IsValid();
+		};
+
+		// Union of all instances, the only region that is copied and drawn
+		FIntRect UnionBounds;
+		for (int32 InstanceIndex = InFirst; InstanceIndex < InEnd; ++InstanceIndex)
+		{
+			const FAutoPaintTexturePatchInstance& Instance = Params.Instances[InstanceIndex];
+			if (IsApplied(Instance))
+			{
+				if (UnionBounds.IsEmpty())
+				{
+					UnionBounds = Instance.DestinationBounds;
+				}
+				else
+				{
+					UnionBounds.Union(Instance.DestinationBounds);
+				}
+			}
+		}
+		if (UnionBounds.IsEmpty())
+		{
+			return;
+		}
+
+		// Counting sort of instances into bins keeps application order inside every bin
+		const FIntPoint NumBins(FMath::DivideAndRoundUp(UnionBounds.Width(), BinSize), FMath::DivideAndRoundUp(UnionBounds.Height(), BinSize));
+		TArray<uint32> BinOffsets;
+		BinOffsets.SetNumZeroed(NumBins.X * NumBins.Y + 1);
+
+		// Inclusive range of bins touched by the bounds
+		auto GetBinRange = [&UnionBounds](const FIntRect& Bounds, FIntPoint& OutFirst, FIntPoint& OutLast)
+		{
+			OutFirst = (Bounds.Min - UnionBounds.Min) / BinSize;
+			OutLast = (Bounds.Max - UnionBounds.Min - FIntPoint(1, 1)) / BinSize;
+		};
+
+		for (int32 InstanceIndex = InFirst; InstanceIndex < InEnd; ++InstanceIndex)
+		{
+			const FAutoPaintTexturePatchInstance& Instance = Params.Instances[InstanceIndex];
+			if (!IsApplied(Instance))
+			{
+				continue;
+			}
+			FIntPoint FirstBin, LastBin;
+			GetBinRange(Instance.DestinationBounds, FirstBin, LastBin);
+			for (int32 BinY = FirstBin.Y; BinY <= LastBin.Y; ++BinY)
+			{
+				for (int32 BinX = FirstBin.X; BinX <= LastBin.X; ++BinX)
+				{
+					++BinOffsets[BinY * NumBins.X + BinX + 1];
+				}
+			}
+		}
+
+		for (int32 Index = 1; Index < BinOffsets.Num(); ++Index)
+		{
+			BinOffsets[Index] += BinOffsets[Index - 1];
+		}
+
+		TArray<uint32> BinInstances;
+		BinInstances.SetNumUninitialized(FMath::Max<int32>(BinOffsets.Last(), 1));
+		TArray<uint32> BinCursors(BinOffsets.GetData(), BinOffsets.Num() - 1);
+
+		TArray<FVector4f> InstanceData;
+		InstanceData.Reserve((InEnd - InFirst) * InstanceDataStride);
+
+		for (int32 InstanceIndex = InFirst; InstanceIndex < InEnd; ++InstanceIndex)
+		{
+			const FAutoPaintTexturePatchInstance& Instance = Params.Instances[InstanceIndex];
+			if (!IsApplied(Instance))
+			{
+				// Keep indices dense, never referenced by a bin
+				InstanceData.AddZeroed(InstanceDataStride);
+				continue;
+			}
+
+			// Per instance descriptor: transform, blend params and where the patch lives in the atlas
+			const FAutoPaintInstancedTexturePatchSource& Patch = Params.Patches[Instance.PatchIndex];
+			const FAutoPaintPatchAtlas::FSlot& Slot = PatchSlots[Instance.PatchIndex];
+			const FMatrix44f& M = Instance.HeightmapToPatch;
+			const FVector2f RowW = Params.bWeightmap ? Instance.DerivedHeightScale : FVector2f(Instance.HeightScale, Instance.HeightOffset);
+			InstanceData.Emplace(M.M[0][0], M.M[0][1], M.M[0][3], RowW.X);
+			InstanceData.Emplace(M.M[1][0], M.M[1][1], M.M[1][3], RowW.Y);
+			InstanceData.Emplace(Instance.FalloffWorldMargin, Patch.ZeroInEncoding, PassBuckets.IndexOfByKey(Slot.Bucket), Slot.Slice);
+			InstanceData.Emplace(Patch.PatchWorldDimensions.X, Patch.PatchWorldDimensions.Y, Patch.EdgeUVDeadBorder.X, Patch.EdgeUVDeadBorder.Y);
+			InstanceData.Emplace(Slot.UVScale.X, Slot.UVScale.Y, Patch.bShapeFalloff ? 1.f : 0.f, Patch.bHasDerivatives ? 1.f : 0.f);
+
+			FIntPoint FirstBin, LastBin;
+			GetBinRange(Instance.DestinationBounds, FirstBin, LastBin);
+			for (int32 BinY = FirstBin.Y; BinY <= LastBin.Y; ++BinY)
+			{
+				for (int32 BinX = FirstBin.X; BinX <= LastBin.X; ++BinX)
+				{
+					BinInstances[BinCursors[BinY * NumBins.X + BinX]++] = InstanceIndex - InFirst;
+				}
+			}
+		}
+
+		// One snapshot for every instance of the pass, so we can read and write at the same time
+		FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("AutoPaintInstancedTexturePatchInputCopy"));
+
+		FRHICopyTextureInfo CopyTextureInfo;
+		CopyTextureInfo.NumMips = 1;
+		CopyTextureInfo.SourcePosition = FIntVector(UnionBounds.Min.X, UnionBounds.Min.Y, 0);
+		CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+		CopyTextureInfo.Size = FIntVector(UnionBounds.Width(), UnionBounds.Height(), 0);
+		AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
+
+		FAutoPaintInstancedTexturePatchParameters* ShaderParams = GraphBuilder.AllocParameters<FAutoPaintInstancedTexturePatchParameters>();
+
+		ShaderParams->InSource = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InputCopy, 0));
+
+		// Unused slots repeat the first bucket, every slot has to be bound
+		FRDGTextureSRVRef AtlasSRVs[FAutoPaintInstancedTexturePatchGPUInterface::MaxBucketsPerPass];
+		for (int32 Index = 0; Index < UE_ARRAY_COUNT(AtlasSRVs); ++Index)
+		{
+			const int32 Bucket = PassBuckets[PassBuckets.IsValidIndex(Index) ? Index : 0];
+			AtlasSRVs[Index] = GraphBuilder.CreateSRV(FRDGTextureSRVDesc(GAutoPaintPatchAtlas.GetBucketTexture(GraphBuilder, Bucket)));
+		}
+		ShaderParams->InAtlas0 = AtlasSRVs[0];
+		ShaderParams->InAtlas1 = AtlasSRVs[1];
+		ShaderParams->InAtlas2 = AtlasSRVs[2];
+		ShaderParams->InAtlas3 = AtlasSRVs[3];
+		ShaderParams->InPatchSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp>::GetRHI();
+
+		ShaderParams->InInstanceData = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintInstancedTexturePatchInstances"), InstanceData));
+		ShaderParams->InBinOffsets = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintInstancedTexturePatchBinOffsets"), BinOffsets));
+		ShaderParams->InBinInstances = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintInstancedTexturePatchBinInstances"), BinInstances));
+		ShaderParams->InBinOrigin = FUintVector2(UnionBounds.Min.X, UnionBounds.Min.Y);
+		ShaderParams->InNumBinsX = NumBins.X;
+
+		const FAutoPaintDerivedWeightParams& Derived = Params.DerivedWeight;
+		ShaderParams->InDerivedSlopeRange = FVector4f(Derived.SlopeRange, Params.bWeightmap && Derived.bEnabled ? 1.f : 0.f);
+		ShaderParams->InDerivedCurvatureRange = FVector4f(Derived.CurvatureRange, Derived.bUseCurvature ? 1.f : 0.f);
+
+		ShaderParams->RenderTargets[0] = FRenderTargetBinding(DestinationTexture, ERenderTargetLoadAction::ELoad, /*InMipIndex = */0);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		if (Params.bWeightmap)
+		{
+			TShaderMapRef<FApplyInstancedTextureWeightPatchPS> PixelShader(ShaderMap);
+			FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("AutoPaintInstancedTextureWeightPatch %d", InEnd - InFirst),
+				PixelShader, ShaderParams, UnionBounds);
+		}
+		else
+		{
+			TShaderMapRef<FApplyInstancedTextureHeightPatchPS> PixelShader(ShaderMap);
+			FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("AutoPaintInstancedTextureHeightPatch %d", InEnd - InFirst),
+				PixelShader, ShaderParams, UnionBounds);
+		}
+	}
+}
+
+void FAutoPaintInstancedTexturePatchGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintInstancedTexturePatchDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_InstancedTexturePatch_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, InstancedTexturePatch_RT);
+
+	if (Params.Instances.IsEmpty())
+	{
+		return;
+	}
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ApplyInstancedTexturePatch"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintInstancedTexturePatch);
+
+	// Make every patch resident first, so passes bind the final atlas arrays
+	GAutoPaintPatchAtlas.BeginUse();
+	TArray<FAutoPaintPatchAtlas::FSlot> PatchSlots;
+	PatchSlots.Reserve(Params.Patches.Num());
+	for (const FAutoPaintInstancedTexturePatchSource& Patch : Params.Patches)
+	{
+		PatchSlots.Add(Patch.Texture ? GAutoPaintPatchAtlas.FindOrAdd(GraphBuilder, Patch.Texture->GetTexture2DRHI(), Patch.ContentId) : FAutoPaintPatchAtlas::FSlot());
+	}
+
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("AutoPaintInstancedTexturePatchOutput"));
+	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+	// Consecutive runs of instances that fit the bound atlas slots, usually a single pass
+	int32 First = 0;
+	while (First < Params.Instances.Num())
+	{
+		TArray<int32, TInlineAllocator<MaxBucketsPerPass>> PassBuckets;
+		int32 End = First;
+		for (; End < Params.Instances.Num(); ++End)
+		{
+			const int32 PatchIndex = Params.Instances[End].PatchIndex;
+			if (!PatchSlots.IsValidIndex(PatchIndex) || !PatchSlots[PatchIndex].IsValid())
+			{
+				continue;
+			}
+			const int32 Bucket = PatchSlots[PatchIndex].Bucket;
+			if (!PassBuckets.Contains(Bucket))
+			{
+				if (PassBuckets.Num() == MaxBucketsPerPass)
+				{
+					break;
+				}
+				PassBuckets.Add(Bucket);
+			}
+		}
+
+		if (PassBuckets.Num() > 0)
+		{
+			AutoPaintInstancedTexturePatch::AddInstancesPass(GraphBuilder, DestinationTexture, Params, PatchSlots, PassBuckets, First, End);
+		}
+		First = End;
+	}
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintInstancedTexturePatchGPUInterface::Dispatch_GameThread(const FAutoPaintInstancedTexturePatchDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintInstancedTexturePatch)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintInstancedTexturePatchGPUInterface::Dispatch(const FAutoPaintInstancedTexturePatchDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
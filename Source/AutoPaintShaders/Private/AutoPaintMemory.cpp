@@ -0,0 +1,131 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintMemory.h"
+
+#include "AutoPaintStats.h"
+#include "RenderGraphBuilder.h"
+#include "Engine/Texture.h"
+#include "HAL/IConsoleManager.h"
+#include <atomic>
+
+DECLARE_MEMORY_STAT(TEXT("Transient Textures (last frame)"), STAT_AutoPaint_TransientMemory, STATGROUP_AutoPaint);
+DECLARE_MEMORY_STAT(TEXT("Patch Atlas"), STAT_AutoPaint_AtlasMemory, STATGROUP_AutoPaint);
+
+namespace AutoPaintMemory
+{
+	/** Render thread frame the current transient sum belongs to */
+	static uint32 TransientFrame = MAX_uint32;
+	static int64 FrameTransientBytes = 0;
+
+	static std::atomic<int64> LastTransientBytes = 0;
+	static std::atomic<int64> PeakTransientBytes = 0;
+	static std::atomic<int64> AtlasBytes = 0;
+
+	static FAutoConsoleCommandWithOutputDevice MemReportCommand(
+		TEXT("AutoPaint.MemReport"),
+		TEXT("Logs the GPU memory held by AutoPaint assets, editors, capture targets and landscape patches."),
+		FConsoleCommandWithOutputDeviceDelegate::CreateStatic(&Dump));
+}
+
+FOnGatherAutoPaintMemory& AutoPaintMemory::OnGather()
+{
+	static FOnGatherAutoPaintMemory Delegate;
+	return Delegate;
+}
+
+TArray<FAutoPaintMemoryEntry> AutoPaintMemory::Gather()
+{
+	check(IsInGameThread());
+
+	TArray<FAutoPaintMemoryEntry> Entries;
+	OnGather().Broadcast(Entries);
+	Entries.Add({ TEXT("Landscape"), TEXT("Patch atlas"), GetAtlasBytes() });
+
+	Entries.RemoveAll([](const FAutoPaintMemoryEntry& Entry) { return Entry.Bytes <= 0; });
+	Entries.Sort([](const FAutoPaintMemoryEntry& A, const FAutoPaintMemoryEntry& B) { return A.Bytes > B.Bytes; });
+	return Entries;
+}
+
+int64 AutoPaintMemory::GetTextureBytes(const UTexture* InTexture)
+{
+	return IsValid(InTexture) ? static_cast<int64>(InTexture->CalcTextureMemorySizeEnum(TMC_ResidentMips)) : 0;
+}
+
+FRDGTextureRef AutoPaintMemory::CreateTransientTexture(FRDGBuilder& GraphBuilder, const FRDGTextureDesc& InDesc, const TCHAR* InName)
+{
+	check(IsInRenderingThread());
+
+	if (TransientFrame != GFrameNumberRenderThread)
+	{
+		TransientFrame = GFrameNumberRenderThread;
+		FrameTransientBytes = 0;
+	}
+
+	const FPixelFormatInfo& FormatInfo = GPixelFormats[InDesc.Format];
+	const int64 Bytes = static_cast<int64>(FMath::DivideAndRoundUp(InDesc.Extent.X, FormatInfo.BlockSizeX))
+		* FMath::DivideAndRoundUp(InDesc.Extent.Y, FormatInfo.BlockSizeY) * FormatInfo.BlockBytes * InDesc.Depth * InDesc.ArraySize;
+	FrameTransientBytes += Bytes;
+
+	LastTransientBytes = FrameTransientBytes;
+	if (FrameTransientBytes > PeakTransientBytes)
+	{
+		PeakTransientBytes = FrameTransientBytes;
+	}
+	SET_MEMORY_STAT(STAT_AutoPaint_TransientMemory, FrameTransientBytes);
+
+	return GraphBuilder.CreateTexture(InDesc, InName);
+}
+
+int64 AutoPaintMemory::GetLastTransientBytes()
+{
+	return LastTransientBytes;
+}
+
+int64 AutoPaintMemory::GetPeakTransientBytes()
+{
+	return PeakTransientBytes;
+}
+
+void AutoPaintMemory::ResetPeakTransientBytes()
+{
+	PeakTransientBytes = 0;
+}
+
+void AutoPaintMemory::SetAtlasBytes(int64 InBytes)
+{
+	AtlasBytes = InBytes;
+	SET_MEMORY_STAT(STAT_AutoPaint_AtlasMemory, InBytes);
+}
+
+int64 AutoPaintMemory::GetAtlasBytes()
+{
+	return AtlasBytes;
+}
+
+void AutoPaintMemory::Dump(FOutputDevice& Ar)
+{
+	const TArray<FAutoPaintMemoryEntry> Entries = Gather();
+
+	TMap<FString, int64> CategoryBytes;
+	int64 TotalBytes = 0;
+	for (const FAutoPaintMemoryEntry& Entry : Entries)
+	{
+		CategoryBytes.FindOrAdd(Entry.Category) += Entry.Bytes;
+		TotalBytes += Entry.Bytes;
+	}
+
+	Ar.Logf(TEXT("AutoPaint memory: %.2f MiB held, transient %.2f MiB last frame, %.2f MiB peak"),
+		TotalBytes / 1048576.0, GetLastTransientBytes() / 1048576.0, GetPeakTransientBytes() / 1048576.0);
+	for (const TPair<FString, int64>& Category : CategoryBytes)
+	{
+		Ar.Logf(TEXT("  %s: %.2f MiB"), *Category.Key, Category.Value / 1048576.0);
+		for (const FAutoPaintMemoryEntry& Entry : Entries)
+		{
+			if (Entry.Category == Category.Key)
+			{
+				Ar.Logf(TEXT("    %10.2f KiB  %s"), Entry.Bytes / 1024.0, *Entry.Name);
+			}
+		}
+	}
+}
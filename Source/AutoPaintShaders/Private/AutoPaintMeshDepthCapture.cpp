@@ -0,0 +1,423 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintMeshDepthCapture.h"
+
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
+#include "CommonRenderResources.h"
+#include "PixelShaderUtils.h"
+#include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "StaticMeshResources.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+DECLARE_CYCLE_STAT(TEXT("Mesh Depth Capture (RT)"), STAT_AutoPaint_MeshDepthCapture_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintMeshDepthCapture, TEXT("AutoPaint Mesh Depth Capture"));
+
+BEGIN_SHADER_PARAMETER_STRUCT(FAutoPaintMeshDepthCaptureParameters, )
+	// LOD0 positions, 3 floats per vertex
+	SHADER_PARAMETER_SRV(Buffer<float>, InPositions)
+	SHADER_PARAMETER(FMatrix44f, InLocalToView)
+	SHADER_PARAMETER(FMatrix44f, InViewToClip)
+END_SHADER_PARAMETER_STRUCT()
+
+BEGIN_SHADER_PARAMETER_STRUCT(FAutoPaintMeshDepthCapturePassParameters, )
+	RENDER_TARGET_BINDING_SLOTS() // Holds our output
+END_SHADER_PARAMETER_STRUCT()
+
+/**
+ * Transforms mesh positions fetched by vertex id, passes view depth to the pixel shader.
+ */
+class FAutoPaintMeshDepthCaptureVS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FAutoPaintMeshDepthCaptureVS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FAutoPaintMeshDepthCaptureVS, FGlobalShader);
+
+public:
+	using FParameters = FAutoPaintMeshDepthCaptureParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+class FAutoPaintMeshDepthCapturePS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FAutoPaintMeshDepthCapturePS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FAutoPaintMeshDepthCapturePS, FGlobalShader);
+
+public:
+	using FParameters = FAutoPaintMeshDepthCaptureParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+/**
+ * Adds weighted sample depth to the accumulation target, or copies it with weight 1 into the output format.
+ */
+class FAutoPaintMeshDepthAccumulatePS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FAutoPaintMeshDepthAccumulatePS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FAutoPaintMeshDepthAccumulatePS, FGlobalShader);
+
+public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE(Texture2D<float>, InSampleDepth)
+		SHADER_PARAMETER(float, InSampleWeight)
+		RENDER_TARGET_BINDING_SLOTS() // Holds our output
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+/**
+ * Adds the weighted channel of the drawn section where it is the nearest surface.
+ */
+class FAutoPaintMeshSectionMaskPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FAutoPaintMeshSectionMaskPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FAutoPaintMeshSectionMaskPS, FGlobalShader);
+
+public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_TEXTURE(Texture2D<float>, InNearestDepth)
+		SHADER_PARAMETER(FVector4f, InSectionMask)
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return IsFeatureLevelSupported(Parameters.Platform, ERHIFeatureLevel::SM5);
+	}
+};
+
+BEGIN_SHADER_PARAMETER_STRUCT(FAutoPaintMeshSectionMaskPassParameters, )
+	RDG_TEXTURE_ACCESS(NearestDepth, ERHIAccess::SRVGraphics)
+	RENDER_TARGET_BINDING_SLOTS() // Holds our output
+END_SHADER_PARAMETER_STRUCT()
+
+IMPLEMENT_GLOBAL_SHADER(FAutoPaintMeshDepthCaptureVS, "/Plugin/AutoPaint/Private/AutoPaintMeshDepthCapture.usf", "MeshDepthCaptureVS", SF_Vertex);
+IMPLEMENT_GLOBAL_SHADER(FAutoPaintMeshDepthCapturePS, "/Plugin/AutoPaint/Private/AutoPaintMeshDepthCapture.usf", "MeshDepthCapturePS", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FAutoPaintMeshDepthAccumulatePS, "/Plugin/AutoPaint/Private/AutoPaintMeshDepthCapture.usf", "MeshDepthAccumulatePS", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FAutoPaintMeshSectionMaskPS, "/Plugin/AutoPaint/Private/AutoPaintMeshDepthCapture.usf", "MeshSectionMaskPS", SF_Pixel);
+
+namespace AutoPaintMeshDepthCapture
+{
+	float Halton(int32 Index, int32 Base)
+	{
+		float Result = 0.f;
+		float InvBase = 1.f / Base;
+		float Fraction = InvBase;
+		while (Index > 0)
+		{
+			Result += (Index % Base) * Fraction;
+			Index /= Base;
+			Fraction *= InvBase;
+		}
+		return Result;
+	}
+
+	/** Binds LOD0 positions of the mesh to the vertex shader, returns its index buffer or nullptr if it can't be drawn */
+	FRHIBuffer* SetMeshParameters(FRHICommandList& RHICmdList, const TShaderMapRef<FAutoPaintMeshDepthCaptureVS>& VertexShader, const FAutoPaintMeshDepthCaptureMesh& Mesh,
+		const FMatrix44f& WorldToView, const FMatrix44f& ViewToClip)
+	{
+		if (!Mesh.RenderData || Mesh.RenderData->LODResources.Num() == 0)
+		{
+			return nullptr;
+		}
+
+		const FStaticMeshLODResources& LODResources = Mesh.RenderData->LODResources[0];
+		FRHIShaderResourceView* PositionsSRV = LODResources.VertexBuffers.PositionVertexBuffer.GetSRV();
+		FRHIBuffer* IndexBuffer = LODResources.IndexBuffer.IndexBufferRHI;
+		if (!PositionsSRV || !IndexBuffer)
+		{
+			// @todo: Error
+			return nullptr;
+		}
+
+		FAutoPaintMeshDepthCaptureParameters ShaderParams;
+		ShaderParams.InPositions = PositionsSRV;
+		ShaderParams.InLocalToView = Mesh.LocalToWorld * WorldToView;
+		ShaderParams.InViewToClip = ViewToClip;
+		SetShaderParameters(RHICmdList, VertexShader, VertexShader.GetVertexShader(), ShaderParams);
+		return IndexBuffer;
+	}
+
+	/** Clears OutputTexture and draws all meshes with min blending */
+	void AddMeshDepthPass(FRDGBuilder& GraphBuilder, FRDGTextureRef OutputTexture, const FAutoPaintMeshDepthCaptureDispatchParams& Params, const FMatrix44f& ViewToClip)
+	{
+		AddClearRenderTargetPass(GraphBuilder, OutputTexture, FLinearColor(Params.ClearDepth, 0.f, 0.f, 0.f));
+
+		FAutoPaintMeshDepthCapturePassParameters* PassParams = GraphBuilder.AllocParameters<FAutoPaintMeshDepthCapturePassParameters>();
+		PassParams->RenderTargets[0] = FRenderTargetBinding(OutputTexture, ERenderTargetLoadAction::ELoad, /*InMipIndex = */0);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FAutoPaintMeshDepthCaptureVS> VertexShader(ShaderMap);
+		TShaderMapRef<FAutoPaintMeshDepthCapturePS> PixelShader(ShaderMap);
+
+		const FIntPoint Size = OutputTexture->Desc.Extent;
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("MeshDepth %dx%d, %d meshes", Size.X, Size.Y, Params.Meshes.Num()),
+			PassParams,
+			ERDGPassFlags::Raster,
+			[VertexShader, PixelShader, Size, Meshes = Params.Meshes, WorldToView = Params.WorldToView, ViewToClip](FRHICommandList& RHICmdList)
+			{
+				FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				// Nearest surface wins, no depth buffer needed
+				GraphicsPSOInit.BlendState = TStaticBlendState<CW_RED, BO_Min, BF_One, BF_One>::GetRHI();
+				GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+				GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+				SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+
+				RHICmdList.SetViewport(0.f, 0.f, 0.f, Size.X, Size.Y, 1.f);
+
+				for (const FAutoPaintMeshDepthCaptureMesh& Mesh : Meshes)
+				{
+					FRHIBuffer* IndexBuffer = SetMeshParameters(RHICmdList, VertexShader, Mesh, WorldToView, ViewToClip);
+					if (!IndexBuffer)
+					{
+						continue;
+					}
+
+					const FStaticMeshLODResources& LODResources = Mesh.RenderData->LODResources[0];
+					const uint32 NumVertices = LODResources.VertexBuffers.PositionVertexBuffer.GetNumVertices();
+					const uint32 NumTriangles = LODResources.IndexBuffer.GetNumIndices() / 3;
+					RHICmdList.DrawIndexedPrimitive(IndexBuffer, /*BaseVertexIndex = */0, /*FirstInstance = */0, NumVertices, /*StartIndex = */0, NumTriangles, /*NumInstances = */1);
+				}
+			});
+	}
+
+	/** Draws sections mapped to a mask channel, fragments at the depth resolved in NearestDepthTexture add their weighted channel */
+	void AddSectionMaskPass(FRDGBuilder& GraphBuilder, FRDGTextureRef NearestDepthTexture, FRDGTextureRef OutputTexture, const FAutoPaintMeshDepthCaptureDispatchParams& Params,
+		const FMatrix44f& ViewToClip, float Weight)
+	{
+		FAutoPaintMeshSectionMaskPassParameters* PassParams = GraphBuilder.AllocParameters<FAutoPaintMeshSectionMaskPassParameters>();
+		PassParams->NearestDepth = NearestDepthTexture;
+		PassParams->RenderTargets[0] = FRenderTargetBinding(OutputTexture, ERenderTargetLoadAction::ELoad, /*InMipIndex = */0);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FAutoPaintMeshDepthCaptureVS> VertexShader(ShaderMap);
+		TShaderMapRef<FAutoPaintMeshSectionMaskPS> PixelShader(ShaderMap);
+
+		const FIntPoint Size = OutputTexture->Desc.Extent;
+
+		GraphBuilder.AddPass(
+			RDG_EVENT_NAME("MeshSectionMask %dx%d", Size.X, Size.Y),
+			PassParams,
+			ERDGPassFlags::Raster,
+			[VertexShader, PixelShader, Size, NearestDepthTexture, Meshes = Params.Meshes, WorldToView = Params.WorldToView, ViewToClip, Weight](FRHICommandList& RHICmdList)
+			{
+				FGraphicsPipelineStateInitializer GraphicsPSOInit;
+				RHICmdList.ApplyCachedRenderTargets(GraphicsPSOInit);
+				GraphicsPSOInit.BlendState = TStaticBlendState<CW_RGBA, BO_Add, BF_One, BF_One, BO_Add, BF_One, BF_One>::GetRHI();
+				GraphicsPSOInit.RasterizerState = TStaticRasterizerState<FM_Solid, CM_None>::GetRHI();
+				GraphicsPSOInit.DepthStencilState = TStaticDepthStencilState<false, CF_Always>::GetRHI();
+				GraphicsPSOInit.BoundShaderState.VertexDeclarationRHI = GEmptyVertexDeclaration.VertexDeclarationRHI;
+				GraphicsPSOInit.BoundShaderState.VertexShaderRHI = VertexShader.GetVertexShader();
+				GraphicsPSOInit.BoundShaderState.PixelShaderRHI = PixelShader.GetPixelShader();
+				GraphicsPSOInit.PrimitiveType = PT_TriangleList;
+				SetGraphicsPipelineState(RHICmdList, GraphicsPSOInit, 0);
+
+				RHICmdList.SetViewport(0.f, 0.f, 0.f, Size.X, Size.Y, 1.f);
+
+				for (const FAutoPaintMeshDepthCaptureMesh& Mesh : Meshes)
+				{
+					if (Mesh.SectionChannels.IsEmpty())
+					{
+						// Only occludes, already part of the nearest depth
+						continue;
+					}
+
+					FRHIBuffer* IndexBuffer = SetMeshParameters(RHICmdList, VertexShader, Mesh, WorldToView, ViewToClip);
+					if (!IndexBuffer)
+					{
+						continue;
+					}
+
+					const FStaticMeshLODResources& LODResources = Mesh.RenderData->LODResources[0];
+					const uint32 NumVertices = LODResources.VertexBuffers.PositionVertexBuffer.GetNumVertices();
+					for (int32 SectionIndex = 0; SectionIndex < LODResources.Sections.Num(); ++SectionIndex)
+					{
+						const FStaticMeshSection& Section = LODResources.Sections[SectionIndex];
+						const int32 Channel = Mesh.SectionChannels.IsValidIndex(SectionIndex) ? Mesh.SectionChannels[SectionIndex] : INDEX_NONE;
+						if (Channel < 0 || Channel > 3 || Section.NumTriangles == 0)
+						{
+							continue;
+						}
+
+						FAutoPaintMeshSectionMaskPS::FParameters ShaderParams;
+						ShaderParams.InNearestDepth = NearestDepthTexture->GetRHI();
+						ShaderParams.InSectionMask = FVector4f::Zero();
+						ShaderParams.InSectionMask[Channel] = Weight;
+						SetShaderParameters(RHICmdList, PixelShader, PixelShader.GetPixelShader(), ShaderParams);
+
+						RHICmdList.DrawIndexedPrimitive(IndexBuffer, /*BaseVertexIndex = */0, /*FirstInstance = */0, NumVertices, Section.FirstIndex, Section.NumTriangles, /*NumInstances = */1);
+					}
+				}
+			});
+	}
+
+	void AddAccumulatePass(FRDGBuilder& GraphBuilder, FRDGTextureRef SampleTexture, FRDGTextureRef OutputTexture, float Weight, bool bAdditive)
+	{
+		FAutoPaintMeshDepthAccumulatePS::FParameters* ShaderParams = GraphBuilder.AllocParameters<FAutoPaintMeshDepthAccumulatePS::FParameters>();
+		ShaderParams->InSampleDepth = SampleTexture;
+		ShaderParams->InSampleWeight = Weight;
+		ShaderParams->RenderTargets[0] = FRenderTargetBinding(OutputTexture, ERenderTargetLoadAction::ELoad, /*InMipIndex = */0);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FAutoPaintMeshDepthAccumulatePS> PixelShader(ShaderMap);
+
+		FRHIBlendState* BlendState = bAdditive
+			? TStaticBlendState<CW_RED, BO_Add, BF_One, BF_One>::GetRHI()
+			: TStaticBlendState<CW_RED>::GetRHI();
+
+		FPixelShaderUtils::AddFullscreenPass(
+			GraphBuilder,
+			ShaderMap,
+			bAdditive ? RDG_EVENT_NAME("MeshDepthAccumulate") : RDG_EVENT_NAME("MeshDepthResolve"),
+			PixelShader,
+			ShaderParams,
+			FIntRect(FIntPoint::ZeroValue, OutputTexture->Desc.Extent),
+			BlendState);
+	}
+}
+
+void FAutoPaintMeshDepthCaptureGPUInterface::GetSamplePattern(int32 InNumSamples, bool bInTentFilter, TArray<FVector2f>& OutOffsets, TArray<float>& OutWeights)
+{
+	OutOffsets.Reset(InNumSamples);
+	OutWeights.Reset(InNumSamples);
+
+	if (InNumSamples <= 1)
+	{
+		OutOffsets.Add(FVector2f::ZeroVector);
+		OutWeights.Add(1.f);
+		return;
+	}
+
+	// Low discrepancy points over the filter footprint, weighted by the filter
+	float WeightSum = 0.f;
+	for (int32 Index = 0; Index < InNumSamples; ++Index)
+	{
+		const FVector2f Point(AutoPaintMeshDepthCapture::Halton(Index + 1, 2), AutoPaintMeshDepthCapture::Halton(Index + 1, 3));
+
+		FVector2f Offset;
+		float Weight;
+		if (bInTentFilter)
+		{
+			Offset = Point * 2.f - 1.f;
+			Weight = (1.f - FMath::Abs(Offset.X)) * (1.f - FMath::Abs(Offset.Y));
+		}
+		else
+		{
+			Offset = Point - 0.5f;
+			Weight = 1.f;
+		}
+
+		OutOffsets.Add(Offset);
+		OutWeights.Add(Weight);
+		WeightSum += Weight;
+	}
+
+	for (float& Weight : OutWeights)
+	{
+		Weight /= WeightSum;
+	}
+}
+
+bool FAutoPaintMeshDepthCaptureGPUInterface::IsSupported()
+{
+	return GMaxRHIFeatureLevel >= ERHIFeatureLevel::SM5 && RHISupportsManualVertexFetch(GMaxRHIShaderPlatform);
+}
+
+void FAutoPaintMeshDepthCaptureGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintMeshDepthCaptureDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_MeshDepthCapture_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, MeshDepthCapture_RT);
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("AutoPaintMeshDepthCapture"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintMeshDepthCapture);
+
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.DepthResult->GetResource()->GetTexture2DRHI(), TEXT("AutoPaintMeshDepthCaptureOutput"));
+	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+	// Sections are matched against full precision sample depth, so masks always go through the R32F sample target
+	const bool bSectionMask = Params.SectionMaskResult && Params.SectionMaskResult->GetResource();
+
+	if (Params.NumSamples <= 1 && !bSectionMask)
+	{
+		AutoPaintMeshDepthCapture::AddMeshDepthPass(GraphBuilder, DestinationTexture, Params, Params.ViewToClip);
+	}
+	else
+	{
+		const FIntPoint Size = DestinationTexture->Desc.Extent;
+		const FRDGTextureDesc Desc = FRDGTextureDesc::Create2D(Size, PF_R32_FLOAT, FClearValueBinding::Black, TexCreate_RenderTargetable | TexCreate_ShaderResource);
+		FRDGTextureRef SampleTexture = AutoPaintMemory::CreateTransientTexture(GraphBuilder, Desc, TEXT("AutoPaintMeshDepthSample"));
+		FRDGTextureRef AccumulationTexture = AutoPaintMemory::CreateTransientTexture(GraphBuilder, Desc, TEXT("AutoPaintMeshDepthAccumulation"));
+		AddClearRenderTargetPass(GraphBuilder, AccumulationTexture, FLinearColor::Black);
+
+		FRDGTextureRef SectionMaskTexture = nullptr;
+		if (bSectionMask)
+		{
+			TRefCountPtr<IPooledRenderTarget> SectionMaskRenderTarget = CreateRenderTarget(Params.SectionMaskResult->GetResource()->GetTexture2DRHI(), TEXT("AutoPaintMeshSectionMaskOutput"));
+			SectionMaskTexture = GraphBuilder.RegisterExternalTexture(SectionMaskRenderTarget);
+			AddClearRenderTargetPass(GraphBuilder, SectionMaskTexture, FLinearColor::Transparent);
+		}
+
+		TArray<FVector2f> Offsets;
+		TArray<float> Weights;
+		GetSamplePattern(Params.NumSamples, Params.bTentFilter, Offsets, Weights);
+
+		for (int32 Index = 0; Index < Offsets.Num(); ++Index)
+		{
+			// Shift in NDC: 2 units span the whole target, Y points up
+			const FVector NDCOffset(2.0 * Offsets[Index].X / Size.X, -2.0 * Offsets[Index].Y / Size.Y, 0.0);
+			const FMatrix44f JitteredViewToClip = Params.ViewToClip * FMatrix44f(FTranslationMatrix(NDCOffset));
+
+			AutoPaintMeshDepthCapture::AddMeshDepthPass(GraphBuilder, SampleTexture, Params, JitteredViewToClip);
+			AutoPaintMeshDepthCapture::AddAccumulatePass(GraphBuilder, SampleTexture, AccumulationTexture, Weights[Index], /*bAdditive = */true);
+			if (SectionMaskTexture)
+			{
+				AutoPaintMeshDepthCapture::AddSectionMaskPass(GraphBuilder, SampleTexture, SectionMaskTexture, Params, JitteredViewToClip, Weights[Index]);
+			}
+		}
+
+		AutoPaintMeshDepthCapture::AddAccumulatePass(GraphBuilder, AccumulationTexture, DestinationTexture, 1.f, /*bAdditive = */false);
+	}
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintMeshDepthCaptureGPUInterface::Dispatch_GameThread(const FAutoPaintMeshDepthCaptureDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintMeshDepthCapture)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintMeshDepthCaptureGPUInterface::Dispatch(const FAutoPaintMeshDepthCaptureDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
@@ -0,0 +1,176 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintPatchAtlas.h"
+
+#include "AutoPaintMemory.h"
+#include "RenderGraphBuilder.h"
+#include "RenderGraphUtils.h"
+#include "RenderTargetPool.h"
+
+TGlobalResource<FAutoPaintPatchAtlas> GAutoPaintPatchAtlas;
+
+void FAutoPaintPatchAtlas::BeginUse()
+{
+	check(IsInRenderingThread());
+	++UseCounter;
+}
+
+FAutoPaintPatchAtlas::FSlot FAutoPaintPatchAtlas::FindOrAdd(FRDGBuilder& GraphBuilder, FRHITexture* InTexture, const FGuid& InContentId)
+{
+	check(IsInRenderingThread());
+
+	if (!InTexture)
+	{
+		return FSlot();
+	}
+
+	const FIntVector SourceSize = InTexture->GetSizeXYZ();
+	const EPixelFormat Format = InTexture->GetFormat();
+
+	FEntry* Entry = Entries.Find(InContentId);
+	if (Entry && Entry->SourceTexture == InTexture)
+	{
+		Buckets[Entry->Slot.Bucket].SliceLastUse[Entry->Slot.Slice] = UseCounter;
+		return Entry->Slot;
+	}
+
+	const int32 BucketIndex = FindOrAddBucket(Format, FMath::RoundUpToPowerOfTwo(FMath::Max(SourceSize.X, SourceSize.Y)));
+
+	FSlot Slot;
+	if (Entry && Entry->Slot.Bucket == BucketIndex)
+	{
+		// Same content id with a new resource, copy over the old slice
+		Slot = Entry->Slot;
+	}
+	else
+	{
+		if (Entry)
+		{
+			Buckets[Entry->Slot.Bucket].SliceContentIds[Entry->Slot.Slice].Invalidate();
+			Entries.Remove(InContentId);
+		}
+
+		Slot.Bucket = BucketIndex;
+		Slot.Slice = AllocateSlice(GraphBuilder, BucketIndex);
+		if (Slot.Slice == INDEX_NONE)
+		{
+			// @todo: Error
+			return FSlot();
+		}
+	}
+
+	FBucket& Bucket = Buckets[BucketIndex];
+	Slot.UVScale = FVector2f(static_cast<float>(SourceSize.X) / Bucket.Size, static_cast<float>(SourceSize.Y) / Bucket.Size);
+
+	FRDGTextureRef SourceTexture = GraphBuilder.RegisterExternalTexture(CreateRenderTarget(InTexture, TEXT("AutoPaintPatchAtlasSource")));
+
+	FRHICopyTextureInfo CopyTextureInfo;
+	CopyTextureInfo.NumMips = 1;
+	CopyTextureInfo.NumSlices = 1;
+	CopyTextureInfo.DestSliceIndex = Slot.Slice;
+	CopyTextureInfo.Size = FIntVector(SourceSize.X, SourceSize.Y, 1);
+	AddCopyTexturePass(GraphBuilder, SourceTexture, GetBucketTexture(GraphBuilder, BucketIndex), CopyTextureInfo);
+
+	Bucket.SliceContentIds[Slot.Slice] = InContentId;
+	Bucket.SliceLastUse[Slot.Slice] = UseCounter;
+
+	FEntry& NewEntry = Entries.FindOrAdd(InContentId);
+	NewEntry.Slot = Slot;
+	NewEntry.SourceTexture = InTexture;
+
+	return Slot;
+}
+
+FRDGTextureRef FAutoPaintPatchAtlas::GetBucketTexture(FRDGBuilder& GraphBuilder, int32 InBucket) const
+{
+	return GraphBuilder.RegisterExternalTexture(Buckets[InBucket].Texture, TEXT("AutoPaintPatchAtlas"));
+}
+
+int64 FAutoPaintPatchAtlas::GetAllocatedBytes() const
+{
+	int64 Bytes = 0;
+	for (const FBucket& Bucket : Buckets)
+	{
+		Bytes += static_cast<int64>(Bucket.Size) * Bucket.Size * Bucket.NumSlices * GPixelFormats[Bucket.Format].BlockBytes;
+	}
+	return Bytes;
+}
+
+void FAutoPaintPatchAtlas::ReleaseRHI()
+{
+	Buckets.Empty();
+	Entries.Empty();
+
+	AutoPaintMemory::SetAtlasBytes(0);
+}
+
+int32 FAutoPaintPatchAtlas::FindOrAddBucket(EPixelFormat InFormat, int32 InSize)
+{
+	const int32 Existing = Buckets.IndexOfByPredicate([InFormat, InSize](const FBucket& Bucket)
+	{
+		return Bucket.Format == InFormat && Bucket.Size == InSize;
+	});
+	if (Existing != INDEX_NONE)
+	{
+		return Existing;
+	}
+
+	FBucket& Bucket = Buckets.AddDefaulted_GetRef();
+	Bucket.Format = InFormat;
+	Bucket.Size = InSize;
+	return Buckets.Num() - 1;
+}
+
+int32 FAutoPaintPatchAtlas::AllocateSlice(FRDGBuilder& GraphBuilder, int32 InBucket)
+{
+	FBucket& Bucket = Buckets[InBucket];
+
+	// Free slice, or the least recently used one that is not part of this use
+	int32 Slice = Bucket.SliceContentIds.IndexOfByPredicate([](const FGuid& ContentId) { return !ContentId.IsValid(); });
+	if (Slice == INDEX_NONE && Bucket.NumSlices < MaxSlicesPerBucket)
+	{
+		// Grow by doubling, existing slices are copied over
+		const int32 NumSlices = FMath::Min(FMath::Max(Bucket.NumSlices * 2, 4), MaxSlicesPerBucket);
+		const FRDGTextureDesc Desc = FRDGTextureDesc::Create2DArray(FIntPoint(Bucket.Size), Bucket.Format, FClearValueBinding::Black,
+			TexCreate_ShaderResource, NumSlices);
+		FRDGTextureRef NewTexture = GraphBuilder.CreateTexture(Desc, TEXT("AutoPaintPatchAtlas"));
+
+		if (Bucket.NumSlices > 0)
+		{
+			FRHICopyTextureInfo CopyTextureInfo;
+			CopyTextureInfo.NumMips = 1;
+			CopyTextureInfo.NumSlices = Bucket.NumSlices;
+			CopyTextureInfo.Size = FIntVector(Bucket.Size, Bucket.Size, 1);
+			AddCopyTexturePass(GraphBuilder, GetBucketTexture(GraphBuilder, InBucket), NewTexture, CopyTextureInfo);
+		}
+
+		Slice = Bucket.NumSlices;
+		Bucket.Texture = GraphBuilder.ConvertToExternalTexture(NewTexture);
+		Bucket.NumSlices = NumSlices;
+		Bucket.SliceContentIds.SetNum(NumSlices);
+		Bucket.SliceLastUse.SetNumZeroed(NumSlices);
+
+		AutoPaintMemory::SetAtlasBytes(GetAllocatedBytes());
+	}
+	else if (Slice == INDEX_NONE)
+	{
+		uint64 OldestUse = UseCounter;
+		for (int32 Index = 0; Index < Bucket.NumSlices; ++Index)
+		{
+			if (Bucket.SliceLastUse[Index] < OldestUse)
+			{
+				OldestUse = Bucket.SliceLastUse[Index];
+				Slice = Index;
+			}
+		}
+		if (Slice == INDEX_NONE)
+		{
+			return INDEX_NONE;
+		}
+		Entries.Remove(Bucket.SliceContentIds[Slice]);
+	}
+
+	Bucket.SliceContentIds[Slice].Invalidate();
+	return Slice;
+}
@@ -0,0 +1,339 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintPatchCompositePS.h"
+
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
+#include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "PixelShaderUtils.h"
+#include "LandscapeUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Patch Composite (RT)"), STAT_AutoPaint_PatchComposite_RT, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Patch Preview (RT)"), STAT_AutoPaint_PatchPreview_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintPatchCompositeAccumulate, TEXT("AutoPaint Patch Composite Accumulate"));
+DECLARE_GPU_STAT_NAMED(AutoPaintPatchCompositeApply, TEXT("AutoPaint Patch Composite Apply"));
+DECLARE_GPU_STAT_NAMED(AutoPaintPatchPreview, TEXT("AutoPaint Patch Preview"));
+
+class FAccumulateTextureHeightPatchPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FAccumulateTextureHeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FAccumulateTextureHeightPatchPS, FGlobalShader);
+
+public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InHeightPatch)
+		SHADER_PARAMETER_SAMPLER(SamplerState, InHeightPatchSampler)
+		SHADER_PARAMETER(FMatrix44f, InHeightmapToPatch)
+		SHADER_PARAMETER(float, InZeroInEncoding)
+		SHADER_PARAMETER(float, InHeightScale)
+		SHADER_PARAMETER(float, InHeightOffset)
+		SHADER_PARAMETER(FVector2f, InEdgeUVDeadBorder)
+		SHADER_PARAMETER(float, InFalloffWorldMargin)
+		SHADER_PARAMETER(FVector2f, InPatchWorldDimensions)
+		SHADER_PARAMETER(FVector4f, InPatchUVToTextureUV)
+		SHADER_PARAMETER(FVector4f, InPatchUVBounds)
+		SHADER_PARAMETER(uint32, InShapeFalloff)
+
+		RENDER_TARGET_BINDING_SLOTS() // Holds our output
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("ACCUMULATE_HEIGHT_PATCH"), 1);
+	}
+};
+
+class FApplyHeightCompositePS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyHeightCompositePS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyHeightCompositePS, FGlobalShader);
+
+public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSourceHeightmap)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InComposite)
+
+		RENDER_TARGET_BINDING_SLOTS() // Holds our output
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("APPLY_HEIGHT_COMPOSITE"), 1);
+	}
+};
+
+class FApplyHeightPreviewPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyHeightPreviewPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyHeightPreviewPS, FGlobalShader);
+
+public:
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSourceHeightmap)
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InComposite)
+		SHADER_PARAMETER_SAMPLER(SamplerState, InCompositeSampler)
+		SHADER_PARAMETER(FVector4f, InHeightmapToCompositeUV)
+
+		RENDER_TARGET_BINDING_SLOTS() // Holds our output
+	END_SHADER_PARAMETER_STRUCT()
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("APPLY_HEIGHT_PREVIEW"), 1);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FAccumulateTextureHeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintTexturePatchPS.usf", "AccumulateHeightPatch", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FApplyHeightCompositePS, "/Plugin/AutoPaint/Private/AutoPaintTexturePatchPS.usf", "ApplyHeightComposite", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FApplyHeightPreviewPS, "/Plugin/AutoPaint/Private/AutoPaintTexturePatchPS.usf", "ApplyHeightPreview", SF_Pixel);
+
+namespace AutoPaintPatchComposite
+{
+	/** Blends the patch target height and alpha into Target within the patch DestinationBounds */
+	void AddAccumulatePass(FRDGBuilder& GraphBuilder, FRDGTextureRef Target, const FAutoPaintTexturePatchDispatchParams& Patch)
+	{
+		if (Patch.DestinationBounds.IsEmpty() || !Patch.PatchTexture)
+		{
+			return;
+		}
+
+		FAccumulateTextureHeightPatchPS::FParameters* ShaderParams = GraphBuilder.AllocParameters<FAccumulateTextureHeightPatchPS::FParameters>();
+		ShaderParams->InHeightmapToPatch = Patch.HeightmapToPatch;
+		ShaderParams->InEdgeUVDeadBorder = Patch.EdgeUVDeadBorder;
+		ShaderParams->InFalloffWorldMargin = Patch.FalloffWorldMargin;
+		ShaderParams->InPatchWorldDimensions = Patch.PatchWorldDimensions;
+		ShaderParams->InPatchUVToTextureUV = Patch.PatchUVToTextureUV;
+		ShaderParams->InPatchUVBounds = Patch.PatchUVBounds;
+		ShaderParams->InShapeFalloff = Patch.bShapeFalloff ? 1 : 0;
+		ShaderParams->InZeroInEncoding = Patch.ZeroInEncoding;
+		ShaderParams->InHeightScale = Patch.HeightScale;
+		ShaderParams->InHeightOffset = Patch.HeightOffset;
+
+		TRefCountPtr<IPooledRenderTarget> PatchRenderTarget = CreateRenderTarget(Patch.PatchTexture->GetTexture2DRHI(), TEXT("AutoPaintPatchCompositeSource"));
+		FRDGTextureRef PatchTexture = GraphBuilder.RegisterExternalTexture(PatchRenderTarget);
+		ShaderParams->InHeightPatch = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(PatchTexture, 0));
+		ShaderParams->InHeightPatchSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp>::GetRHI();
+
+		ShaderParams->RenderTargets[0] = FRenderTargetBinding(Target, ERenderTargetLoadAction::ELoad, /*InMipIndex = */0);
+
+		FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+		TShaderMapRef<FAccumulateTextureHeightPatchPS> AccumulateShader(ShaderMap);
+
+		// Dst * (1 - a) + Src * a on R and G, see AccumulateHeightPatch
+		FPixelShaderUtils::AddFullscreenPass(
+			GraphBuilder,
+			ShaderMap,
+			RDG_EVENT_NAME("AccumulateTextureHeightPatch"),
+			AccumulateShader,
+			ShaderParams,
+			Patch.DestinationBounds,
+			TStaticBlendState<CW_RG, BO_Add, BF_SourceAlpha, BF_InverseSourceAlpha>::GetRHI());
+	}
+}
+
+void FAutoPaintPatchCompositeGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintPatchCompositeDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_PatchComposite_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, PatchComposite_RT);
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("AutoPaintPatchComposite"));
+
+	FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+
+	TRefCountPtr<IPooledRenderTarget> CompositeRenderTarget = CreateRenderTarget(Params.Composite->GetTexture2DRHI(), TEXT("AutoPaintPatchComposite"));
+	FRDGTextureRef CompositeTexture = GraphBuilder.RegisterExternalTexture(CompositeRenderTarget);
+
+	{
+		RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintPatchCompositeAccumulate);
+
+		for (const FIntRect& ClearRegion : Params.ClearRegions)
+		{
+			AddClearRenderTargetPass(GraphBuilder, CompositeTexture, FLinearColor::Transparent, ClearRegion);
+		}
+
+		for (const FAutoPaintTexturePatchDispatchParams& Patch : Params.Patches)
+		{
+			AutoPaintPatchComposite::AddAccumulatePass(GraphBuilder, CompositeTexture, Patch);
+		}
+	}
+
+	if (Params.CombinedResult && !Params.ApplyBounds.IsEmpty())
+	{
+		RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintPatchCompositeApply);
+
+		TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("AutoPaintPatchCompositeOutput"));
+		FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+		// Make a copy of our heightmap input so we can read and write at the same time (needed for blending)
+		FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("AutoPaintPatchCompositeInputCopy"));
+
+		FRHICopyTextureInfo CopyTextureInfo;
+		CopyTextureInfo.NumMips = 1;
+		CopyTextureInfo.SourcePosition = FIntVector(Params.ApplyBounds.Min.X, Params.ApplyBounds.Min.Y, 0);
+		CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+		CopyTextureInfo.Size = FIntVector(Params.ApplyBounds.Width(), Params.ApplyBounds.Height(), 0);
+		AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
+
+		FApplyHeightCompositePS::FParameters* ShaderParams = GraphBuilder.AllocParameters<FApplyHeightCompositePS::FParameters>();
+		ShaderParams->InSourceHeightmap = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InputCopy, 0));
+		ShaderParams->InComposite = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(CompositeTexture, 0));
+		ShaderParams->RenderTargets[0] = FRenderTargetBinding(DestinationTexture, ERenderTargetLoadAction::ENoAction, /*InMipIndex = */0);
+
+		TShaderMapRef<FApplyHeightCompositePS> ApplyShader(ShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(
+			GraphBuilder,
+			ShaderMap,
+			RDG_EVENT_NAME("ApplyHeightComposite"),
+			ApplyShader,
+			ShaderParams,
+			Params.ApplyBounds);
+	}
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintPatchCompositeGPUInterface::Dispatch_GameThread(const FAutoPaintPatchCompositeDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintPatchComposite)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintPatchCompositeGPUInterface::Dispatch(const FAutoPaintPatchCompositeDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
+
+void FAutoPaintPatchPreviewGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintPatchPreviewDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_PatchPreview_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, PatchPreview_RT);
+
+	FIntRect Bounds;
+	for (const FAutoPaintTexturePatchDispatchParams& Patch : Params.Patches)
+	{
+		if (!Patch.DestinationBounds.IsEmpty())
+		{
+			if (Bounds.IsEmpty())
+			{
+				Bounds = Patch.DestinationBounds;
+			}
+			else
+			{
+				Bounds.Union(Patch.DestinationBounds);
+			}
+		}
+	}
+	if (Bounds.IsEmpty())
+	{
+		return;
+	}
+
+	const int32 Downsample = FMath::Max(Params.Downsample, 1);
+	const FIntPoint PreviewSize(FMath::DivideAndRoundUp(Bounds.Width(), Downsample), FMath::DivideAndRoundUp(Bounds.Height(), Downsample));
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("AutoPaintPatchPreview"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintPatchPreview);
+
+	FRDGTextureRef PreviewTexture = AutoPaintMemory::CreateTransientTexture(GraphBuilder,
+		FRDGTextureDesc::Create2D(PreviewSize, PF_G32R32F, FClearValueBinding::Transparent, TexCreate_ShaderResource | TexCreate_RenderTargetable),
+		TEXT("AutoPaintPatchPreview"));
+	AddClearRenderTargetPass(GraphBuilder, PreviewTexture, FLinearColor::Transparent);
+
+	// Preview pixel centers land every Downsample heightmap pixels, starting at the bounds
+	const FMatrix44f PreviewToHeightmap = FScaleMatrix44f(FVector3f(Downsample, Downsample, 1.f)) * FTranslationMatrix44f(FVector3f(Bounds.Min.X, Bounds.Min.Y, 0.f));
+	for (const FAutoPaintTexturePatchDispatchParams& Patch : Params.Patches)
+	{
+		FAutoPaintTexturePatchDispatchParams PreviewPatch = Patch;
+		PreviewPatch.HeightmapToPatch = (PreviewToHeightmap * Patch.HeightmapToPatch.GetTransposed()).GetTransposed();
+		PreviewPatch.DestinationBounds = FIntRect(
+			(Patch.DestinationBounds.Min - Bounds.Min) / Downsample,
+			FIntPoint(FMath::DivideAndRoundUp(Patch.DestinationBounds.Max.X - Bounds.Min.X, Downsample),
+				FMath::DivideAndRoundUp(Patch.DestinationBounds.Max.Y - Bounds.Min.Y, Downsample)));
+		AutoPaintPatchComposite::AddAccumulatePass(GraphBuilder, PreviewTexture, PreviewPatch);
+	}
+
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("AutoPaintPatchPreviewOutput"));
+	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+	// Make a copy of our heightmap input so we can read and write at the same time (needed for blending)
+	FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("AutoPaintPatchPreviewInputCopy"));
+
+	FRHICopyTextureInfo CopyTextureInfo;
+	CopyTextureInfo.NumMips = 1;
+	CopyTextureInfo.SourcePosition = FIntVector(Bounds.Min.X, Bounds.Min.Y, 0);
+	CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+	CopyTextureInfo.Size = FIntVector(Bounds.Width(), Bounds.Height(), 0);
+	AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
+
+	FApplyHeightPreviewPS::FParameters* ShaderParams = GraphBuilder.AllocParameters<FApplyHeightPreviewPS::FParameters>();
+	ShaderParams->InSourceHeightmap = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InputCopy, 0));
+	ShaderParams->InComposite = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(PreviewTexture, 0));
+	ShaderParams->InCompositeSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp>::GetRHI();
+	// Inverse of PreviewToHeightmap, normalized by the preview size
+	const FVector2f UVScale(1.f / (Downsample * PreviewSize.X), 1.f / (Downsample * PreviewSize.Y));
+	ShaderParams->InHeightmapToCompositeUV = FVector4f(UVScale.X, UVScale.Y, -Bounds.Min.X * UVScale.X, -Bounds.Min.Y * UVScale.Y);
+	ShaderParams->RenderTargets[0] = FRenderTargetBinding(DestinationTexture, ERenderTargetLoadAction::ENoAction, /*InMipIndex = */0);
+
+	FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+	TShaderMapRef<FApplyHeightPreviewPS> ApplyShader(ShaderMap);
+	FPixelShaderUtils::AddFullscreenPass(
+		GraphBuilder,
+		ShaderMap,
+		RDG_EVENT_NAME("ApplyHeightPreview"),
+		ApplyShader,
+		ShaderParams,
+		Bounds);
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintPatchPreviewGPUInterface::Dispatch_GameThread(const FAutoPaintPatchPreviewDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintPatchPreview)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintPatchPreviewGPUInterface::Dispatch(const FAutoPaintPatchPreviewDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
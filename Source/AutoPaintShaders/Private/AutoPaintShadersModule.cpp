@@ -1,5 +1,6 @@
 ﻿#include "AutoPaintShadersModule.h"
 
+#include "AutoPaintStats.h"
 #include "Interfaces/IPluginManager.h"
 #include "Misc/Paths.h"
 #include "ShaderCore.h" // AddShaderSourceDirectoryMapping
@@ -7,6 +8,9 @@
 
 #define LOCTEXT_NAMESPACE "FAutoPaintShadersModule"
 
+CSV_DEFINE_CATEGORY_MODULE(AUTOPAINTSHADERS_API, AutoPaint, true);
+LLM_DEFINE_TAG(AutoPaint);
+
 void FAutoPaintShadersModule::StartupModule()
 {
 	FString PluginShaderDir = FPaths::Combine(IPluginManager::Get().FindPlugin(TEXT("AutoPaint"))->GetBaseDir(), TEXT("Shaders"));
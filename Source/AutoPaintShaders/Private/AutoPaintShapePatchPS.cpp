@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintShapePatchPS.h"
+
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
+#include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "PixelShaderUtils.h"
+#include "LandscapeUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Shape Patch (RT)"), STAT_AutoPaint_ShapePatch_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintShapePatch, TEXT("AutoPaint Shape Patch"));
+
+namespace AutoPaintShapePatch
+{
+	BEGIN_SHADER_PARAMETER_STRUCT(FParameters, )
+		SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSourceTexture)
+		SHADER_PARAMETER(FMatrix44f, InHeightmapToShape)
+		SHADER_PARAMETER(FVector2f, InExtents)
+		SHADER_PARAMETER(float, InFalloff)
+		SHADER_PARAMETER(float, InValue)
+		SHADER_PARAMETER(uint32, InShape)
+		SHADER_PARAMETER(uint32, InBlendMode)
+		RENDER_TARGET_BINDING_SLOTS() // Holds our output
+	END_SHADER_PARAMETER_STRUCT()
+
+	static void ModifyCompilationEnvironment(FShaderCompilerEnvironment& OutEnvironment)
+	{
+		// Make our shape and blend mode choices match in the shader.
+		OutEnvironment.SetDefine(TEXT("SHAPE_CIRCLE"), static_cast<uint8>(EAutoPaintShapePatchType::Circle));
+		OutEnvironment.SetDefine(TEXT("SHAPE_RECTANGLE"), static_cast<uint8>(EAutoPaintShapePatchType::Rectangle));
+		OutEnvironment.SetDefine(TEXT("SHAPE_CAPSULE"), static_cast<uint8>(EAutoPaintShapePatchType::Capsule));
+		OutEnvironment.SetDefine(TEXT("SHAPE_RING"), static_cast<uint8>(EAutoPaintShapePatchType::Ring));
+
+		OutEnvironment.SetDefine(TEXT("ADDITIVE_MODE"), static_cast<uint8>(EAutoPaintShapePatchBlendMode::Additive));
+		OutEnvironment.SetDefine(TEXT("ALPHA_BLEND_MODE"), static_cast<uint8>(EAutoPaintShapePatchBlendMode::AlphaBlend));
+		OutEnvironment.SetDefine(TEXT("MIN_MODE"), static_cast<uint8>(EAutoPaintShapePatchBlendMode::Min));
+		OutEnvironment.SetDefine(TEXT("MAX_MODE"), static_cast<uint8>(EAutoPaintShapePatchBlendMode::Max));
+	}
+}
+
+/**
+ * Shader that applies an analytic shape to a landscape heightmap.
+ */
+class FApplyLandscapeShapeHeightPatchPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyLandscapeShapeHeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyLandscapeShapeHeightPatchPS, FGlobalShader);
+
+public:
+	using FParameters = AutoPaintShapePatch::FParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("SHAPE_HEIGHT_PATCH"), 1);
+		AutoPaintShapePatch::ModifyCompilationEnvironment(OutEnvironment);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FApplyLandscapeShapeHeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintShapePatchPS.usf", "ApplyLandscapeShapeHeightPatch", SF_Pixel);
+
+/**
+ * Shader that applies an analytic shape to a landscape weightmap or the visibility layer.
+ */
+class FApplyLandscapeShapeWeightPatchPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplyLandscapeShapeWeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplyLandscapeShapeWeightPatchPS, FGlobalShader);
+
+public:
+	using FParameters = AutoPaintShapePatch::FParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("SHAPE_WEIGHT_PATCH"), 1);
+		AutoPaintShapePatch::ModifyCompilationEnvironment(OutEnvironment);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FApplyLandscapeShapeWeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintShapePatchPS.usf", "ApplyLandscapeShapeWeightPatch", SF_Pixel);
+
+FVector2f FAutoPaintShapePatchGPUInterface::GetShapeHalfSize(EAutoPaintShapePatchType InShape, const FVector2f& InExtents, float InFalloff)
+{
+	FVector2f HalfSize = FVector2f::Zero();
+	switch (InShape)
+	{
+	case EAutoPaintShapePatchType::Circle:
+		HalfSize = FVector2f(InExtents.X);
+		break;
+	case EAutoPaintShapePatchType::Rectangle:
+		HalfSize = InExtents;
+		break;
+	case EAutoPaintShapePatchType::Capsule:
+		HalfSize = FVector2f(InExtents.X + InExtents.Y, InExtents.Y);
+		break;
+	case EAutoPaintShapePatchType::Ring:
+		HalfSize = FVector2f(InExtents.Y);
+		break;
+	}
+	return HalfSize + FVector2f(FMath::Max(InFalloff, 0.f));
+}
+
+void FAutoPaintShapePatchGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintShapePatchDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_ShapePatch_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, ShapePatch_RT);
+
+	if (!Params.CombinedResult || Params.DestinationBounds.IsEmpty())
+	{
+		return;
+	}
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ApplyShapePatch"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintShapePatch);
+
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("LandscapeShapePatchOutput"));
+	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+	// Make a copy of the input so we can read and write at the same time (needed for blending). Nothing
+	// outside of the bounds is read.
+	FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("LandscapeShapePatchInputCopy"));
+
+	FRHICopyTextureInfo CopyTextureInfo;
+	CopyTextureInfo.NumMips = 1;
+	CopyTextureInfo.SourcePosition = FIntVector(Params.DestinationBounds.Min.X, Params.DestinationBounds.Min.Y, 0);
+	CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+	CopyTextureInfo.Size = FIntVector(Params.DestinationBounds.Width(), Params.DestinationBounds.Height(), 0);
+	AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
+
+	AutoPaintShapePatch::FParameters* ShaderParams = GraphBuilder.AllocParameters<AutoPaintShapePatch::FParameters>();
+	ShaderParams->InHeightmapToShape = Params.HeightmapToShape;
+	ShaderParams->InExtents = Params.Extents;
+	ShaderParams->InFalloff = Params.Falloff;
+	ShaderParams->InValue = Params.Value;
+	ShaderParams->InShape = static_cast<uint32>(Params.Shape);
+	ShaderParams->InBlendMode = static_cast<uint32>(Params.BlendMode);
+	ShaderParams->InSourceTexture = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InputCopy, 0));
+	ShaderParams->RenderTargets[0] = FRenderTargetBinding(DestinationTexture, ERenderTargetLoadAction::ENoAction, /*InMipIndex = */0);
+
+	FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+	if (Params.bWeightmap)
+	{
+		TShaderMapRef<FApplyLandscapeShapeWeightPatchPS> PixelShader(ShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("LandscapeShapeWeightPatch"),
+			PixelShader, ShaderParams, Params.DestinationBounds);
+	}
+	else
+	{
+		TShaderMapRef<FApplyLandscapeShapeHeightPatchPS> PixelShader(ShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("LandscapeShapeHeightPatch"),
+			PixelShader, ShaderParams, Params.DestinationBounds);
+	}
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintShapePatchGPUInterface::Dispatch_GameThread(const FAutoPaintShapePatchDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintShapePatch)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintShapePatchGPUInterface::Dispatch(const FAutoPaintShapePatchDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
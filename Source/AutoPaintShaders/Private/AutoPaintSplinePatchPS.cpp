@@ -0,0 +1,262 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintSplinePatchPS.h"
+
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
+#include "RenderGraphEvent.h"
+#include "RenderGraphUtils.h"
+#include "PixelShaderUtils.h"
+#include "LandscapeUtils.h"
+
+DECLARE_CYCLE_STAT(TEXT("Spline Patch (RT)"), STAT_AutoPaint_SplinePatch_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintSplinePatch, TEXT("AutoPaint Spline Patch"));
+
+namespace AutoPaintSplinePatch
+{
+	/** float4 per segment, must match the shader */
+	constexpr int32 SegmentDataStride = 2;
+
+	// Flags that get packed into a bitfield because we're not allowed to use bool shader parameters:
+	enum class EFlags : uint8
+	{
+		None = 0,
+
+		// When true, falloff follows the signed distance to the mask edge stored in the profile green channel
+		ShapeFalloff = 1 << 0
+	};
+
+	static float GetSegmentDistanceSquared(const FVector2f& InPoint, const FAutoPaintSplineSegment& InSegment)
+	{
+		const FVector2f Direction = InSegment.End - InSegment.Start;
+		const float LengthSquared = Direction.SizeSquared();
+		const float T = LengthSquared > UE_SMALL_NUMBER ? FMath::Clamp(FVector2f::DotProduct(InPoint - InSegment.Start, Direction) / LengthSquared, 0.f, 1.f) : 0.f;
+		return FVector2f::DistSquared(InPoint, InSegment.Start + T * Direction);
+	}
+
+	/**
+	 * Counting sort of segments into the bins they can affect. A segment is kept in a bin when it passes within
+	 * half the profile width of the bin, measured from the bin center plus its half diagonal.
+	 */
+	static void BuildSegmentBins(const FAutoPaintSplinePatchDispatchParams& Params, const FIntPoint& InNumBins, TArray<uint32>& OutBinOffsets, TArray<uint32>& OutBinSegments)
+	{
+		constexpr int32 BinSize = FAutoPaintSplinePatchGPUInterface::BinSize;
+
+		const FIntPoint Origin = Params.DestinationBounds.Min;
+		const FVector2f Scale = Params.HeightmapToWorldScale;
+		const float Reach = 0.5f * Params.ProfileWorldDimensions.X;
+		const float BinReach = Reach + 0.5f * BinSize * Scale.Size();
+
+		// Bin of every kept segment, in segment order so every bin walks the spline in order
+		TArray<TPair<uint32, uint32>> BinnedSegments;
+		BinnedSegments.Reserve(Params.Segments.Num() * 2);
+
+		for (int32 SegmentIndex = 0; SegmentIndex < Params.Segments.Num(); ++SegmentIndex)
+		{
+			const FAutoPaintSplineSegment& Segment = Params.Segments[SegmentIndex];
+			const FVector2f WorldMin = FVector2f::Min(Segment.Start, Segment.End) - FVector2f(Reach);
+			const FVector2f WorldMax = FVector2f::Max(Segment.Start, Segment.End) + FVector2f(Reach);
+
+			const FIntPoint FirstBin(
+				FMath::Max(FMath::FloorToInt((WorldMin.X / Scale.X - Origin.X) / BinSize), 0),
+				FMath::Max(FMath::FloorToInt((WorldMin.Y / Scale.Y - Origin.Y) / BinSize), 0));
+			const FIntPoint LastBin(
+				FMath::Min(FMath::FloorToInt((WorldMax.X / Scale.X - Origin.X) / BinSize), InNumBins.X - 1),
+				FMath::Min(FMath::FloorToInt((WorldMax.Y / Scale.Y - Origin.Y) / BinSize), InNumBins.Y - 1));
+
+			for (int32 BinY = FirstBin.Y; BinY <= LastBin.Y; ++BinY)
+			{
+				for (int32 BinX = FirstBin.X; BinX <= LastBin.X; ++BinX)
+				{
+					const FVector2f BinCenter = (FVector2f(Origin) + (FVector2f(BinX, BinY) + 0.5f) * BinSize) * Scale;
+					if (GetSegmentDistanceSquared(BinCenter, Segment) <= FMath::Square(BinReach))
+					{
+						BinnedSegments.Emplace(BinY * InNumBins.X + BinX, SegmentIndex);
+					}
+				}
+			}
+		}
+
+		OutBinOffsets.SetNumZeroed(InNumBins.X * InNumBins.Y + 1);
+		for (const TPair<uint32, uint32>& Binned : BinnedSegments)
+		{
+			++OutBinOffsets[Binned.Key + 1];
+		}
+		for (int32 Index = 1; Index < OutBinOffsets.Num(); ++Index)
+		{
+			OutBinOffsets[Index] += OutBinOffsets[Index - 1];
+		}
+
+		OutBinSegments.SetNumUninitialized(FMath::Max(BinnedSegments.Num(), 1));
+		TArray<uint32> BinCursors(OutBinOffsets.GetData(), OutBinOffsets.Num() - 1);
+		for (const TPair<uint32, uint32>& Binned : BinnedSegments)
+		{
+			OutBinSegments[BinCursors[Binned.Key]++] = Binned.Value;
+		}
+	}
+}
+
+BEGIN_SHADER_PARAMETER_STRUCT(FAutoPaintSplinePatchParameters, )
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InSource)
+	SHADER_PARAMETER_RDG_TEXTURE_SRV(Texture2D<float4>, InProfile)
+	SHADER_PARAMETER_SAMPLER(SamplerState, InProfileSampler)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<float4>, InSegmentData)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, InBinOffsets)
+	SHADER_PARAMETER_RDG_BUFFER_SRV(StructuredBuffer<uint>, InBinSegments)
+	SHADER_PARAMETER(FUintVector2, InBinOrigin)
+	SHADER_PARAMETER(uint32, InNumBinsX)
+	SHADER_PARAMETER(FVector2f, InHeightmapToWorldScale)
+	SHADER_PARAMETER(FVector2f, InProfileWorldDimensions)
+	SHADER_PARAMETER(FVector2f, InEdgeUVDeadBorder)
+	SHADER_PARAMETER(float, InFalloffWorldMargin)
+	SHADER_PARAMETER(float, InZeroInEncoding)
+	SHADER_PARAMETER(float, InHeightScale)
+	// Some combination of the flags (see AutoPaintSplinePatch::EFlags).
+	SHADER_PARAMETER(uint32, InFlags)
+	RENDER_TARGET_BINDING_SLOTS() // Holds our output
+END_SHADER_PARAMETER_STRUCT()
+
+class FApplySplineHeightPatchPS : public FGlobalShader
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplySplineHeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplySplineHeightPatchPS, FGlobalShader);
+
+public:
+	using FParameters = FAutoPaintSplinePatchParameters;
+
+	static bool ShouldCompilePermutation(const FGlobalShaderPermutationParameters& Parameters)
+	{
+		return UE::Landscape::DoesPlatformSupportEditLayers(Parameters.Platform);
+	}
+
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		OutEnvironment.SetDefine(TEXT("APPLY_SPLINE_PATCH"), 1);
+		OutEnvironment.SetDefine(TEXT("BIN_SIZE"), FAutoPaintSplinePatchGPUInterface::BinSize);
+		OutEnvironment.SetDefine(TEXT("SEGMENT_DATA_STRIDE"), AutoPaintSplinePatch::SegmentDataStride);
+		OutEnvironment.SetDefine(TEXT("SHAPE_FALLOFF_FLAG"), static_cast<uint8>(AutoPaintSplinePatch::EFlags::ShapeFalloff));
+	}
+};
+
+class FApplySplineWeightPatchPS : public FApplySplineHeightPatchPS
+{
+	DECLARE_EXPORTED_GLOBAL_SHADER(FApplySplineWeightPatchPS, AUTOPAINTSHADERS_API);
+	SHADER_USE_PARAMETER_STRUCT(FApplySplineWeightPatchPS, FApplySplineHeightPatchPS);
+
+public:
+	static void ModifyCompilationEnvironment(const FGlobalShaderPermutationParameters& Parameters, FShaderCompilerEnvironment& OutEnvironment)
+	{
+		FApplySplineHeightPatchPS::ModifyCompilationEnvironment(Parameters, OutEnvironment);
+		OutEnvironment.SetDefine(TEXT("SPLINE_WEIGHT_PATCH"), 1);
+	}
+};
+
+IMPLEMENT_GLOBAL_SHADER(FApplySplineHeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintSplinePatchPS.usf", "ApplySplinePatch", SF_Pixel);
+IMPLEMENT_GLOBAL_SHADER(FApplySplineWeightPatchPS, "/Plugin/AutoPaint/Private/AutoPaintSplinePatchPS.usf", "ApplySplinePatch", SF_Pixel);
+
+void FAutoPaintSplinePatchGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintSplinePatchDispatchParams& Params)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_SplinePatch_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, SplinePatch_RT);
+
+	if (!Params.CombinedResult || !Params.ProfileTexture || Params.Segments.IsEmpty() || Params.DestinationBounds.IsEmpty())
+	{
+		return;
+	}
+
+	using namespace AutoPaintSplinePatch;
+
+	const FIntRect& Bounds = Params.DestinationBounds;
+	const FIntPoint NumBins(FMath::DivideAndRoundUp(Bounds.Width(), BinSize), FMath::DivideAndRoundUp(Bounds.Height(), BinSize));
+	TArray<uint32> BinOffsets;
+	TArray<uint32> BinSegments;
+	BuildSegmentBins(Params, NumBins, BinOffsets, BinSegments);
+
+	TArray<FVector4f> SegmentData;
+	SegmentData.Reserve(Params.Segments.Num() * SegmentDataStride);
+	for (const FAutoPaintSplineSegment& Segment : Params.Segments)
+	{
+		SegmentData.Emplace(Segment.Start.X, Segment.Start.Y, Segment.End.X, Segment.End.Y);
+		SegmentData.Emplace(Segment.StartHeight, Segment.EndHeight, 0.f, 0.f);
+	}
+
+	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ApplySplinePatch"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintSplinePatch);
+
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("AutoPaintSplinePatchOutput"));
+	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
+
+	// Make a copy of our input so we can read and write at the same time (needed for blending)
+	FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("AutoPaintSplinePatchInputCopy"));
+
+	FRHICopyTextureInfo CopyTextureInfo;
+	CopyTextureInfo.NumMips = 1;
+	CopyTextureInfo.SourcePosition = FIntVector(Bounds.Min.X, Bounds.Min.Y, 0);
+	CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+	CopyTextureInfo.Size = FIntVector(Bounds.Width(), Bounds.Height(), 0);
+	AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
+
+	FAutoPaintSplinePatchParameters* ShaderParams = GraphBuilder.AllocParameters<FAutoPaintSplinePatchParameters>();
+
+	ShaderParams->InSource = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(InputCopy, 0));
+
+	TRefCountPtr<IPooledRenderTarget> ProfileRenderTarget = CreateRenderTarget(Params.ProfileTexture->GetTexture2DRHI(), TEXT("AutoPaintSplinePatchProfile"));
+	FRDGTextureRef ProfileTexture = GraphBuilder.RegisterExternalTexture(ProfileRenderTarget);
+	ShaderParams->InProfile = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(ProfileTexture, 0));
+	ShaderParams->InProfileSampler = TStaticSamplerState<SF_Bilinear, AM_Clamp, AM_Clamp>::GetRHI();
+
+	ShaderParams->InSegmentData = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintSplinePatchSegments"), SegmentData));
+	ShaderParams->InBinOffsets = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintSplinePatchBinOffsets"), BinOffsets));
+	ShaderParams->InBinSegments = GraphBuilder.CreateSRV(CreateStructuredBuffer(GraphBuilder, TEXT("AutoPaintSplinePatchBinSegments"), BinSegments));
+	ShaderParams->InBinOrigin = FUintVector2(Bounds.Min.X, Bounds.Min.Y);
+	ShaderParams->InNumBinsX = NumBins.X;
+
+	ShaderParams->InHeightmapToWorldScale = Params.HeightmapToWorldScale;
+	ShaderParams->InProfileWorldDimensions = Params.ProfileWorldDimensions;
+	ShaderParams->InEdgeUVDeadBorder = Params.EdgeUVDeadBorder;
+	ShaderParams->InFalloffWorldMargin = Params.FalloffWorldMargin;
+	ShaderParams->InZeroInEncoding = Params.ZeroInEncoding;
+	ShaderParams->InHeightScale = Params.HeightScale;
+	ShaderParams->InFlags = static_cast<uint8>(Params.bShapeFalloff ? EFlags::ShapeFalloff : EFlags::None);
+
+	ShaderParams->RenderTargets[0] = FRenderTargetBinding(DestinationTexture, ERenderTargetLoadAction::ENoAction, /*InMipIndex = */0);
+
+	FGlobalShaderMap* ShaderMap = GetGlobalShaderMap(GMaxRHIFeatureLevel);
+	if (Params.bWeightmap)
+	{
+		TShaderMapRef<FApplySplineWeightPatchPS> PixelShader(ShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("AutoPaintSplineWeightPatch %d", Params.Segments.Num()),
+			PixelShader, ShaderParams, Bounds);
+	}
+	else
+	{
+		TShaderMapRef<FApplySplineHeightPatchPS> PixelShader(ShaderMap);
+		FPixelShaderUtils::AddFullscreenPass(GraphBuilder, ShaderMap, RDG_EVENT_NAME("AutoPaintSplineHeightPatch %d", Params.Segments.Num()),
+			PixelShader, ShaderParams, Bounds);
+	}
+
+	GraphBuilder.Execute();
+}
+
+void FAutoPaintSplinePatchGPUInterface::Dispatch_GameThread(const FAutoPaintSplinePatchDispatchParams& Params)
+{
+	ENQUEUE_RENDER_COMMAND(AutoPaintSplinePatch)(
+		[Params](FRHICommandListImmediate& RHICmdList)
+		{
+			Dispatch_RenderThread(RHICmdList, Params);
+		});
+}
+
+void FAutoPaintSplinePatchGPUInterface::Dispatch(const FAutoPaintSplinePatchDispatchParams& Params)
+{
+	if (IsInRenderingThread())
+	{
+		Dispatch_RenderThread(GetImmediateCommandList_ForRenderCommand(), Params);
+	}
+	else
+	{
+		Dispatch_GameThread(Params);
+	}
+}
@@ -3,12 +3,19 @@
 
 #include "AutoPaintTexturePatchPS.h"
 
+#include "AutoPaintMemory.h"
+#include "AutoPaintStats.h"
 #include "RenderGraphEvent.h"
 #include "RenderGraphUtils.h"
 #include "Engine/TextureRenderTarget2D.h"
 #include "PixelShaderUtils.h"
 #include "LandscapeUtils.h"
 
+DECLARE_CYCLE_STAT(TEXT("Texture Height Patch (RT)"), STAT_AutoPaint_TextureHeightPatch_RT, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Texture Weight Patch (RT)"), STAT_AutoPaint_TextureWeightPatch_RT, STATGROUP_AutoPaint);
+DECLARE_GPU_STAT_NAMED(AutoPaintTextureHeightPatch, TEXT("AutoPaint Texture Height Patch"));
+DECLARE_GPU_STAT_NAMED(AutoPaintTextureWeightPatch, TEXT("AutoPaint Texture Weight Patch"));
+
 /**
  * Shader that applies a texture-based height patch to a landscape heightmap.
  */
@@ -46,7 +53,11 @@ public:
 
 		// When false, the input is directly interpreted as being the height value to process. When true, the height
 		// is unpacked from the red and green channels to make a 16 bit int.
-		InputIsPackedHeight = 1 << 2
+		InputIsPackedHeight = 1 << 2,
+
+		// When true, falloff follows the signed distance to the mask edge stored in the green channel, and overrides
+		// RectangularFalloff.
+		ShapeFalloff = 1 << 3
 	};
 
 	// TODO: We could consider exposing an additional global alpha setting that we can use to pass in the given
@@ -72,6 +83,10 @@ public:
 		SHADER_PARAMETER(float, InFalloffWorldMargin)
 		// Size of the patch in world units (used for falloff)
 		SHADER_PARAMETER(FVector2f, InPatchWorldDimensions)
+		// Patch UV to bound texture UV, scale in xy and offset in zw. Identity unless the patch is tiled.
+		SHADER_PARAMETER(FVector4f, InPatchUVToTextureUV)
+		// Patch UV rect covered by the bound texture, min in xy and max in zw
+		SHADER_PARAMETER(FVector4f, InPatchUVBounds)
 		SHADER_PARAMETER(uint32, InBlendMode)
 		// Some combination of the flags (see constants above).
 		SHADER_PARAMETER(uint32, InFlags)
@@ -98,6 +113,7 @@ void FApplyLandscapeTextureHeightPatchPS::ModifyCompilationEnvironment(const FGl
 	OutEnvironment.SetDefine(TEXT("RECTANGULAR_FALLOFF_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::RectangularFalloff));
 	OutEnvironment.SetDefine(TEXT("APPLY_PATCH_ALPHA_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::ApplyPatchAlpha));
 	OutEnvironment.SetDefine(TEXT("INPUT_IS_PACKED_HEIGHT_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::InputIsPackedHeight));
+	OutEnvironment.SetDefine(TEXT("SHAPE_FALLOFF_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::ShapeFalloff));
 
 	OutEnvironment.SetDefine(TEXT("ADDITIVE_MODE"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EBlendMode::Additive));
 	OutEnvironment.SetDefine(TEXT("ALPHA_BLEND_MODE"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EBlendMode::AlphaBlend));
@@ -123,19 +139,25 @@ IMPLEMENT_GLOBAL_SHADER(FApplyLandscapeTextureHeightPatchPS, "/Plugin/AutoPaint/
 
 void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintTexturePatchDispatchParams& Params)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(LandscapeTextureHeightPatch_Render);
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_TextureHeightPatch_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, TextureHeightPatch_RT);
 
 	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ApplyTextureHeightPatch"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintTextureHeightPatch);
 
-	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetResource()->GetTexture2DRHI(), TEXT("LandscapeTextureHeightPatchOutput"));
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("LandscapeTextureHeightPatchOutput"));
 	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
 
 	// Make a copy of our heightmap input so we can read and write at the same time (needed for blending)
-	FRDGTextureRef InputCopy = GraphBuilder.CreateTexture(DestinationTexture->Desc, TEXT("LandscapeTextureHeightPatchInputCopy"));
+	FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("LandscapeTextureHeightPatchInputCopy"));
 
+	// Only the pixels inside the bounds are read back, which matters when a tiled patch dispatches once per tile
 	FRHICopyTextureInfo CopyTextureInfo;
 	CopyTextureInfo.NumMips = 1;
-	CopyTextureInfo.Size = FIntVector(DestinationTexture->Desc.GetSize().X, DestinationTexture->Desc.GetSize().Y, 0);
+	CopyTextureInfo.SourcePosition = FIntVector(Params.DestinationBounds.Min.X, Params.DestinationBounds.Min.Y, 0);
+	CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+	CopyTextureInfo.Size = FIntVector(Params.DestinationBounds.Width(), Params.DestinationBounds.Height(), 0);
 	AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
 
 	FApplyLandscapeTextureHeightPatchPS::FParameters* ShaderParams =
@@ -145,6 +167,8 @@ void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 	ShaderParams->InEdgeUVDeadBorder = Params.EdgeUVDeadBorder;
 	ShaderParams->InFalloffWorldMargin = Params.FalloffWorldMargin;
 	ShaderParams->InPatchWorldDimensions = Params.PatchWorldDimensions;
+	ShaderParams->InPatchUVToTextureUV = Params.PatchUVToTextureUV;
+	ShaderParams->InPatchUVBounds = Params.PatchUVBounds;
 	
 	ShaderParams->InZeroInEncoding = Params.ZeroInEncoding;
 	ShaderParams->InHeightScale = Params.HeightScale;
@@ -155,14 +179,14 @@ void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 	ShaderParams->InBlendMode = static_cast<uint32>(BlendMode);
 	
 	using EShaderFlags = FApplyLandscapeTextureHeightPatchPS::EFlags;
-	EShaderFlags Flags = EShaderFlags::None;
+	EShaderFlags Flags = Params.bShapeFalloff ? EShaderFlags::ShapeFalloff : EShaderFlags::None;
 	// 	// Pack our booleans into a bitfield
 	// 	Flags |= (FalloffMode == ELandscapeTexturePatchFalloffMode::RoundedRectangle) ? EShaderFlags::RectangularFalloff : EShaderFlags::None;
 	// 	Flags |= bUseTextureAlphaForHeight ? EShaderFlags::ApplyPatchAlpha : EShaderFlags::None;
 	// 	Flags |= bNativeEncoding ? EShaderFlags::InputIsPackedHeight : EShaderFlags::None;
 	ShaderParams->InFlags = static_cast<uint8>(Flags);
 
-	TRefCountPtr<IPooledRenderTarget> PatchRenderTarget = CreateRenderTarget(Params.PatchTexture->GetResource()->GetTexture2DRHI(), TEXT("LandscapeTextureHeightPatch"));
+	TRefCountPtr<IPooledRenderTarget> PatchRenderTarget = CreateRenderTarget(Params.PatchTexture->GetTexture2DRHI(), TEXT("LandscapeTextureHeightPatch"));
 	FRDGTextureRef PatchTexture = GraphBuilder.RegisterExternalTexture(PatchRenderTarget);
 	FRDGTextureSRVRef PatchSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(PatchTexture, 0));
 	ShaderParams->InHeightPatch = PatchSRV;
@@ -180,7 +204,7 @@ void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 
 void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch_GameThread(const FAutoPaintTexturePatchDispatchParams& Params)
 {
-	ENQUEUE_RENDER_COMMAND(LandscapeCircleHeightPatch)(
+	ENQUEUE_RENDER_COMMAND(AutoPaintTextureHeightPatch)(
 		[Params](FRHICommandListImmediate& RHICmdList)
 		{
 			Dispatch_RenderThread(RHICmdList, Params);
@@ -199,6 +223,25 @@ void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch(const FAutoPaintTextu
 	}
 }
 
+void FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult)
+{
+	if (!Proxy.IsValid() || Proxy->Regions.IsEmpty() || !CombinedResult)
+	{
+		return;
+	}
+
+	ENQUEUE_RENDER_COMMAND(AutoPaintTexturePatchHeightmapProxy)(
+		[Proxy, CombinedResult](FRHICommandListImmediate& RHICmdList)
+		{
+			for (const FAutoPaintTexturePatchDispatchParams& Region : Proxy->Regions)
+			{
+				FAutoPaintTexturePatchDispatchParams Params = Region;
+				Params.CombinedResult = CombinedResult;
+				Dispatch_RenderThread(RHICmdList, Params);
+			}
+		});
+}
+
 
 class FApplyLandscapeTextureWeightPatchPS : public FGlobalShader
 {
@@ -232,6 +275,15 @@ public:
 
 		// When true, the texture alpha channel is considered for blending (in addition to falloff, if nonzero)
 		ApplyPatchAlpha = 1 << 1,
+
+		// Same value as FApplyLandscapeTextureHeightPatchPS::EFlags::ShapeFalloff, the define is shared
+		ShapeFalloff = 1 << 3,
+
+		// When true, the weight comes from the slope and curvature in the blue and alpha channels instead of red
+		DerivedWeight = 1 << 4,
+
+		// When true, the coverage in the InSectionMaskChannel channel is painted with full weight instead of red
+		SectionMask = 1 << 5
 	};
 
 	// TODO: We could consider exposing an additional global alpha setting that we can use to pass in the given
@@ -251,9 +303,21 @@ public:
 		SHADER_PARAMETER(float, InFalloffWorldMargin)
 		// Size of the patch in world units (used for falloff)
 		SHADER_PARAMETER(FVector2f, InPatchWorldDimensions)
+		// Patch UV to bound texture UV, scale in xy and offset in zw. Identity unless the patch is tiled.
+		SHADER_PARAMETER(FVector4f, InPatchUVToTextureUV)
+		// Patch UV rect covered by the bound texture, min in xy and max in zw
+		SHADER_PARAMETER(FVector4f, InPatchUVBounds)
 		SHADER_PARAMETER(uint32, InBlendMode)
 		// Some combination of the flags (see constants above).
 		SHADER_PARAMETER(uint32, InFlags)
+		// World height of a stored height of 1 and planar patch scale, for derived weights
+		SHADER_PARAMETER(FVector2f, InDerivedHeightScale)
+		// Min, max and transition of the derived weight in degrees
+		SHADER_PARAMETER(FVector4f, InDerivedSlopeRange)
+		// Min, max and transition of the derived weight in 1/m, w is non zero when curvature is used
+		SHADER_PARAMETER(FVector4f, InDerivedCurvatureRange)
+		// One in the channel of the section mask, zero in the others
+		SHADER_PARAMETER(FVector4f, InSectionMaskChannel)
 
 		RENDER_TARGET_BINDING_SLOTS() // Holds our output
 	END_SHADER_PARAMETER_STRUCT()
@@ -276,6 +340,9 @@ void FApplyLandscapeTextureWeightPatchPS::ModifyCompilationEnvironment(const FGl
 	// Make our flag choices match in the shader.
 	OutEnvironment.SetDefine(TEXT("RECTANGULAR_FALLOFF_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::RectangularFalloff));
 	OutEnvironment.SetDefine(TEXT("APPLY_PATCH_ALPHA_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::ApplyPatchAlpha));
+	OutEnvironment.SetDefine(TEXT("SHAPE_FALLOFF_FLAG"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EFlags::ShapeFalloff));
+	OutEnvironment.SetDefine(TEXT("DERIVED_WEIGHT_FLAG"), static_cast<uint8>(FApplyLandscapeTextureWeightPatchPS::EFlags::DerivedWeight));
+	OutEnvironment.SetDefine(TEXT("SECTION_MASK_FLAG"), static_cast<uint8>(FApplyLandscapeTextureWeightPatchPS::EFlags::SectionMask));
 
 	OutEnvironment.SetDefine(TEXT("ADDITIVE_MODE"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EBlendMode::Additive));
 	OutEnvironment.SetDefine(TEXT("ALPHA_BLEND_MODE"), static_cast<uint8>(FApplyLandscapeTextureHeightPatchPS::EBlendMode::AlphaBlend));
@@ -301,19 +368,25 @@ IMPLEMENT_GLOBAL_SHADER(FApplyLandscapeTextureWeightPatchPS, "/Plugin/AutoPaint/
 
 void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintTexturePatchDispatchParams& Params)
 {
-	TRACE_CPUPROFILER_EVENT_SCOPE(LandscapeTextureHeightPatch_Render);
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_TextureWeightPatch_RT);
+	LLM_SCOPE_BYTAG(AutoPaint);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, TextureWeightPatch_RT);
 
 	FRDGBuilder GraphBuilder(RHICmdList, RDG_EVENT_NAME("ApplyTextureWeightPatch"));
+	RDG_GPU_STAT_SCOPE(GraphBuilder, AutoPaintTextureWeightPatch);
 
-	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetResource()->GetTexture2DRHI(), TEXT("LandscapeTextureWeightPatchOutput"));
+	TRefCountPtr<IPooledRenderTarget> DestinationRenderTarget = CreateRenderTarget(Params.CombinedResult->GetTexture2DRHI(), TEXT("LandscapeTextureWeightPatchOutput"));
 	FRDGTextureRef DestinationTexture = GraphBuilder.RegisterExternalTexture(DestinationRenderTarget);
 
 	// Make a copy of our heightmap input so we can read and write at the same time (needed for blending)
-	FRDGTextureRef InputCopy = GraphBuilder.CreateTexture(DestinationTexture->Desc, TEXT("LandscapeTextureWeightPatchInputCopy"));
+	FRDGTextureRef InputCopy = AutoPaintMemory::CreateTransientTexture(GraphBuilder, DestinationTexture->Desc, TEXT("LandscapeTextureWeightPatchInputCopy"));
 
+	// Only the pixels inside the bounds are read back, which matters when a tiled patch dispatches once per tile
 	FRHICopyTextureInfo CopyTextureInfo;
 	CopyTextureInfo.NumMips = 1;
-	CopyTextureInfo.Size = FIntVector(DestinationTexture->Desc.GetSize().X, DestinationTexture->Desc.GetSize().Y, 0);
+	CopyTextureInfo.SourcePosition = FIntVector(Params.DestinationBounds.Min.X, Params.DestinationBounds.Min.Y, 0);
+	CopyTextureInfo.DestPosition = CopyTextureInfo.SourcePosition;
+	CopyTextureInfo.Size = FIntVector(Params.DestinationBounds.Width(), Params.DestinationBounds.Height(), 0);
 	AddCopyTexturePass(GraphBuilder, DestinationTexture, InputCopy, CopyTextureInfo);
 
 	FApplyLandscapeTextureWeightPatchPS::FParameters* ShaderParams = GraphBuilder.AllocParameters<FApplyLandscapeTextureWeightPatchPS::FParameters>();
@@ -322,6 +395,8 @@ void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 	ShaderParams->InEdgeUVDeadBorder = Params.EdgeUVDeadBorder;
 	ShaderParams->InFalloffWorldMargin = Params.FalloffWorldMargin;
 	ShaderParams->InPatchWorldDimensions = Params.PatchWorldDimensions;
+	ShaderParams->InPatchUVToTextureUV = Params.PatchUVToTextureUV;
+	ShaderParams->InPatchUVBounds = Params.PatchUVBounds;
 
 	// @todo:
 	using EShaderBlendMode = FApplyLandscapeTextureWeightPatchPS::EBlendMode;
@@ -329,10 +404,24 @@ void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 	ShaderParams->InBlendMode = static_cast<uint32>(BlendMode);
 	
 	using EShaderFlags = FApplyLandscapeTextureWeightPatchPS::EFlags;
-	EShaderFlags Flags = EShaderFlags::None;
-	ShaderParams->InFlags = static_cast<uint8>(Flags);
+	uint8 Flags = static_cast<uint8>(Params.bShapeFalloff ? EShaderFlags::ShapeFalloff : EShaderFlags::None);
+	Flags |= static_cast<uint8>(Params.DerivedWeight.bEnabled ? EShaderFlags::DerivedWeight : EShaderFlags::None);
+	const bool bSectionMask = Params.SectionMaskChannel >= 0 && Params.SectionMaskChannel < 4;
+	Flags |= static_cast<uint8>(bSectionMask ? EShaderFlags::SectionMask : EShaderFlags::None);
+	ShaderParams->InFlags = Flags;
+
+	ShaderParams->InSectionMaskChannel = FVector4f::Zero();
+	if (bSectionMask)
+	{
+		ShaderParams->InSectionMaskChannel[Params.SectionMaskChannel] = 1.f;
+	}
 
-	TRefCountPtr<IPooledRenderTarget> PatchRenderTarget = CreateRenderTarget(Params.PatchTexture->GetResource()->GetTexture2DRHI(), TEXT("LandscapeTextureWeightPatch"));
+	const FAutoPaintDerivedWeightParams& Derived = Params.DerivedWeight;
+	ShaderParams->InDerivedHeightScale = Params.DerivedHeightScale;
+	ShaderParams->InDerivedSlopeRange = FVector4f(Derived.SlopeRange, 0.f);
+	ShaderParams->InDerivedCurvatureRange = FVector4f(Derived.CurvatureRange, Derived.bUseCurvature ? 1.f : 0.f);
+
+	TRefCountPtr<IPooledRenderTarget> PatchRenderTarget = CreateRenderTarget(Params.PatchTexture->GetTexture2DRHI(), TEXT("LandscapeTextureWeightPatch"));
 	FRDGTextureRef PatchTexture = GraphBuilder.RegisterExternalTexture(PatchRenderTarget);
 	FRDGTextureSRVRef PatchSRV = GraphBuilder.CreateSRV(FRDGTextureSRVDesc::CreateForMipLevel(PatchTexture, 0));
 	ShaderParams->InWeightPatch = PatchSRV;
@@ -350,7 +439,7 @@ void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch_RenderThread(FRHIComm
 
 void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch_GameThread(const FAutoPaintTexturePatchDispatchParams& Params)
 {
-	ENQUEUE_RENDER_COMMAND(LandscapeCircleHeightPatch)(
+	ENQUEUE_RENDER_COMMAND(AutoPaintTextureWeightPatch)(
 		[Params](FRHICommandListImmediate& RHICmdList)
 		{
 			Dispatch_RenderThread(RHICmdList, Params);
@@ -367,4 +456,35 @@ void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch(const FAutoPaintTextu
 	{
 		Dispatch_GameThread(Params);
 	}
+}
+
+void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult)
+{
+	Dispatch(Proxy, CombinedResult, FAutoPaintWeightLayerParams());
+}
+
+void FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult, const FAutoPaintWeightLayerParams& InLayer)
+{
+	if (!Proxy.IsValid() || Proxy->Regions.IsEmpty() || !CombinedResult)
+	{
+		return;
+	}
+
+	// The proxy is shared by every layer, the derived weight and section mask are given per layer
+	ENQUEUE_RENDER_COMMAND(AutoPaintTexturePatchWeightmapProxy)(
+		[Proxy, CombinedResult, InLayer](FRHICommandListImmediate& RHICmdList)
+		{
+			for (const FAutoPaintTexturePatchDispatchParams& Region : Proxy->Regions)
+			{
+				FAutoPaintTexturePatchDispatchParams Params = Region;
+				Params.CombinedResult = CombinedResult;
+				Params.DerivedWeight = InLayer.DerivedWeight;
+				if (InLayer.SectionMaskTexture)
+				{
+					Params.PatchTexture = InLayer.SectionMaskTexture;
+					Params.SectionMaskChannel = InLayer.SectionMaskChannel;
+				}
+				Dispatch_RenderThread(RHICmdList, Params);
+			}
+		});
 }
\ No newline at end of file
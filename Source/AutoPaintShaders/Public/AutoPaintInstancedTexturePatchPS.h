@@ -0,0 +1,77 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RHI.h"
+#include "AutoPaintTexturePatchPS.h"
+
+/** One patch texture and the parameters shared by all of its instances */
+struct AUTOPAINTSHADERS_API FAutoPaintInstancedTexturePatchSource
+{
+	/** Taken on the game thread, only dereferenced on the render thread */
+	FTextureResource* Texture = nullptr;
+	/** Changes whenever the texture content changes, keys the atlas slice */
+	FGuid ContentId;
+
+	FVector2f EdgeUVDeadBorder = FVector2f::ZeroVector;
+	/** Unscaled, instance scale is part of HeightmapToPatch */
+	FVector2f PatchWorldDimensions = FVector2f::One();
+	float ZeroInEncoding = 0.f;
+	/** See FAutoPaintTexturePatchDispatchParams::bShapeFalloff */
+	bool bShapeFalloff = false;
+	/** Texture stores slope and curvature, instances of other patches are skipped by a derived weight pass */
+	bool bHasDerivatives = false;
+};
+
+struct AUTOPAINTSHADERS_API FAutoPaintTexturePatchInstance
+{
+	/** Transposed like FAutoPaintTexturePatchDispatchParams::HeightmapToPatch */
+	FMatrix44f HeightmapToPatch;
+	/** Already clipped to the destination, empty instances are skipped */
+	FIntRect DestinationBounds;
+
+	/** Index into FAutoPaintInstancedTexturePatchDispatchParams::Patches */
+	int32 PatchIndex = 0;
+
+	float FalloffWorldMargin = 0.f;
+	float HeightScale = 1.f;
+	float HeightOffset = 0.f;
+	/** See FAutoPaintTexturePatchDispatchParams::DerivedHeightScale, used by weightmap passes in place of the height params */
+	FVector2f DerivedHeightScale = FVector2f::One();
+};
+
+struct AUTOPAINTSHADERS_API FAutoPaintInstancedTexturePatchDispatchParams
+{
+	FTextureResource* CombinedResult = nullptr;
+
+	TArray<FAutoPaintInstancedTexturePatchSource> Patches;
+
+	/** Applied in order, later instances blend over earlier ones */
+	TArray<FAutoPaintTexturePatchInstance> Instances;
+
+	/** Blend a weightmap layer instead of the packed heightmap */
+	bool bWeightmap = false;
+
+	/** Weightmap only, applies to every instance of the pass */
+	FAutoPaintDerivedWeightParams DerivedWeight;
+};
+
+/**
+ * Applies patch textures at many transforms in a single pass over one input snapshot.
+ * Instances are binned on CPU into BinSize pixel squares of the destination, each pixel only walks
+ * the instances of its bin, so the cost follows covered area and overlap rather than instance count.
+ * Patches are sampled from GAutoPaintPatchAtlas, so instances of different assets share the pass as long as
+ * they span at most MaxBucketsPerPass atlas buckets. Past that, instances are split into consecutive passes.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintInstancedTexturePatchGPUInterface
+{
+public:
+	static constexpr int32 BinSize = 32;
+	static constexpr int32 MaxBucketsPerPass = 4;
+
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintInstancedTexturePatchDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintInstancedTexturePatchDispatchParams& Params);
+
+	/** Dispatches the instanced patch shader. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintInstancedTexturePatchDispatchParams& Params);
+};
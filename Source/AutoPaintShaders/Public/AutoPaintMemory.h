@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderGraphResources.h"
+
+class FRDGBuilder;
+class UTexture;
+
+/** Memory held by one AutoPaint object, see AutoPaintMemory::Gather */
+struct FAutoPaintMemoryEntry
+{
+	/** Groups entries in reports, e.g. Assets, Editors, Capture, Landscape */
+	FString Category;
+	FString Name;
+	int64 Bytes = 0;
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnGatherAutoPaintMemory, TArray<FAutoPaintMemoryEntry>& /*OutEntries*/);
+
+/**
+ * Accounting of the GPU memory AutoPaint holds. Modules owning textures or render targets register a gatherer,
+ * transient RDG textures of the patch passes are counted per render thread frame.
+ * AutoPaint.MemReport logs everything, add it to [MemReportCommands] to include it in memreport.
+ */
+namespace AutoPaintMemory
+{
+	/** Called on the game thread by Gather, add one entry per owner */
+	AUTOPAINTSHADERS_API FOnGatherAutoPaintMemory& OnGather();
+
+	/** Every registered owner plus the patch atlas, largest first */
+	AUTOPAINTSHADERS_API TArray<FAutoPaintMemoryEntry> Gather();
+
+	/** Resident mips of a texture or render target, zero for null */
+	AUTOPAINTSHADERS_API int64 GetTextureBytes(const UTexture* InTexture);
+
+	/** GraphBuilder.CreateTexture that counts the texture toward the transient bytes of the frame. Render thread only. */
+	AUTOPAINTSHADERS_API FRDGTextureRef CreateTransientTexture(FRDGBuilder& GraphBuilder, const FRDGTextureDesc& InDesc, const TCHAR* InName);
+
+	/** Transient bytes requested in the last render thread frame that dispatched AutoPaint passes */
+	AUTOPAINTSHADERS_API int64 GetLastTransientBytes();
+	/** Largest GetLastTransientBytes since the last reset */
+	AUTOPAINTSHADERS_API int64 GetPeakTransientBytes();
+	AUTOPAINTSHADERS_API void ResetPeakTransientBytes();
+
+	/** Updated by FAutoPaintPatchAtlas on the render thread */
+	void SetAtlasBytes(int64 InBytes);
+	AUTOPAINTSHADERS_API int64 GetAtlasBytes();
+
+	/** Logs Gather and the transient bytes */
+	AUTOPAINTSHADERS_API void Dump(FOutputDevice& Ar);
+}
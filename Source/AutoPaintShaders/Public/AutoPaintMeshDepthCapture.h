@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RHI.h"
+
+class FStaticMeshRenderData;
+
+struct AUTOPAINTSHADERS_API FAutoPaintMeshDepthCaptureMesh
+{
+	/** LOD0 is drawn. Owning static mesh must stay alive until the dispatch runs on render thread. */
+	const FStaticMeshRenderData* RenderData;
+	FMatrix44f LocalToWorld;
+	/** Section Mask Result channel (0-3) of every LOD0 section. Sections without a channel only occlude. */
+	TArray<int32> SectionChannels;
+};
+
+struct AUTOPAINTSHADERS_API FAutoPaintMeshDepthCaptureDispatchParams
+{
+	/** R16F/R32F target, receives nearest view space depth in world units (same as SCS_SceneDepth) */
+	UTextureRenderTarget2D* DepthResult;
+	TArray<FAutoPaintMeshDepthCaptureMesh> Meshes;
+
+	/**
+	 * Optional RGBA16F/RGBA32F target at the size of DepthResult. Every channel receives the coverage of the sections
+	 * mapped to it where they are the nearest surface, weighted like the depth samples, so 4 masks cost one capture.
+	 */
+	UTextureRenderTarget2D* SectionMaskResult = nullptr;
+
+	FMatrix44f WorldToView;
+	FMatrix44f ViewToClip;
+
+	/** Depth written where nothing was drawn */
+	float ClearDepth;
+
+	/** Sub-pixel jittered captures accumulated into a float target. 1 renders a single capture straight into DepthResult. */
+	int32 NumSamples = 1;
+	/** Tent filter spans 2 texels with linear weights, box filter is 1 texel with equal weights */
+	bool bTentFilter = false;
+};
+
+/**
+ * Rasterizes only positions of the given meshes into a single channel target. No scene renderer, lighting or
+ * depth buffer: nearest depth is resolved with min blending, so the cost scales with triangle count.
+ * With several samples every capture is jittered and weighted into an R32F accumulation target at the same
+ * resolution, which anti-aliases silhouettes without a high resolution render target.
+ * Section masks draw the same geometry per section after each sample and keep only fragments at the resolved depth.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintMeshDepthCaptureGPUInterface
+{
+public:
+	/** Vertex positions are fetched from buffer SRVs, which requires manual vertex fetch support */
+	static bool IsSupported();
+
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintMeshDepthCaptureDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintMeshDepthCaptureDispatchParams& Params);
+
+	/** Dispatches the mesh depth capture pass. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintMeshDepthCaptureDispatchParams& Params);
+
+	/** Sub-pixel offsets (in texels) and normalized weights of the jitter pattern */
+	static void GetSamplePattern(int32 InNumSamples, bool bInTentFilter, TArray<FVector2f>& OutOffsets, TArray<float>& OutWeights);
+};
@@ -0,0 +1,72 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RenderGraphResources.h"
+#include "RenderResource.h"
+
+class FRDGBuilder;
+
+/**
+ * Render thread cache of patch textures packed into Texture2DArrays, one array per pixel format and
+ * power of two size bucket. Patches smaller than their bucket sit in the top left corner of their
+ * slice, the slot UV scale maps patch UV into it. Slices are reused least recently used first.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintPatchAtlas : public FRenderResource
+{
+public:
+	static constexpr int32 MaxSlicesPerBucket = 64;
+
+	struct FSlot
+	{
+		int32 Bucket = INDEX_NONE;
+		int32 Slice = INDEX_NONE;
+		FVector2f UVScale = FVector2f::One();
+
+		bool IsValid() const { return Bucket != INDEX_NONE; }
+	};
+
+	/** Starts a new use, slots returned since are never evicted by FindOrAdd */
+	void BeginUse();
+
+	/**
+	 * Returns the slot of the patch, copying it in when it is new or its RHI texture changed since.
+	 * Invalid slot when the bucket has no free slice left for this use.
+	 */
+	FSlot FindOrAdd(FRDGBuilder& GraphBuilder, FRHITexture* InTexture, const FGuid& InContentId);
+
+	FRDGTextureRef GetBucketTexture(FRDGBuilder& GraphBuilder, int32 InBucket) const;
+
+	/** GPU memory held by all bucket arrays */
+	int64 GetAllocatedBytes() const;
+
+	//~ Begin FRenderResource Interface
+	virtual void ReleaseRHI() override;
+	//~ End FRenderResource Interface
+
+private:
+	struct FBucket
+	{
+		EPixelFormat Format = PF_Unknown;
+		int32 Size = 0;
+		TRefCountPtr<IPooledRenderTarget> Texture;
+		int32 NumSlices = 0;
+		TArray<FGuid> SliceContentIds;
+		TArray<uint64> SliceLastUse;
+	};
+
+	struct FEntry
+	{
+		FSlot Slot;
+		FRHITexture* SourceTexture = nullptr;
+	};
+
+	int32 FindOrAddBucket(EPixelFormat InFormat, int32 InSize);
+	int32 AllocateSlice(FRDGBuilder& GraphBuilder, int32 InBucket);
+
+	TArray<FBucket> Buckets;
+	TMap<FGuid, FEntry> Entries;
+	uint64 UseCounter = 0;
+};
+
+extern AUTOPAINTSHADERS_API TGlobalResource<FAutoPaintPatchAtlas> GAutoPaintPatchAtlas;
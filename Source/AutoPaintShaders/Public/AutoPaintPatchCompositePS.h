@@ -0,0 +1,61 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RHI.h"
+#include "AutoPaintTexturePatchPS.h"
+
+struct AUTOPAINTSHADERS_API FAutoPaintPatchCompositeDispatchParams
+{
+	/** RG32F, premultiplied height in R and combined alpha in G */
+	FTextureResource* Composite = nullptr;
+
+	/** Cleared to zero before the patches are accumulated */
+	TArray<FIntRect> ClearRegions;
+	/** Alpha blended into Composite in order, each within its DestinationBounds */
+	TArray<FAutoPaintTexturePatchDispatchParams> Patches;
+
+	/** When set, Composite is blended over it within ApplyBounds */
+	FTextureResource* CombinedResult = nullptr;
+	FIntRect ApplyBounds;
+};
+
+struct AUTOPAINTSHADERS_API FAutoPaintPatchPreviewDispatchParams
+{
+	FTextureResource* CombinedResult = nullptr;
+
+	/** Regions of one patch, evaluated at 1 / Downsample of the heightmap resolution */
+	TArray<FAutoPaintTexturePatchDispatchParams> Patches;
+
+	int32 Downsample = 1;
+};
+
+/**
+ * Maintains a precomposite of many height patches and applies it in a single blend. Alpha blending
+ * H = lerp(H, T, a) for patches 1..n collapses to H * (1 - A) + C, with C the premultiplied sum of
+ * targets and A = 1 - prod(1 - a), so regions only have to be rebuilt when a patch inside them changes.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintPatchCompositeGPUInterface
+{
+public:
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintPatchCompositeDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintPatchCompositeDispatchParams& Params);
+
+	/** Dispatches the clear, accumulate and apply passes. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintPatchCompositeDispatchParams& Params);
+};
+
+/**
+ * Cheap stand-in for FAutoPaintTexturePatchHeightmapGPUInterface while a patch is being manipulated.
+ * The patch is accumulated into a transient target at reduced resolution and blended over the heightmap
+ * with a bilinear upsample, so the patch shader cost no longer follows the patch footprint in heightmap pixels.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintPatchPreviewGPUInterface
+{
+public:
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintPatchPreviewDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintPatchPreviewDispatchParams& Params);
+
+	/** Dispatches the reduced resolution accumulate and the upsampling apply. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintPatchPreviewDispatchParams& Params);
+};
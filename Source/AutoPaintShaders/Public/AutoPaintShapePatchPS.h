@@ -0,0 +1,68 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RHI.h"
+
+class FTextureResource;
+
+/** Must match the SHAPE_* defines */
+enum class EAutoPaintShapePatchType : uint8
+{
+	/** Extents x is the radius */
+	Circle,
+	/** Extents is the half size */
+	Rectangle,
+	/** Segment along shape x, extents x is the half segment length and y the radius */
+	Capsule,
+	/** Extents x is the inner radius and y the outer radius */
+	Ring
+};
+
+/** Same modes as the texture patch */
+enum class EAutoPaintShapePatchBlendMode : uint8
+{
+	AlphaBlend,
+	Additive,
+	Min,
+	Max
+};
+
+/**
+ * Analytic patch, alpha comes from the signed distance to the shape edge so no patch texture is needed.
+ * Only DestinationBounds is read and written.
+ */
+struct AUTOPAINTSHADERS_API FAutoPaintShapePatchDispatchParams
+{
+	/** Taken on the game thread and only dereferenced on the render thread */
+	FTextureResource* CombinedResult = nullptr;
+	FIntRect DestinationBounds;
+
+	/** Weightmap or visibility layer, Value is the weight. Otherwise heightmap, Value is the signed height. */
+	bool bWeightmap = false;
+
+	EAutoPaintShapePatchType Shape = EAutoPaintShapePatchType::Circle;
+	EAutoPaintShapePatchBlendMode BlendMode = EAutoPaintShapePatchBlendMode::AlphaBlend;
+
+	/** Destination pixel coordinates to shape space (unscaled world units, shape centered on the origin), transposed */
+	FMatrix44f HeightmapToShape;
+	FVector2f Extents = FVector2f::Zero();
+	/** Shape space distance past the edge across which the alpha falls from 1 to 0 */
+	float Falloff = 0.f;
+
+	/** Height relative to the landscape mid value in heightmap units, or weight in [0, 1] */
+	float Value = 0.f;
+};
+
+class AUTOPAINTSHADERS_API FAutoPaintShapePatchGPUInterface
+{
+public:
+	/** Half size of the shape space box the patch can touch, falloff included */
+	static FVector2f GetShapeHalfSize(EAutoPaintShapePatchType InShape, const FVector2f& InExtents, float InFalloff);
+
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintShapePatchDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintShapePatchDispatchParams& Params);
+
+	/** Applies the shape to CombinedResult. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintShapePatchDispatchParams& Params);
+};
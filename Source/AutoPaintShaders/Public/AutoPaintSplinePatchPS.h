@@ -0,0 +1,64 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "RHI.h"
+
+class FTextureResource;
+
+/** Straight piece of a spline, positions are heightmap coordinates scaled by HeightmapToWorldScale */
+struct AUTOPAINTSHADERS_API FAutoPaintSplineSegment
+{
+	FVector2f Start = FVector2f::Zero();
+	FVector2f End = FVector2f::Zero();
+	/** Heightmap height of the spline at Start and End */
+	float StartHeight = 0.f;
+	float EndHeight = 0.f;
+};
+
+struct AUTOPAINTSHADERS_API FAutoPaintSplinePatchDispatchParams
+{
+	/** Resources are taken on the game thread and only dereferenced on the render thread */
+	FTextureResource* CombinedResult = nullptr;
+	/** The row through the middle of the texture is the cross section, its width spans the spline */
+	FTextureResource* ProfileTexture = nullptr;
+	/** Already clipped to the destination, only these pixels are read and written */
+	FIntRect DestinationBounds;
+
+	/** Blend a weightmap layer with the profile red channel instead of the packed heightmap */
+	bool bWeightmap = false;
+
+	/** In order along the spline */
+	TArray<FAutoPaintSplineSegment> Segments;
+	/** World size of a destination pixel, distances to the segments are measured in world units */
+	FVector2f HeightmapToWorldScale = FVector2f::One();
+
+	/** World size of the profile texture, x across the spline */
+	FVector2f ProfileWorldDimensions = FVector2f::One();
+	FVector2f EdgeUVDeadBorder = FVector2f::Zero();
+	/** Falloff inside of the profile edges */
+	float FalloffWorldMargin = 0.f;
+	/** See FAutoPaintTexturePatchDispatchParams::bShapeFalloff */
+	bool bShapeFalloff = false;
+
+	/** The profile height is added to the spline height, see FAutoPaintTexturePatchDispatchParams */
+	float ZeroInEncoding = 0.f;
+	float HeightScale = 1.f;
+};
+
+/**
+ * Applies a cross section profile along a spline in a single pass, however long the spline is. Segments are
+ * binned on CPU into BinSize pixel squares of the destination, keeping only those within half the profile
+ * width of the square, so each pixel only measures the distance to the few segments around it.
+ */
+class AUTOPAINTSHADERS_API FAutoPaintSplinePatchGPUInterface
+{
+public:
+	static constexpr int32 BinSize = 32;
+
+	static void Dispatch_RenderThread(FRHICommandListImmediate& RHICmdList, const FAutoPaintSplinePatchDispatchParams& Params);
+	static void Dispatch_GameThread(const FAutoPaintSplinePatchDispatchParams& Params);
+
+	/** Dispatches the spline patch shader. Can be called from any thread. */
+	static void Dispatch(const FAutoPaintSplinePatchDispatchParams& Params);
+};
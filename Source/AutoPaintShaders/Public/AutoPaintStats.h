@@ -0,0 +1,19 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "ProfilingDebugging/CsvProfiler.h"
+#include "HAL/LowLevelMemTracker.h"
+
+/**
+ * Shared by every AutoPaint module. Cycle stats are declared next to the code they measure,
+ * "stat AutoPaint" shows them and "csvprofile start" records the AutoPaint category.
+ * Allocations of render targets, patch textures and scratch passes are tagged AutoPaint in LLM.
+ */
+DECLARE_STATS_GROUP(TEXT("AutoPaint"), STATGROUP_AutoPaint, STATCAT_Advanced);
+
+CSV_DECLARE_CATEGORY_MODULE_EXTERN(AUTOPAINTSHADERS_API, AutoPaint);
+
+LLM_DECLARE_TAG_API(AutoPaint, AUTOPAINTSHADERS_API);
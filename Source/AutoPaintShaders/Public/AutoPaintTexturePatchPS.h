@@ -4,10 +4,42 @@
 
 #include "RHI.h"
 
+class FTextureResource;
+
+/**
+ * Weightmap layer painted from the slope and curvature stored in the patch blue and alpha channels instead of the
+ * patch heights. Full weight inside [Min, Max], fading out over Transition past either end.
+ */
+struct AUTOPAINTSHADERS_API FAutoPaintDerivedWeightParams
+{
+	bool bEnabled = false;
+
+	/** Degrees */
+	FVector3f SlopeRange = FVector3f(30.f, 90.f, 5.f);
+
+	bool bUseCurvature = false;
+	/** 1/m, positive on ridges and negative in gullies */
+	FVector3f CurvatureRange = FVector3f(-1.f, 1.f, 0.1f);
+};
+
+/** Per layer changes to the regions of a weightmap proxy, which is shared by every layer of the patch */
+struct AUTOPAINTSHADERS_API FAutoPaintWeightLayerParams
+{
+	FAutoPaintDerivedWeightParams DerivedWeight;
+
+	/** Replaces the patch texture of every region, same UV mapping. Holds a captured section layer per channel. */
+	FTextureResource* SectionMaskTexture = nullptr;
+	/** Channel of SectionMaskTexture painted as this layer */
+	int32 SectionMaskChannel = INDEX_NONE;
+};
+
 struct AUTOPAINTSHADERS_API FAutoPaintTexturePatchDispatchParams
 {
-	UTextureRenderTarget2D* CombinedResult;
-	UTexture* PatchTexture;
+	/** Resources are taken on the game thread and only dereferenced on the render thread */
+	FTextureResource* CombinedResult = nullptr;
+	FTextureResource* PatchTexture = nullptr;
+	/** Changes with the PatchTexture content, for caching on the game thread */
+	FGuid PatchContentId;
 	FIntRect DestinationBounds;
 
 	FMatrix44f HeightmapToPatch;
@@ -15,11 +47,42 @@ struct AUTOPAINTSHADERS_API FAutoPaintTexturePatchDispatchParams
 	float FalloffWorldMargin;
 	FVector2f PatchWorldDimensions;
 
+	/** Maps patch UV to PatchTexture UV (scale xy, offset zw), when PatchTexture is one tile of the patch */
+	FVector4f PatchUVToTextureUV = FVector4f(1.f, 1.f, 0.f, 0.f);
+	/** Patch UV rect covered by PatchTexture (min xy, max zw), destination pixels outside of it are left unchanged */
+	FVector4f PatchUVBounds = FVector4f(0.f, 0.f, 1.f, 1.f);
+	/** Falloff follows the mask edge distance stored in PatchTexture green instead of the inscribed circle */
+	bool bShapeFalloff = false;
+
+	/** World height of a stored height of 1 in x and planar patch scale in y, to turn stored derivatives into world slope */
+	FVector2f DerivedHeightScale = FVector2f::One();
+	/** Weightmap only */
+	FAutoPaintDerivedWeightParams DerivedWeight;
+	/** Weightmap only, PatchTexture channel (0-3) whose coverage is painted with full weight, INDEX_NONE paints the heights */
+	int32 SectionMaskChannel = INDEX_NONE;
+
 	float ZeroInEncoding;
 	float HeightScale;
 	float HeightOffset;
 };
 
+/**
+ * Immutable render thread view of one patch: params of every texture region with resources taken on the game thread.
+ * Built when the patch inputs change and shared afterwards, so unchanged patches don't prepare params again
+ * and dispatches never touch UObjects.
+ */
+struct AUTOPAINTSHADERS_API FAutoPaintTexturePatchProxy
+{
+	/** CombinedResult is left unset, the destination is given at dispatch */
+	TArray<FAutoPaintTexturePatchDispatchParams> Regions;
+	/** Union of the region bounds */
+	FIntRect DestinationBounds;
+	/** Hash of the inputs the proxy was built from, including the resident tiles of a tiled patch */
+	uint32 InputHash = 0;
+};
+
+using FAutoPaintTexturePatchProxyPtr = TSharedPtr<const FAutoPaintTexturePatchProxy, ESPMode::ThreadSafe>;
+
 class AUTOPAINTSHADERS_API FAutoPaintTexturePatchHeightmapGPUInterface
 {
 public:
@@ -28,6 +91,9 @@ public:
 
 	/** Dispatches the texture readback compute shader. Can be called from any thread. */
 	static void Dispatch(const FAutoPaintTexturePatchDispatchParams& Params);
+
+	/** Dispatches every region of the proxy over CombinedResult in a single render command */
+	static void Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult);
 };
 
 class AUTOPAINTSHADERS_API FAutoPaintTexturePatchWeightmapGPUInterface
@@ -38,4 +104,10 @@ public:
 
 	/** Dispatches the texture readback compute shader. Can be called from any thread. */
 	static void Dispatch(const FAutoPaintTexturePatchDispatchParams& Params);
+
+	/** Dispatches every region of the proxy over CombinedResult in a single render command */
+	static void Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult);
+
+	/** Same as above, with the weight of every region derived from slope and curvature or taken from a section mask */
+	static void Dispatch(const FAutoPaintTexturePatchProxyPtr& Proxy, FTextureResource* CombinedResult, const FAutoPaintWeightLayerParams& InLayer);
 };
\ No newline at end of file
@@ -12,6 +12,7 @@ public class AutoPaintTerrain : ModuleRules
                 "Core",
                 "LandscapePatch",
                 "AutoPaint",
+                "AutoPaintShaders",
             }
         );
 
@@ -22,8 +23,9 @@ public class AutoPaintTerrain : ModuleRules
                 "Engine",
                 "Slate",
                 "SlateCore",
-                "AutoPaintShaders",
-                "Landscape"
+                "Landscape",
+                "RenderCore",
+                "UnrealEd"
             }
         );
     }
@@ -0,0 +1,451 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintBenchmarkCommandlet.h"
+
+#include "AutoPaintData.h"
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "Landscape.h"
+#include "LandscapeComponent.h"
+#include "LandscapeDataAccess.h"
+#include "LandscapeInfo.h"
+#include "LandscapeLayerInfoObject.h"
+#include "LandscapePatchManager.h"
+#include "RenderCommandFence.h"
+#include "TextureCompiler.h"
+#include "Engine/Engine.h"
+#include "Engine/Texture2D.h"
+#include "Engine/World.h"
+#include "HAL/FileManager.h"
+#include "Misc/EngineVersion.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "UObject/StrongObjectPtr.h"
+
+namespace AutoPaintBenchmark
+{
+	/** Quads per landscape component side, one section per component */
+	static constexpr int32 ComponentQuads = 63;
+	static constexpr double LandscapeScale = 100.0;
+}
+
+UAutoPaintBenchmarkCommandlet::UAutoPaintBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UAutoPaintBenchmarkCommandlet::Main(const FString& Params)
+{
+	if (!FApp::CanEverRender())
+	{
+		UE_LOG(LogAutoPaintTerrain, Error, TEXT("Landscape updates need an RHI, run with -AllowCommandletRendering and without -nullrhi"));
+		return 1;
+	}
+
+	int32 Resolution = 2017;
+	FParse::Value(*Params, TEXT("Resolution="), Resolution);
+	const int32 NumComponents = FMath::Max(1, (Resolution - 1) / AutoPaintBenchmark::ComponentQuads);
+	Resolution = NumComponents * AutoPaintBenchmark::ComponentQuads + 1;
+
+	const TArray<int32> PatchCounts = ParseIntList(Params, TEXT("Patches="), { 100, 1000, 4000 });
+	const TArray<int32> PatchSizes = ParseIntList(Params, TEXT("PatchSizes="), { 1000, 4000 });
+
+	int32 NumAssets = 16;
+	int32 AssetResolution = 256;
+	int32 NumWeightLayers = 3;
+	int32 Iterations = 5;
+	int32 Seed = 0;
+	FParse::Value(*Params, TEXT("Assets="), NumAssets);
+	FParse::Value(*Params, TEXT("AssetResolution="), AssetResolution);
+	FParse::Value(*Params, TEXT("WeightLayers="), NumWeightLayers);
+	FParse::Value(*Params, TEXT("Iterations="), Iterations);
+	FParse::Value(*Params, TEXT("Seed="), Seed);
+	NumAssets = FMath::Max(1, NumAssets);
+	AssetResolution = FMath::Clamp(AssetResolution, 8, 8192);
+	NumWeightLayers = FMath::Max(0, NumWeightLayers);
+	Iterations = FMath::Max(1, Iterations);
+
+	FString ReportPath;
+	if (!FParse::Value(*Params, TEXT("Report="), ReportPath))
+	{
+		ReportPath = FPaths::Combine(FPaths::ProjectSavedDir(), TEXT("AutoPaint"), TEXT("Benchmark.csv"));
+	}
+
+	TArray<FName> WeightLayers;
+	for (int32 LayerIndex = 0; LayerIndex < NumWeightLayers; ++LayerIndex)
+	{
+		WeightLayers.Add(*FString::Printf(TEXT("AutoPaintBenchmark%d"), LayerIndex));
+	}
+
+	UE_LOG(LogAutoPaintTerrain, Display, TEXT("Landscape %dx%d, %d weight layers, %d assets of %d texels, %d iterations"),
+		Resolution, Resolution, NumWeightLayers, NumAssets, AssetResolution, Iterations);
+
+	UWorld* World = UWorld::CreateWorld(EWorldType::Editor, /*bInformEngineOfWorld = */false, TEXT("AutoPaintBenchmark"));
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Editor);
+	WorldContext.SetCurrentWorld(World);
+
+	ALandscape* Landscape = CreateLandscape(World, Resolution, WeightLayers);
+	if (!Landscape)
+	{
+		UE_LOG(LogAutoPaintTerrain, Error, TEXT("Failed to create the landscape"));
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(/*bInformEngineOfWorld = */false);
+		return 1;
+	}
+
+	ALandscapePatchManager* PatchManager = World->SpawnActor<ALandscapePatchManager>();
+	PatchManager->SetTargetLandscape(Landscape);
+
+	FRandomStream Random(Seed);
+	TArray<UAutoPaintData*> Assets = CreateAssets(NumAssets, AssetResolution, Random);
+
+	// Patches only hold soft references, the assets have to survive GC between configurations
+	TArray<TStrongObjectPtr<UAutoPaintData>> AssetGuards;
+	for (UAutoPaintData* Data : Assets)
+	{
+		AssetGuards.Emplace(Data);
+	}
+
+	TArray<FMeasurement> Measurements;
+	for (const int32 PatchSize : PatchSizes)
+	{
+		for (UAutoPaintData* Data : Assets)
+		{
+			Data->TextureWorldSize = FVector2D(PatchSize);
+			Data->Falloff = PatchSize / 10.f;
+		}
+
+		for (const int32 NumPatches : PatchCounts)
+		{
+			// Same layout for every patch size, so only the size differs between rows
+			FRandomStream ScatterRandom(Seed);
+
+			AActor* Host = World->SpawnActor<AActor>();
+			TArray<UAutoPaintLandscapePatchComponent*> Patches;
+			ScatterPatches(Host, PatchManager, Landscape, Assets, WeightLayers, NumPatches, ScatterRandom, Patches);
+
+			const double ConfigStart = FPlatformTime::Seconds();
+			for (const bool bWeightmap : { false, true })
+			{
+				if (bWeightmap && WeightLayers.IsEmpty())
+				{
+					continue;
+				}
+
+				FMeasurement& Full = Measurements.AddDefaulted_GetRef();
+				Full.NumPatches = NumPatches;
+				Full.PatchSize = PatchSize;
+				MeasureFullUpdate(Landscape, bWeightmap, Iterations, Full);
+
+				if (!Patches.IsEmpty())
+				{
+					FMeasurement& Incremental = Measurements.AddDefaulted_GetRef();
+					Incremental.NumPatches = NumPatches;
+					Incremental.PatchSize = PatchSize;
+					MeasureIncrementalUpdate(Landscape, Patches[Patches.Num() / 2], bWeightmap, Iterations, Incremental);
+				}
+			}
+
+			UE_LOG(LogAutoPaintTerrain, Display, TEXT("%d patches of %d cm done in %.2f s"), NumPatches, PatchSize, FPlatformTime::Seconds() - ConfigStart);
+			FAutoPaintPatchCostTracker::Get().Dump(5);
+
+			World->DestroyActor(Host);
+			CollectGarbage(RF_NoFlags);
+		}
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(/*bInformEngineOfWorld = */false);
+	AssetGuards.Empty();
+	CollectGarbage(RF_NoFlags);
+
+	if (!WriteReport(ReportPath, Resolution, Measurements))
+	{
+		UE_LOG(LogAutoPaintTerrain, Error, TEXT("Failed to write report to %s"), *ReportPath);
+		return 1;
+	}
+
+	UE_LOG(LogAutoPaintTerrain, Display, TEXT("Report: %s"), *ReportPath);
+	return 0;
+}
+
+TArray<int32> UAutoPaintBenchmarkCommandlet::ParseIntList(const FString& Params, const TCHAR* InName, const TArray<int32>& InDefault)
+{
+	FString Value;
+	if (!FParse::Value(*Params, InName, Value, /*bShouldStopOnSeparator = */false))
+	{
+		return InDefault;
+	}
+
+	TArray<FString> Items;
+	Value.ParseIntoArray(Items, TEXT(","));
+
+	TArray<int32> Result;
+	for (const FString& Item : Items)
+	{
+		if (Item.IsNumeric() && FCString::Atoi(*Item) > 0)
+		{
+			Result.Add(FCString::Atoi(*Item));
+		}
+	}
+	return Result.IsEmpty() ? InDefault : Result;
+}
+
+ALandscape* UAutoPaintBenchmarkCommandlet::CreateLandscape(UWorld* InWorld, int32 InResolution, const TArray<FName>& InWeightLayers)
+{
+	// Gentle slope, so the landscape isn't trivially flat
+	TArray<uint16> Heights;
+	Heights.SetNumUninitialized(InResolution * InResolution);
+	for (int32 Y = 0; Y < InResolution; ++Y)
+	{
+		for (int32 X = 0; X < InResolution; ++X)
+		{
+			Heights[Y * InResolution + X] = static_cast<uint16>(FMath::Min(LandscapeDataAccess::MidValue + (X + Y) * 2, static_cast<int32>(MAX_uint16)));
+		}
+	}
+
+	// First layer fully painted, the others empty
+	TArray<FLandscapeImportLayerInfo> ImportLayers;
+	for (int32 LayerIndex = 0; LayerIndex < InWeightLayers.Num(); ++LayerIndex)
+	{
+		ULandscapeLayerInfoObject* LayerInfo = NewObject<ULandscapeLayerInfoObject>(GetTransientPackage(), NAME_None, RF_Transient);
+		LayerInfo->LayerName = InWeightLayers[LayerIndex];
+
+		FLandscapeImportLayerInfo& ImportLayer = ImportLayers.Emplace_GetRef(InWeightLayers[LayerIndex]);
+		ImportLayer.LayerInfo = LayerInfo;
+		ImportLayer.LayerData.Init(LayerIndex == 0 ? 255 : 0, InResolution * InResolution);
+	}
+
+	ALandscape* Landscape = InWorld->SpawnActor<ALandscape>();
+	if (!Landscape)
+	{
+		return nullptr;
+	}
+	Landscape->bCanHaveLayersContent = true;
+	Landscape->SetActorScale3D(FVector(AutoPaintBenchmark::LandscapeScale));
+
+	TMap<FGuid, TArray<uint16>> HeightDataPerLayer;
+	HeightDataPerLayer.Add(FGuid(), MoveTemp(Heights));
+	TMap<FGuid, TArray<FLandscapeImportLayerInfo>> MaterialLayerDataPerLayer;
+	MaterialLayerDataPerLayer.Add(FGuid(), MoveTemp(ImportLayers));
+
+	Landscape->Import(FGuid::NewGuid(), 0, 0, InResolution - 1, InResolution - 1, /*InNumSubsections = */1, AutoPaintBenchmark::ComponentQuads,
+		HeightDataPerLayer, nullptr, MaterialLayerDataPerLayer, ELandscapeImportAlphamapType::Additive);
+
+	ULandscapeInfo* LandscapeInfo = Landscape->GetLandscapeInfo();
+	if (!LandscapeInfo)
+	{
+		return nullptr;
+	}
+	LandscapeInfo->UpdateLayerInfoMap(Landscape);
+	return Landscape;
+}
+
+TArray<UAutoPaintData*> UAutoPaintBenchmarkCommandlet::CreateAssets(int32 InNumAssets, int32 InResolution, FRandomStream& InRandom)
+{
+	TArray<UAutoPaintData*> Assets;
+	TArray<FColor> Pixels;
+	Pixels.SetNumUninitialized(InResolution * InResolution);
+
+	for (int32 AssetIndex = 0; AssetIndex < InNumAssets; ++AssetIndex)
+	{
+		UAutoPaintData* Data = NewObject<UAutoPaintData>(GetTransientPackage(), *FString::Printf(TEXT("AutoPaintBenchmark%d"), AssetIndex), RF_Transient);
+		Data->SceneCaptureResolution = FIntPoint(InResolution);
+
+		// A few random bumps in R, round mask in A, like a captured rock
+		struct FBump
+		{
+			FVector2f Center;
+			float Radius;
+			float Height;
+		};
+		FBump Bumps[3];
+		for (FBump& Bump : Bumps)
+		{
+			Bump.Center = FVector2f(InRandom.FRandRange(0.3f, 0.7f), InRandom.FRandRange(0.3f, 0.7f));
+			Bump.Radius = InRandom.FRandRange(0.1f, 0.25f);
+			Bump.Height = InRandom.FRandRange(0.3f, 1.f);
+		}
+
+		for (int32 Y = 0; Y < InResolution; ++Y)
+		{
+			for (int32 X = 0; X < InResolution; ++X)
+			{
+				const FVector2f UV((X + 0.5f) / InResolution, (Y + 0.5f) / InResolution);
+
+				float Height = 0.f;
+				for (const FBump& Bump : Bumps)
+				{
+					Height = FMath::Max(Height, Bump.Height * FMath::Exp(-FVector2f::DistSquared(UV, Bump.Center) / (Bump.Radius * Bump.Radius)));
+				}
+				const float Mask = FMath::Clamp((0.5f - FVector2f::Distance(UV, FVector2f(0.5f))) * 20.f, 0.f, 1.f);
+
+				Pixels[Y * InResolution + X] = FColor(FMath::RoundToInt(Height * 255.f), 0, 0, FMath::RoundToInt(Mask * 255.f));
+			}
+		}
+
+		UTexture2D* Texture = NewObject<UTexture2D>(Data, TEXT("T_AP_TextureAsset"), RF_Transient);
+		Texture->Source.Init(InResolution, InResolution, /*NumSlices = */1, /*NumMips = */1, TSF_BGRA8, reinterpret_cast<const uint8*>(Pixels.GetData()));
+		Texture->SRGB = false;
+		Texture->Filter = TextureFilter::TF_Bilinear;
+		Texture->MipGenSettings = TextureMipGenSettings::TMGS_NoMipmaps;
+		Texture->CompressionSettings = TextureCompressionSettings::TC_VectorDisplacementmap;
+		Texture->NeverStream = true;
+		Texture->PostEditChange();
+
+		Data->TextureAsset = Texture;
+		Assets.Add(Data);
+	}
+
+	FTextureCompilingManager::Get().FinishAllCompilation();
+	return Assets;
+}
+
+void UAutoPaintBenchmarkCommandlet::ScatterPatches(AActor* InHost, ALandscapePatchManager* InPatchManager, const ALandscape* InLandscape, TConstArrayView<UAutoPaintData*> InAssets,
+	const TArray<FName>& InWeightLayers, int32 InNumPatches, FRandomStream& InRandom, TArray<UAutoPaintLandscapePatchComponent*>& OutPatches)
+{
+	USceneComponent* Root = NewObject<USceneComponent>(InHost, TEXT("Root"));
+	InHost->SetRootComponent(Root);
+	Root->RegisterComponent();
+
+	const FBox LandscapeBounds = InLandscape->GetComponentsBoundingBox();
+
+	OutPatches.Reserve(InNumPatches);
+	for (int32 PatchIndex = 0; PatchIndex < InNumPatches; ++PatchIndex)
+	{
+		UAutoPaintLandscapePatchComponent* Patch = NewObject<UAutoPaintLandscapePatchComponent>(InHost, NAME_None, RF_Transient);
+		Patch->Asset = InAssets[PatchIndex % InAssets.Num()];
+		Patch->bAffectHeightmap = true;
+		if (!InWeightLayers.IsEmpty())
+		{
+			Patch->AffectWeightmap.Add(InWeightLayers[PatchIndex % InWeightLayers.Num()]);
+		}
+
+		Patch->SetupAttachment(Root);
+		Patch->SetWorldLocationAndRotation(
+			FVector(InRandom.FRandRange(LandscapeBounds.Min.X, LandscapeBounds.Max.X), InRandom.FRandRange(LandscapeBounds.Min.Y, LandscapeBounds.Max.Y), LandscapeBounds.GetCenter().Z),
+			FRotator(0.f, InRandom.FRandRange(0.f, 360.f), 0.f));
+		Patch->RegisterComponent();
+		InHost->AddInstanceComponent(Patch);
+		Patch->SetPatchManager(InPatchManager);
+
+		OutPatches.Add(Patch);
+	}
+}
+
+void UAutoPaintBenchmarkCommandlet::MeasureFullUpdate(ALandscape* InLandscape, bool bInWeightmap, int32 InIterations, FMeasurement& OutMeasurement)
+{
+	OutMeasurement.Target = bInWeightmap ? TEXT("Weightmap") : TEXT("Heightmap");
+	OutMeasurement.Update = TEXT("Full");
+
+	const ELandscapeLayerUpdateMode Mode = bInWeightmap ? ELandscapeLayerUpdateMode::Update_Weightmap_All : ELandscapeLayerUpdateMode::Update_Heightmap_All;
+	for (int32 Iteration = -1; Iteration < InIterations; ++Iteration)
+	{
+		InLandscape->RequestLayersContentUpdateForceAll(Mode);
+		const double Milliseconds = UpdateLandscape(InLandscape);
+
+		// First one pays for shader and render target creation
+		if (Iteration >= 0)
+		{
+			OutMeasurement.Milliseconds.Add(Milliseconds);
+		}
+	}
+}
+
+void UAutoPaintBenchmarkCommandlet::MeasureIncrementalUpdate(ALandscape* InLandscape, UAutoPaintLandscapePatchComponent* InPatch, bool bInWeightmap, int32 InIterations, FMeasurement& OutMeasurement)
+{
+	OutMeasurement.Target = bInWeightmap ? TEXT("Weightmap") : TEXT("Heightmap");
+	OutMeasurement.Update = TEXT("Incremental");
+
+	ULandscapeInfo* LandscapeInfo = InLandscape->GetLandscapeInfo();
+	const UAutoPaintData* Data = InPatch->Asset.Get();
+	if (!LandscapeInfo || !Data)
+	{
+		return;
+	}
+
+	const FVector Offset(Data->TextureWorldSize.X / 4, 0, 0);
+	for (int32 Iteration = -1; Iteration < InIterations; ++Iteration)
+	{
+		// Same footprint as UAutoPaintLandscapePatchComponent::IssueLandscapeUpdate, limited to the measured target
+		FBox UpdateBounds = InPatch->GetPatchWorldBounds();
+		InPatch->AddWorldOffset(Iteration % 2 == 0 ? Offset : -Offset);
+		UpdateBounds += InPatch->GetPatchWorldBounds();
+
+		const FBox2D UpdateArea(FVector2D(UpdateBounds.Min), FVector2D(UpdateBounds.Max));
+		LandscapeInfo->ForAllLandscapeComponents([&UpdateArea, bInWeightmap](ULandscapeComponent* LandscapeComponent)
+		{
+			const FBox ComponentBounds = LandscapeComponent->Bounds.GetBox();
+			if (!UpdateArea.Intersect(FBox2D(FVector2D(ComponentBounds.Min), FVector2D(ComponentBounds.Max))))
+			{
+				return;
+			}
+
+			if (bInWeightmap)
+			{
+				LandscapeComponent->RequestWeightmapUpdate();
+			}
+			else
+			{
+				LandscapeComponent->RequestHeightmapUpdate();
+			}
+		});
+
+		const double Milliseconds = UpdateLandscape(InLandscape);
+		if (Iteration >= 0)
+		{
+			OutMeasurement.Milliseconds.Add(Milliseconds);
+		}
+	}
+}
+
+double UAutoPaintBenchmarkCommandlet::UpdateLandscape(ALandscape* InLandscape)
+{
+	// No engine loop in a commandlet, per frame AutoPaint state (precomposite passes, patch costs) follows the frame counter
+	++GFrameCounter;
+
+	const double Start = FPlatformTime::Seconds();
+	InLandscape->ForceUpdateLayersContent();
+
+	FRenderCommandFence Fence;
+	Fence.BeginFence(/*bSyncToRHIAndGPU = */true);
+	Fence.Wait();
+
+	return (FPlatformTime::Seconds() - Start) * 1000.0;
+}
+
+bool UAutoPaintBenchmarkCommandlet::WriteReport(const FString& InPath, int32 InResolution, const TArray<FMeasurement>& InMeasurements)
+{
+	const FString EngineVersion = FEngineVersion::Current().ToString();
+
+	FString Output = TEXT("EngineVersion,Resolution,Patches,PatchSize,Target,Update,Iterations,MinMs,MedianMs,MeanMs,MaxMs\n");
+	for (const FMeasurement& Measurement : InMeasurements)
+	{
+		if (Measurement.Milliseconds.IsEmpty())
+		{
+			continue;
+		}
+
+		TArray<double> Sorted = Measurement.Milliseconds;
+		Sorted.Sort();
+
+		double Sum = 0.0;
+		for (const double Milliseconds : Sorted)
+		{
+			Sum += Milliseconds;
+		}
+
+		Output += FString::Printf(TEXT("%s,%d,%d,%.0f,%s,%s,%d,%.3f,%.3f,%.3f,%.3f\n"), *EngineVersion, InResolution, Measurement.NumPatches, Measurement.PatchSize,
+			*Measurement.Target, *Measurement.Update, Sorted.Num(), Sorted[0], Sorted[Sorted.Num() / 2], Sum / Sorted.Num(), Sorted.Last());
+
+		UE_LOG(LogAutoPaintTerrain, Display, TEXT("%5d patches, %5.0f cm, %s %s: median %.2f ms"), Measurement.NumPatches, Measurement.PatchSize,
+			*Measurement.Target, *Measurement.Update, Sorted[Sorted.Num() / 2]);
+	}
+
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(InPath), /*Tree = */true);
+	return FFileHelper::SaveStringToFile(Output, *InPath);
+}
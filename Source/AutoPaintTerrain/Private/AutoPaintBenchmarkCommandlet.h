@@ -0,0 +1,73 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "AutoPaintBenchmarkCommandlet.generated.h"
+
+class ALandscape;
+class ALandscapePatchManager;
+class UAutoPaintData;
+class UAutoPaintLandscapePatchComponent;
+
+/**
+ * Builds a synthetic landscape in a transient world, scatters AutoPaint patches over it and times landscape updates.
+ * Patch assets are generated in memory (no capture), so results only depend on the patch count and size.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd.exe <Project> -run=AutoPaintBenchmark -AllowCommandletRendering [-Resolution=2017] [-Patches=100,1000,4000]
+ *     [-PatchSizes=1000,4000] [-Assets=16] [-AssetResolution=256] [-WeightLayers=3] [-Iterations=5] [-Seed=0] [-Report=<Path.csv>]
+ *
+ * -Resolution       Landscape vertices per side, rounded down to whole 63 quad components.
+ * -Patches          Patch counts to run, comma separated.
+ * -PatchSizes       Patch world sizes in cm to run with every patch count, comma separated.
+ * -Assets           Distinct UAutoPaintData assets the patches are spread over.
+ * -WeightLayers     Paint layers on the landscape, every patch affects the heightmap and one of them.
+ * -Iterations       Timed updates per measurement, after one untimed warm up.
+ * -Report           Output CSV, one row per measurement. Defaults to Saved/AutoPaint/Benchmark.csv
+ *
+ * Full updates recompose the whole heightmap or every weightmap. Incremental updates move one patch and update
+ * only the landscape components under its old and new footprint, as an edit in the level editor would.
+ */
+UCLASS()
+class UAutoPaintBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAutoPaintBenchmarkCommandlet();
+
+	//~ Begin UCommandlet Interface
+	virtual int32 Main(const FString& Params) override;
+	//~ End UCommandlet Interface
+
+private:
+	struct FMeasurement
+	{
+		int32 NumPatches = 0;
+		float PatchSize = 0.f;
+		FString Target;
+		FString Update;
+		TArray<double> Milliseconds;
+	};
+
+	static TArray<int32> ParseIntList(const FString& Params, const TCHAR* InName, const TArray<int32>& InDefault);
+
+	static ALandscape* CreateLandscape(UWorld* InWorld, int32 InResolution, const TArray<FName>& InWeightLayers);
+	static TArray<UAutoPaintData*> CreateAssets(int32 InNumAssets, int32 InResolution, FRandomStream& InRandom);
+
+	static void ScatterPatches(AActor* InHost, ALandscapePatchManager* InPatchManager, const ALandscape* InLandscape, TConstArrayView<UAutoPaintData*> InAssets,
+		const TArray<FName>& InWeightLayers, int32 InNumPatches, FRandomStream& InRandom, TArray<UAutoPaintLandscapePatchComponent*>& OutPatches);
+
+	/** Untimed warm up, then InIterations timed updates of the whole heightmap or every weightmap */
+	static void MeasureFullUpdate(ALandscape* InLandscape, bool bInWeightmap, int32 InIterations, FMeasurement& OutMeasurement);
+
+	/** Moves InPatch back and forth and updates only the landscape components under its footprint */
+	static void MeasureIncrementalUpdate(ALandscape* InLandscape, UAutoPaintLandscapePatchComponent* InPatch, bool bInWeightmap, int32 InIterations, FMeasurement& OutMeasurement);
+
+	/** Waits until the landscape finished rendering on the GPU */
+	static double UpdateLandscape(ALandscape* InLandscape);
+
+	static bool WriteReport(const FString& InPath, int32 InResolution, const TArray<FMeasurement>& InMeasurements);
+};
@@ -0,0 +1,289 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintInstancedLandscapePatchComponent.h"
+
+#include "AutoPaintInstancedTexturePatchPS.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "AutoPaintStats.h"
+#include "LandscapePatchManager.h"
+#include "AutoPaintData.h"
+#include "Landscape.h"
+#include "Algo/StableSort.h"
+#include "Engine/Texture.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+DECLARE_CYCLE_STAT(TEXT("Get Instance Shader Params"), STAT_AutoPaint_GetInstanceShaderParams, STATGROUP_AutoPaint);
+
+void UAutoPaintInstancedLandscapePatchComponent::LoadStampAssets()
+{
+	StampAssets.Reset();
+	for (const FAutoPaintPatchStamp& Stamp : Stamps)
+	{
+		if (UAutoPaintData* StampAsset = Stamp.Asset.LoadSynchronous())
+		{
+			StampAssets.AddUnique(StampAsset);
+		}
+	}
+}
+
+void UAutoPaintInstancedLandscapePatchComponent::OnRegister()
+{
+	// Before Super, registering requests the landscape update
+	LoadStampAssets();
+	Super::OnRegister();
+}
+
+#if WITH_EDITOR
+void UAutoPaintInstancedLandscapePatchComponent::PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent)
+{
+	if (PropertyChangedEvent.GetMemberPropertyName() == GET_MEMBER_NAME_CHECKED(UAutoPaintInstancedLandscapePatchComponent, Stamps))
+	{
+		LoadStampAssets();
+	}
+	Super::PostEditChangeProperty(PropertyChangedEvent);
+}
+#endif
+
+UTextureRenderTarget2D* UAutoPaintInstancedLandscapePatchComponent::ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult)
+{
+	return ApplyInstances(InCombinedResult, /*bInWeightmap = */false);
+}
+
+UTextureRenderTarget2D* UAutoPaintInstancedLandscapePatchComponent::ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName)
+{
+	return ApplyInstances(InCombinedResult, /*bInWeightmap = */true, InLayerName);
+}
+
+uint32 UAutoPaintInstancedLandscapePatchComponent::GetUpdateInputHash() const
+{
+	uint32 Hash = Super::GetUpdateInputHash();
+
+	auto HashTransform = [&Hash](const FTransform& Transform)
+	{
+		const FVector3d Translation = Transform.GetTranslation();
+		const FQuat4d Rotation = Transform.GetRotation();
+		const FVector3d Scale = Transform.GetScale3D();
+		Hash = FCrc::MemCrc32(&Translation, sizeof(Translation), Hash);
+		Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+		Hash = FCrc::MemCrc32(&Scale, sizeof(Scale), Hash);
+	};
+
+	for (const FTransform& Instance : Instances)
+	{
+		HashTransform(Instance);
+	}
+	for (const FAutoPaintPatchStamp& Stamp : Stamps)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Stamp.Asset.ToSoftObjectPath()));
+		// Recaptured or edited stamp assets change the result as much as moved stamps
+		Hash = HashAssetInputs(Stamp.Asset.Get(), Hash);
+		Hash = HashCombine(Hash, GetTypeHash(Stamp.Priority));
+		HashTransform(Stamp.Transform);
+	}
+	return Hash;
+}
+
+FBox UAutoPaintInstancedLandscapePatchComponent::GetPatchWorldBounds() const
+{
+	const FTransform ComponentToWorld = GetComponentTransform();
+
+	FBox Bounds(ForceInit);
+	if (const UAutoPaintData* InstanceAsset = Asset.Get())
+	{
+		for (const FTransform& Instance : Instances)
+		{
+			Bounds += GetAssetWorldBounds(AlignPatchToLandscape(Instance * ComponentToWorld, InstanceAsset), InstanceAsset);
+		}
+	}
+	for (const FAutoPaintPatchStamp& Stamp : Stamps)
+	{
+		if (const UAutoPaintData* StampAsset = Stamp.Asset.Get())
+		{
+			Bounds += GetAssetWorldBounds(AlignPatchToLandscape(Stamp.Transform * ComponentToWorld, StampAsset), StampAsset);
+		}
+	}
+	return Bounds;
+}
+
+UTextureRenderTarget2D* UAutoPaintInstancedLandscapePatchComponent::ApplyInstances(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, const FName& InLayerName)
+{
+	if (Instances.IsEmpty() && Stamps.IsEmpty())
+	{
+		return InCombinedResult;
+	}
+
+	FAutoPaintInstancedTexturePatchDispatchParams Params;
+	Params.CombinedResult = InCombinedResult->GetResource();
+	Params.bWeightmap = bInWeightmap;
+	if (bInWeightmap)
+	{
+		Params.DerivedWeight = GetDerivedWeightParams(InLayerName);
+	}
+
+	GetInstanceShaderParams(FIntPoint(InCombinedResult->SizeX, InCombinedResult->SizeY), bInWeightmap, Params.Patches, Params.Instances);
+	if (Params.Instances.IsEmpty())
+	{
+		return InCombinedResult;
+	}
+
+	int64 Pixels = 0;
+	for (const FAutoPaintTexturePatchInstance& Instance : Params.Instances)
+	{
+		Pixels += Instance.DestinationBounds.Area();
+	}
+	FAutoPaintPatchCostTracker::Get().AddPixels(this, Pixels);
+
+	FAutoPaintInstancedTexturePatchGPUInterface::Dispatch(Params);
+
+	return InCombinedResult;
+}
+
+void UAutoPaintInstancedLandscapePatchComponent::GetInstanceShaderParams(const FIntPoint& DestinationResolutionIn, bool bInWeightmap,
+	TArray<FAutoPaintInstancedTexturePatchSource>& PatchesOut, TArray<FAutoPaintTexturePatchInstance>& InstancesOut) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_GetInstanceShaderParams);
+
+	struct FStamp
+	{
+		const UAutoPaintData* Asset;
+		const FTransform* Transform;
+		int32 Priority;
+	};
+
+	TArray<FStamp> SortedStamps;
+	SortedStamps.Reserve(Instances.Num() + Stamps.Num());
+	if (const UAutoPaintData* InstanceAsset = Asset.Get())
+	{
+		for (const FTransform& Instance : Instances)
+		{
+			SortedStamps.Add({ InstanceAsset, &Instance, 0 });
+		}
+	}
+	for (const FAutoPaintPatchStamp& Stamp : Stamps)
+	{
+		// Loaded by LoadStampAssets, the apply path never loads packages
+		if (const UAutoPaintData* StampAsset = Stamp.Asset.Get())
+		{
+			SortedStamps.Add({ StampAsset, &Stamp.Transform, Stamp.Priority });
+		}
+	}
+	Algo::StableSortBy(SortedStamps, &FStamp::Priority);
+
+	// Everything that doesn't depend on the instance is hoisted out of the loop, see GetCommonShaderParams
+	struct FPatchConstants
+	{
+		FMatrix44d PatchUVToPatch;
+		FMatrix44d PatchLocalToUVs;
+		double HeightScale;
+		float Falloff;
+		/** Patch UV rect the patch can affect, corners for the destination bounds */
+		FVector3d UVCorners[4];
+	};
+	TArray<FPatchConstants> PatchConstants;
+	TMap<const UAutoPaintData*, int32> PatchIndices;
+
+	const FTransform LandscapeHeightmapToWorld = PatchManager->GetHeightmapCoordsToWorld();
+	const FMatrix44d LandscapeToWorld = LandscapeHeightmapToWorld.ToMatrixWithScale();
+	const FMatrix44d WorldToLandscape = LandscapeHeightmapToWorld.ToInverseMatrixWithScale();
+
+	const FTransform ComponentToWorld = GetComponentTransform();
+
+	double LandscapeHeightScale = Landscape.IsValid() ? Landscape->GetTransform().GetScale3D().Z : 1;
+	LandscapeHeightScale = LandscapeHeightScale == 0 ? 1 : LandscapeHeightScale;
+
+	// Single pass over the instances, matrix products go through the SIMD VectorMatrixMultiply path
+	InstancesOut.Reset(SortedStamps.Num());
+	for (const FStamp& Stamp : SortedStamps)
+	{
+		int32 PatchIndex = INDEX_NONE;
+		if (const int32* FoundIndex = PatchIndices.Find(Stamp.Asset))
+		{
+			PatchIndex = *FoundIndex;
+		}
+		else
+		{
+			UTexture* PatchUObject = Stamp.Asset->TextureAsset;
+			FTextureResource* Patch = IsValid(PatchUObject) ? PatchUObject->GetResource() : nullptr;
+			if (Patch)
+			{
+				PatchIndex = PatchesOut.Num();
+
+				FAutoPaintInstancedTexturePatchSource& Source = PatchesOut.AddDefaulted_GetRef();
+				Source.Texture = Patch;
+				Source.ContentId = GetPatchContentId(PatchUObject);
+				// The outer half-pixel shouldn't affect the landscape because it is not part of our official coverage area.
+				Source.EdgeUVDeadBorder = FVector2f(0.5 / Patch->GetSizeX(), 0.5 / Patch->GetSizeY());
+				Source.ZeroInEncoding = 0.f;
+				Source.bShapeFalloff = Stamp.Asset->UsesShapeFalloff();
+				Source.bHasDerivatives = Stamp.Asset->bTextureHasDerivatives;
+
+				const FVector2D FullPatchDimensions = GetAssetUnscaledWorldSize(Stamp.Asset);
+				Source.PatchWorldDimensions = FVector2f(FullPatchDimensions);
+
+				const FTransform FromPatchUVToPatch(FQuat4d::Identity, FVector3d(-FullPatchDimensions.X / 2, -FullPatchDimensions.Y / 2, 0),
+					FVector3d(FullPatchDimensions.X, FullPatchDimensions.Y, 1));
+
+				FPatchConstants& Constants = PatchConstants.AddDefaulted_GetRef();
+				Constants.PatchUVToPatch = FromPatchUVToPatch.ToMatrixWithScale();
+				Constants.PatchLocalToUVs = FromPatchUVToPatch.ToInverseMatrixWithScale();
+				Constants.HeightScale = LANDSCAPE_INV_ZSCALE / LandscapeHeightScale * Stamp.Asset->HeightWPO;
+				Constants.Falloff = Stamp.Asset->Falloff;
+
+				const FBox2D UVBounds = Stamp.Asset->GetFalloffUVBounds();
+				Constants.UVCorners[0] = FVector3d(UVBounds.Min.X, UVBounds.Min.Y, 0);
+				Constants.UVCorners[1] = FVector3d(UVBounds.Min.X, UVBounds.Max.Y, 0);
+				Constants.UVCorners[2] = FVector3d(UVBounds.Max.X, UVBounds.Min.Y, 0);
+				Constants.UVCorners[3] = FVector3d(UVBounds.Max.X, UVBounds.Max.Y, 0);
+			}
+			PatchIndices.Add(Stamp.Asset, PatchIndex);
+		}
+
+		if (PatchIndex == INDEX_NONE)
+		{
+			continue;
+		}
+
+		const FPatchConstants& Constants = PatchConstants[PatchIndex];
+		const FTransform PatchToWorld = AlignPatchToLandscape(*Stamp.Transform * ComponentToWorld, Stamp.Asset);
+		const FMatrix44d PatchToWorldMatrix = PatchToWorld.ToMatrixWithScale();
+
+		FAutoPaintTexturePatchInstance& Instance = InstancesOut.AddDefaulted_GetRef();
+		Instance.PatchIndex = PatchIndex;
+
+		// In unreal, matrix composition is done by multiplying the subsequent ones on the right, and the result
+		// is transpose of what our shader will expect (because unreal right multiplies vectors by matrices).
+		const FMatrix44d LandscapeToPatchUVTransposed = LandscapeToWorld * PatchToWorldMatrix.Inverse() * Constants.PatchLocalToUVs;
+		Instance.HeightmapToPatch = (FMatrix44f)LandscapeToPatchUVTransposed.GetTransposed();
+
+		const FMatrix44d PatchUVToHeightmap = Constants.PatchUVToPatch * PatchToWorldMatrix * WorldToLandscape;
+		FBox2D FloatBounds(ForceInit);
+		for (const FVector3d& UVCorner : Constants.UVCorners)
+		{
+			const FVector3d HeightmapCoordinates = PatchUVToHeightmap.TransformPosition(UVCorner);
+			FloatBounds += FVector2D(HeightmapCoordinates.X, HeightmapCoordinates.Y);
+		}
+
+		Instance.DestinationBounds = FIntRect(
+			FMath::Clamp(FMath::Floor(FloatBounds.Min.X), 0, DestinationResolutionIn.X - 1),
+			FMath::Clamp(FMath::Floor(FloatBounds.Min.Y), 0, DestinationResolutionIn.Y - 1),
+			FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.X) + 1, 0, DestinationResolutionIn.X),
+			FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.Y) + 1, 0, DestinationResolutionIn.Y));
+
+		const FVector3d InstanceScale = PatchToWorld.GetScale3D();
+		Instance.FalloffWorldMargin = Constants.Falloff / FMath::Min(InstanceScale.X, InstanceScale.Y);
+
+		if (bInWeightmap)
+		{
+			Instance.HeightScale = 1.f;
+			Instance.HeightOffset = 0.f;
+			Instance.DerivedHeightScale = GetDerivedHeightScale(PatchToWorld, Stamp.Asset);
+		}
+		else
+		{
+			const FVector3d PatchOriginInHeightmapCoords = WorldToLandscape.TransformPosition(PatchToWorld.GetTranslation());
+			Instance.HeightScale = Constants.HeightScale * InstanceScale.Z;
+			Instance.HeightOffset = PatchOriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue;
+		}
+	}
+}
@@ -3,12 +3,32 @@
 
 #include "AutoPaintLandscapePatchComponent.h"
 
-// #include "AutoPaintCircleHeightPatchPS.h" // DEBUG
 #include "AutoPaintTexturePatchPS.h"
+#include "AutoPaintPatchCompositePS.h"
+#include "AutoPaintPatchCompositeCache.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "AutoPaintStats.h"
+#include "AutoPaintLandscapeUpdateScheduler.h"
+#include "AutoPaintTerrainSettings.h"
 #include "LandscapePatchManager.h"
 #include "AutoPaintData.h"
 #include "Landscape.h"
+#include "LandscapeComponent.h"
+#include "LandscapeInfo.h"
+#include "Engine/AssetManager.h"
+#include "Engine/StreamableManager.h"
 #include "Engine/TextureRenderTarget2D.h"
+#include "Misc/ScopeExit.h"
+
+DECLARE_CYCLE_STAT(TEXT("Render Layer"), STAT_AutoPaint_RenderLayer, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Build Patch Proxy"), STAT_AutoPaint_BuildPatchProxy, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Get Common Shader Params"), STAT_AutoPaint_GetCommonShaderParams, STATGROUP_AutoPaint);
+
+namespace AutoPaintLandscapePatch
+{
+	/** Delay before a patch with tiles still building its platform data is applied again */
+	static constexpr double TileRetrySeconds = 0.25;
+}
 
 UAutoPaintLandscapePatchComponent::UAutoPaintLandscapePatchComponent()
 {
@@ -19,6 +39,15 @@ UAutoPaintLandscapePatchComponent::UAutoPaintLandscapePatchComponent()
 
 UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::RenderLayer_Native(const FLandscapeBrushParameters& InParameters)
 {
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_RenderLayer);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, RenderLayer);
+
+	const double StartTime = FPlatformTime::Seconds();
+	ON_SCOPE_EXIT
+	{
+		FAutoPaintPatchCostTracker::Get().AddRender(this, FPlatformTime::Seconds() - StartTime);
+	};
+
 	if (!ensure(PatchManager.IsValid()))
 	{
 		return InParameters.CombinedResult;
@@ -34,6 +63,10 @@ UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::RenderLayer_Native(co
 
 		return ApplyToHeightmap(InParameters.CombinedResult);
 	}
+	else if (bIsVisibilityLayerTarget)
+	{
+		return AffectsVisibilityLayer() ? ApplyToVisibility(InParameters.CombinedResult) : InParameters.CombinedResult;
+	}
 	else
 	{
 		// Try to find the weight patch
@@ -65,171 +98,716 @@ UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::RenderLayer_Native(co
 		// }
 		// else
 		{
-			return ApplyToWeightmap(InParameters.CombinedResult);
+			return ApplyToWeightmap(InParameters.CombinedResult, InParameters.WeightmapLayerName);
 		}
 	}
 }
 
 UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult)
 {
-	// // Circle height patch doesn't affect regular weightmap layers.
-	// if (InParameters.LayerType != ELandscapeToolTargetType::Heightmap)
-	// {
-	// 	return InParameters.CombinedResult;
-	// }
-
-	// DEBUG ONLY
-	// FTransform HeightmapCoordsToWorld = PatchManager->GetHeightmapCoordsToWorld();
-	// double ToHeightmapRadiusScale = GetComponentTransform().GetScale3D().X / HeightmapCoordsToWorld.GetScale3D().X;
-	// FVector3d CircleCenterWorld = GetComponentTransform().GetTranslation();
-	
-	// FAutoPaintCircleHeightPatchDispatchParams Params;
-	// Params.CombinedResult = InParameters.CombinedResult;
-	// Params.CenterInHeightmapCoordinates = HeightmapCoordsToWorld.InverseTransformPosition(CircleCenterWorld);
-	// float RadiusAdjustment = bExclusiveRadius ? 0 : 1;
-	// Params.HeightmapRadius = Radius * ToHeightmapRadiusScale + RadiusAdjustment;
-	// Params.HeightmapFalloff = Falloff * ToHeightmapRadiusScale + RadiusAdjustment;
-	//
-	// FAutoPaintCircleHeightPatchGPUInterface::Dispatch(Params);
-
-	if (!Asset)
+	if (FAutoPaintPatchCompositeCache::Get().ApplyToHeightmap(this, PatchManager.Get(), InCombinedResult))
 	{
+		// Applied as part of the precomposite
 		return InCombinedResult;
 	}
 
-	UTexture* PatchUObject = Asset->TextureAsset;
-	if (!IsValid(PatchUObject))
+	const FAutoPaintTexturePatchProxyPtr Proxy = GetHeightmapProxy(InCombinedResult);
+	if (Proxy->Regions.IsEmpty())
 	{
 		return InCombinedResult;
 	}
 
-	FTextureResource* Patch = PatchUObject->GetResource();
-	if (!Patch)
+	FAutoPaintPatchCostTracker::Get().AddPixels(this, Proxy->DestinationBounds.Area());
+
+	if (IsInteractive())
 	{
+		FAutoPaintPatchPreviewDispatchParams PreviewParams;
+		PreviewParams.CombinedResult = InCombinedResult->GetResource();
+		PreviewParams.Downsample = FMath::DivideAndRoundUp(Proxy->DestinationBounds.Size().GetMax(), GetDefault<UAutoPaintTerrainSettings>()->PreviewResolution);
+		if (PreviewParams.Downsample > 1)
+		{
+			PreviewParams.Patches = Proxy->Regions;
+			FAutoPaintPatchPreviewGPUInterface::Dispatch(PreviewParams);
+
+			// Full resolution once the patch is left alone
+			FAutoPaintLandscapeUpdateScheduler::Get().RequestRefine(this);
+			return InCombinedResult;
+		}
+	}
+
+	FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch(Proxy, InCombinedResult->GetResource());
+
+	return InCombinedResult;
+}
+
+FAutoPaintTexturePatchProxyPtr UAutoPaintLandscapePatchComponent::GetHeightmapProxy(UTextureRenderTarget2D* InCombinedResult)
+{
+	return GetPatchProxy(InCombinedResult, /*bInWeightmap = */false);
+}
+
+UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName)
+{
+	const UAutoPaintData* LoadedAsset = Asset.Get();
+
+	FAutoPaintWeightLayerParams Layer;
+	Layer.DerivedWeight = GetDerivedWeightParams(InLayerName);
+	if (Layer.DerivedWeight.bEnabled && !(LoadedAsset && LoadedAsset->bTextureHasDerivatives))
+	{
+		// Nothing to derive the weight from until the asset is captured again
 		return InCombinedResult;
 	}
 
+	// Layers captured from mesh sections paint their mask, unless the component derives them itself
+	if (!Layer.DerivedWeight.bEnabled && LoadedAsset && !LoadedAsset->SectionLayers.IsEmpty())
+	{
+		const int32 Channel = LoadedAsset->GetSectionMaskChannel(InLayerName);
+		FTextureResource* SectionMask = Channel != INDEX_NONE ? LoadedAsset->SectionMaskTexture->GetResource() : nullptr;
+		if (SectionMask)
+		{
+			Layer.SectionMaskTexture = SectionMask;
+			Layer.SectionMaskChannel = Channel;
+		}
+		else if (LoadedAsset->GetSectionLayerNames().Contains(InLayerName))
+		{
+			// Mask not captured yet, painting the heights instead would cover the whole patch
+			return InCombinedResult;
+		}
+	}
+
+	const FAutoPaintTexturePatchProxyPtr Proxy = GetPatchProxy(InCombinedResult, /*bInWeightmap = */true);
+	FAutoPaintPatchCostTracker::Get().AddPixels(this, Proxy->DestinationBounds.Area());
+	FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch(Proxy, InCombinedResult->GetResource(), Layer);
+
+	return InCombinedResult;
+}
+
+FAutoPaintDerivedWeightParams FAutoPaintDerivedWeightmap::ToParams() const
+{
+	FAutoPaintDerivedWeightParams Params;
+	Params.bEnabled = true;
+	Params.SlopeRange = FVector3f(MinSlope, MaxSlope, SlopeTransition);
+	Params.bUseCurvature = bUseCurvature;
+	Params.CurvatureRange = FVector3f(MinCurvature, MaxCurvature, CurvatureTransition);
+	return Params;
+}
+
+FAutoPaintDerivedWeightParams UAutoPaintLandscapePatchComponent::GetDerivedWeightParams(const FName& InLayerName) const
+{
+	const FAutoPaintDerivedWeightmap* DerivedWeightmap = DerivedWeightmaps.FindByPredicate([&InLayerName](const FAutoPaintDerivedWeightmap& Entry)
+	{
+		return Entry.LayerName == InLayerName;
+	});
+	return DerivedWeightmap ? DerivedWeightmap->ToParams() : FAutoPaintDerivedWeightParams();
+}
+
+FVector2f UAutoPaintLandscapePatchComponent::GetDerivedHeightScale(const FTransform& InPatchToWorld, const UAutoPaintData* InAsset)
+{
+	// Same scaling as the heightmap: stored height times HeightWPO times the patch Z scale
+	const FVector3d Scale = InPatchToWorld.GetScale3D();
+	const double HeightWPO = InAsset ? InAsset->HeightWPO : 1.0;
+	return FVector2f(HeightWPO * Scale.Z, FMath::Max(FMath::Min(Scale.X, Scale.Y), UE_SMALL_NUMBER));
+}
+
+FAutoPaintTexturePatchProxyPtr UAutoPaintLandscapePatchComponent::GetPatchProxy(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap)
+{
+	FAutoPaintTexturePatchProxyPtr& CachedProxy = bInWeightmap ? WeightmapProxy : HeightmapProxy;
+
+	const uint32 InputHash = GetPatchProxyInputHash(InCombinedResult);
+	if (CachedProxy.IsValid() && CachedProxy->InputHash == InputHash)
+	{
+		return CachedProxy;
+	}
+
+	FAutoPaintTexturePatchProxyPtr Proxy = BuildPatchProxy(InCombinedResult, bInWeightmap, InputHash);
+	CachedProxy = (Asset && Asset->HasTextureTiles()) ? nullptr : Proxy;
+	return Proxy;
+}
+
+uint32 UAutoPaintLandscapePatchComponent::GetPatchProxyInputHash(UTextureRenderTarget2D* InCombinedResult) const
+{
+	uint32 Hash = GetUpdateInputHash();
+	Hash = HashCombine(Hash, GetTypeHash(FIntPoint(InCombinedResult->SizeX, InCombinedResult->SizeY)));
+
+	if (PatchManager.IsValid())
+	{
+		const FTransform HeightmapCoordsToWorld = PatchManager->GetHeightmapCoordsToWorld();
+		const FVector3d Translation = HeightmapCoordsToWorld.GetTranslation();
+		const FQuat4d Rotation = HeightmapCoordsToWorld.GetRotation();
+		const FVector3d Scale = HeightmapCoordsToWorld.GetScale3D();
+		Hash = FCrc::MemCrc32(&Translation, sizeof(Translation), Hash);
+		Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+		Hash = FCrc::MemCrc32(&Scale, sizeof(Scale), Hash);
+	}
+	if (Landscape.IsValid())
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Landscape->GetTransform().GetScale3D().Z));
+	}
+
+	// The resource is recreated when the texture is rebuilt or streamed
+	if (Asset && IsValid(Asset->TextureAsset))
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Asset->TextureAsset->GetResource()));
+	}
+	return Hash;
+}
+
+FAutoPaintTexturePatchProxyPtr UAutoPaintLandscapePatchComponent::BuildPatchProxy(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, uint32 InInputHash)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_BuildPatchProxy);
+	LLM_SCOPE_BYTAG(AutoPaint);
+
+	TSharedRef<FAutoPaintTexturePatchProxy, ESPMode::ThreadSafe> Proxy = MakeShared<FAutoPaintTexturePatchProxy, ESPMode::ThreadSafe>();
+	Proxy->InputHash = InInputHash;
+
+	if (!Asset || !PatchManager.IsValid())
+	{
+		return Proxy;
+	}
+
+	FIntPoint SourceResolutionIn;
+	if (!GetPatchSourceResolution(SourceResolutionIn))
+	{
+		return Proxy;
+	}
+
 	FAutoPaintTexturePatchDispatchParams Params;
-	Params.CombinedResult = InCombinedResult;
-	Params.PatchTexture = PatchUObject;
 
-	FIntPoint SourceResolutionIn = FIntPoint(Patch->GetSizeX(), Patch->GetSizeY());
 	FIntPoint DestinationResolutionIn = FIntPoint(InCombinedResult->SizeX, InCombinedResult->SizeY);
 	
 	FTransform PatchToWorld;
 	GetCommonShaderParams(SourceResolutionIn, DestinationResolutionIn,
 		PatchToWorld, Params.PatchWorldDimensions, Params.HeightmapToPatch, 
 		Params.DestinationBounds, Params.EdgeUVDeadBorder, Params.FalloffWorldMargin);
+	Params.bShapeFalloff = Asset->UsesShapeFalloff();
+	Params.DerivedHeightScale = GetDerivedHeightScale(PatchToWorld, Asset.Get());
 
+	if (!bInWeightmap)
+	{
+		double LandscapeHeightScale = Landscape.IsValid() ? Landscape->GetTransform().GetScale3D().Z : 1;
+		LandscapeHeightScale = LandscapeHeightScale == 0 ? 1 : LandscapeHeightScale;
 	
-	double LandscapeHeightScale = Landscape.IsValid() ? Landscape->GetTransform().GetScale3D().Z : 1;
-	LandscapeHeightScale = LandscapeHeightScale == 0 ? 1 : LandscapeHeightScale;
-	
-	// bool bNativeEncoding = HeightSourceMode == ELandscapeTexturePatchSourceMode::InternalTexture
-	// 	|| HeightEncoding == ELandscapeTextureHeightPatchEncoding::NativePackedHeight;
-	bool bNativeEncoding = false;
+		// bool bNativeEncoding = HeightSourceMode == ELandscapeTexturePatchSourceMode::InternalTexture
+		// 	|| HeightEncoding == ELandscapeTextureHeightPatchEncoding::NativePackedHeight;
+		bool bNativeEncoding = false;
 	
-	// To get height scale in heightmap coordinates, we have to undo the scaling that happens to map the 16bit int to [-256, 256), and undo
-	// the landscape actor scale.
+		// To get height scale in heightmap coordinates, we have to undo the scaling that happens to map the 16bit int to [-256, 256), and undo
+		// the landscape actor scale.
 
-	// HeightEncodingSettings.WorldSpaceEncodingScale
-	double WorldSpaceEncodingScale = 1;
-	// HeightEncodingSettings.ZeroInEncoding
-	double ZeroInEncoding = 0;
+		// HeightEncodingSettings.WorldSpaceEncodingScale
+		double WorldSpaceEncodingScale = 1;
+		// HeightEncodingSettings.ZeroInEncoding
+		double ZeroInEncoding = 0;
 	
-	Params.HeightScale = bNativeEncoding ? 1 : LANDSCAPE_INV_ZSCALE * WorldSpaceEncodingScale / LandscapeHeightScale;
+		Params.HeightScale = bNativeEncoding ? 1 : LANDSCAPE_INV_ZSCALE * WorldSpaceEncodingScale / LandscapeHeightScale;
 
-	// @todo:
-	Params.HeightScale *= Asset->HeightWPO;
+		// @todo:
+		Params.HeightScale *= Asset->HeightWPO;
 
-	/**
-	 * Whether to apply the patch Z scale to the height stored in the patch.
-	 */
-	bool bApplyComponentZScale = true;
-	if (bApplyComponentZScale)
+		/**
+		 * Whether to apply the patch Z scale to the height stored in the patch.
+		 */
+		bool bApplyComponentZScale = true;
+		if (bApplyComponentZScale)
+		{
+			FVector3d ComponentScale = PatchToWorld.GetScale3D();
+			Params.HeightScale *= ComponentScale.Z;
+		}
+
+		Params.ZeroInEncoding = bNativeEncoding ? LandscapeDataAccess::MidValue : ZeroInEncoding;
+
+		Params.HeightOffset = 0;
+		// switch (ZeroHeightMeaning)
+		// {
+		// case ELandscapeTextureHeightPatchZeroHeightMeaning::LandscapeZ:
+		// 	break; // no offset necessary
+		// case ELandscapeTextureHeightPatchZeroHeightMeaning::PatchZ:
+		{
+			FVector3d Location = PatchToWorld.GetTranslation();
+			FVector3d PatchOriginInHeightmapCoords = PatchManager->GetHeightmapCoordsToWorld().InverseTransformPosition(Location);
+			Params.HeightOffset = PatchOriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue;
+		// 	break;
+		}
+		// case ELandscapeTextureHeightPatchZeroHeightMeaning::WorldZero:
+		// {
+		// 	FVector3d WorldOriginInHeightmapCoords = PatchManager->GetHeightmapCoordsToWorld().InverseTransformPosition(FVector::ZeroVector);
+		// 	ParamsOut.InHeightOffset = WorldOriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue;
+		// 	break;
+		// }
+		// default:
+		// 	ensure(false);
+		// }
+	}
+
+	TArray<FPatchTextureRegion> Regions;
+	GetPatchTextureRegions(Params.HeightmapToPatch, Params.DestinationBounds, Regions);
+	for (const FPatchTextureRegion& Region : Regions)
 	{
-		FVector3d ComponentScale = PatchToWorld.GetScale3D();
-		Params.HeightScale *= ComponentScale.Z;
+		FTextureResource* Resource = Region.Texture ? Region.Texture->GetResource() : nullptr;
+		if (!Resource)
+		{
+			continue;
+		}
+
+		FAutoPaintTexturePatchDispatchParams& RegionParams = Proxy->Regions.Add_GetRef(Params);
+		RegionParams.PatchTexture = Resource;
+		RegionParams.PatchContentId = GetPatchContentId(Region.Texture);
+		RegionParams.PatchUVToTextureUV = Region.PatchUVToTextureUV;
+		RegionParams.PatchUVBounds = Region.PatchUVBounds;
+		RegionParams.DestinationBounds = Region.DestinationBounds;
+
+		if (Asset->HasTextureTiles())
+		{
+			// Tiles still loading are left out, the composite cache has to see the result change once they are resident
+			Proxy->InputHash = HashCombine(Proxy->InputHash, GetTypeHash(Resource));
+		}
+
+		if (Proxy->DestinationBounds.IsEmpty())
+		{
+			Proxy->DestinationBounds = Region.DestinationBounds;
+		}
+		else
+		{
+			Proxy->DestinationBounds.Union(Region.DestinationBounds);
+		}
 	}
 
-	Params.ZeroInEncoding = bNativeEncoding ? LandscapeDataAccess::MidValue : ZeroInEncoding;
+	return Proxy;
+}
 
-	Params.HeightOffset = 0;
-	// switch (ZeroHeightMeaning)
-	// {
-	// case ELandscapeTextureHeightPatchZeroHeightMeaning::LandscapeZ:
-	// 	break; // no offset necessary
-	// case ELandscapeTextureHeightPatchZeroHeightMeaning::PatchZ:
+bool UAutoPaintLandscapePatchComponent::GetPatchSourceResolution(FIntPoint& OutResolution) const
+{
+	if (Asset->HasTextureTiles())
 	{
-		FVector3d Location = PatchToWorld.GetTranslation();
-		FVector3d PatchOriginInHeightmapCoords = PatchManager->GetHeightmapCoordsToWorld().InverseTransformPosition(Location);
-		Params.HeightOffset = PatchOriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue;
-	// 	break;
+		// Tiles are cropped from a capture at this resolution
+		OutResolution = Asset->SceneCaptureResolution;
+		return OutResolution.X > 0 && OutResolution.Y > 0;
 	}
-	// case ELandscapeTextureHeightPatchZeroHeightMeaning::WorldZero:
-	// {
-	// 	FVector3d WorldOriginInHeightmapCoords = PatchManager->GetHeightmapCoordsToWorld().InverseTransformPosition(FVector::ZeroVector);
-	// 	ParamsOut.InHeightOffset = WorldOriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue;
-	// 	break;
-	// }
-	// default:
-	// 	ensure(false);
-	// }
 
-	FAutoPaintTexturePatchHeightmapGPUInterface::Dispatch(Params);
+	const UTexture* PatchUObject = Asset->TextureAsset;
+	if (!IsValid(PatchUObject))
+	{
+		return false;
+	}
 
-	return InCombinedResult;
+	const FTextureResource* Patch = PatchUObject->GetResource();
+	if (!Patch)
+	{
+		return false;
+	}
+
+	OutResolution = FIntPoint(Patch->GetSizeX(), Patch->GetSizeY());
+	return true;
 }
 
-UTextureRenderTarget2D* UAutoPaintLandscapePatchComponent::ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult)
+void UAutoPaintLandscapePatchComponent::GetPatchTextureRegions(const FMatrix44f& InHeightmapToPatch, const FIntRect& InDestinationBounds, TArray<FPatchTextureRegion>& OutRegions)
 {
-	if (!Asset)
+	if (InDestinationBounds.IsEmpty())
 	{
-		return InCombinedResult;
+		// Patch must be outside the landscape.
+		return;
 	}
 
-	UTexture* PatchUObject = Asset->TextureAsset;
-	if (!IsValid(PatchUObject))
+	if (!Asset->HasTextureTiles())
 	{
-		return InCombinedResult;
+		FPatchTextureRegion& Region = OutRegions.AddDefaulted_GetRef();
+		Region.Texture = Asset->TextureAsset;
+		Region.DestinationBounds = InDestinationBounds;
+		return;
 	}
 
-	FTextureResource* Patch = PatchUObject->GetResource();
-	if (!Patch)
+	const FIntPoint Resolution = Asset->SceneCaptureResolution;
+	const FIntPoint TileCount = Asset->TextureTileCount;
+	const int32 TileSize = Asset->TextureTileSize;
+
+	// Shader params are transposed, go back to row vectors to transform on CPU
+	const FMatrix44f HeightmapToPatchUV = InHeightmapToPatch.GetTransposed();
+	const FMatrix44f PatchUVToHeightmap = HeightmapToPatchUV.Inverse();
+
+	// Patch UVs seen by the destination pixels, in tile units
+	FBox2f TileSpaceBounds(ForceInit);
+	for (const FIntPoint& Corner : { InDestinationBounds.Min, FIntPoint(InDestinationBounds.Min.X, InDestinationBounds.Max.Y),
+		FIntPoint(InDestinationBounds.Max.X, InDestinationBounds.Min.Y), InDestinationBounds.Max })
 	{
-		return InCombinedResult;
+		const FVector3f PatchUV = HeightmapToPatchUV.TransformPosition(FVector3f(Corner.X, Corner.Y, 0.f));
+		TileSpaceBounds += FVector2f(PatchUV.X * Resolution.X, PatchUV.Y * Resolution.Y) / TileSize;
 	}
 
-	FAutoPaintTexturePatchDispatchParams Params;
-	Params.CombinedResult = InCombinedResult;
-	Params.PatchTexture = PatchUObject;
+	const FIntPoint FirstTile(FMath::Max(FMath::FloorToInt(TileSpaceBounds.Min.X), 0), FMath::Max(FMath::FloorToInt(TileSpaceBounds.Min.Y), 0));
+	const FIntPoint LastTile(FMath::Min(FMath::FloorToInt(TileSpaceBounds.Max.X), TileCount.X - 1), FMath::Min(FMath::FloorToInt(TileSpaceBounds.Max.Y), TileCount.Y - 1));
 
-	FIntPoint SourceResolutionIn = FIntPoint(Patch->GetSizeX(), Patch->GetSizeY());
-	FIntPoint DestinationResolutionIn = FIntPoint(InCombinedResult->SizeX, InCombinedResult->SizeY);
-	
-	FTransform PatchToWorld;
-	GetCommonShaderParams(SourceResolutionIn, DestinationResolutionIn,
-		PatchToWorld, Params.PatchWorldDimensions, Params.HeightmapToPatch, 
-		Params.DestinationBounds, Params.EdgeUVDeadBorder, Params.FalloffWorldMargin);
+	for (int32 TileY = FirstTile.Y; TileY <= LastTile.Y; ++TileY)
+	{
+		for (int32 TileX = FirstTile.X; TileX <= LastTile.X; ++TileX)
+		{
+			const FIntPoint TileMin(TileX * TileSize, TileY * TileSize);
+			const FIntPoint TileMax(FMath::Min(TileMin.X + TileSize, Resolution.X), FMath::Min(TileMin.Y + TileSize, Resolution.Y));
+			const FVector2f UVMin(static_cast<float>(TileMin.X) / Resolution.X, static_cast<float>(TileMin.Y) / Resolution.Y);
+			const FVector2f UVMax(static_cast<float>(TileMax.X) / Resolution.X, static_cast<float>(TileMax.Y) / Resolution.Y);
+
+			// Destination pixels whose patch UV falls inside this tile, padded by a pixel for rounding
+			FBox2f TileHeightmapBounds(ForceInit);
+			for (const FVector2f& UV : { UVMin, FVector2f(UVMin.X, UVMax.Y), FVector2f(UVMax.X, UVMin.Y), UVMax })
+			{
+				const FVector3f HeightmapPosition = PatchUVToHeightmap.TransformPosition(FVector3f(UV.X, UV.Y, 0.f));
+				TileHeightmapBounds += FVector2f(HeightmapPosition.X, HeightmapPosition.Y);
+			}
+
+			FIntRect TileDestinationBounds(
+				FMath::FloorToInt(TileHeightmapBounds.Min.X) - 1, FMath::FloorToInt(TileHeightmapBounds.Min.Y) - 1,
+				FMath::CeilToInt(TileHeightmapBounds.Max.X) + 1, FMath::CeilToInt(TileHeightmapBounds.Max.Y) + 1);
+			TileDestinationBounds.Clip(InDestinationBounds);
+			if (TileDestinationBounds.IsEmpty())
+			{
+				continue;
+			}
+
+			UTexture* Tile = GetResidentTile(Asset->TextureTiles[TileY * TileCount.X + TileX]);
+			if (!Tile)
+			{
+				// @todo: Error
+				continue;
+			}
 
-	if (Params.DestinationBounds.IsEmpty())
+			const FVector2f TileUVSize = UVMax - UVMin;
+
+			FPatchTextureRegion& Region = OutRegions.AddDefaulted_GetRef();
+			Region.Texture = Tile;
+			Region.PatchUVToTextureUV = FVector4f(1.f / TileUVSize.X, 1.f / TileUVSize.Y, -UVMin.X / TileUVSize.X, -UVMin.Y / TileUVSize.Y);
+			Region.PatchUVBounds = FVector4f(UVMin.X, UVMin.Y, UVMax.X, UVMax.Y);
+			Region.DestinationBounds = TileDestinationBounds;
+		}
+	}
+
+	TrimResidentTiles(OutRegions.Num());
+}
+
+UTexture* UAutoPaintLandscapePatchComponent::GetResidentTile(const TSoftObjectPtr<UTexture>& InTile)
+{
+	const FSoftObjectPath TilePath = InTile.ToSoftObjectPath();
+	if (const TObjectPtr<UTexture>* ResidentTile = ResidentTiles.Find(TilePath))
 	{
-		// Patch must be outside the landscape.
-		return InCombinedResult;
+		ResidentTileOrder.Remove(TilePath);
+		ResidentTileOrder.Add(TilePath);
+		return *ResidentTile;
 	}
 
-	FAutoPaintTexturePatchWeightmapGPUInterface::Dispatch(Params);
-	
-	return InCombinedResult;
+	LLM_SCOPE_BYTAG(AutoPaint);
+	const TSharedPtr<FStreamableHandle>* Handle = TileHandles.Find(TilePath);
+	if (!Handle)
+	{
+		// Never blocks the landscape update on a package load, the tile is skipped until it is resident
+		RequestTileLoad(TilePath);
+		Handle = TileHandles.Find(TilePath);
+	}
+	if (!Handle || !(*Handle)->HasLoadCompleted())
+	{
+		return nullptr;
+	}
+
+	UTexture* Tile = Cast<UTexture>((*Handle)->GetLoadedAsset());
+	if (!IsValid(Tile))
+	{
+		return nullptr;
+	}
+
+#if WITH_EDITOR
+	if (Tile->IsCompiling())
+	{
+		// Freshly loaded tiles may still be building their platform data
+		FAutoPaintLandscapeUpdateScheduler::Get().RequestReapply(this, AutoPaintLandscapePatch::TileRetrySeconds);
+		return nullptr;
+	}
+#endif
+
+	if (!Tile->GetResource())
+	{
+		return nullptr;
+	}
+
+	ResidentTiles.Add(TilePath, Tile);
+	ResidentTileOrder.Add(TilePath);
+	return Tile;
+}
+
+void UAutoPaintLandscapePatchComponent::RequestTileLoad(const FSoftObjectPath& InTilePath)
+{
+	if (TileHandles.Contains(InTilePath))
+	{
+		return;
+	}
+
+	FStreamableManager& StreamableManager = UAssetManager::GetStreamableManager();
+	if (InTilePath.ResolveObject())
+	{
+		// Already in memory (e.g. open in an editor), only takes a handle so it stays loaded while this patch uses it
+		TileHandles.Add(InTilePath, StreamableManager.RequestSyncLoad(InTilePath));
+		return;
+	}
+
+	TSharedPtr<FStreamableHandle> Handle = StreamableManager.RequestAsyncLoad(InTilePath, FStreamableDelegate::CreateWeakLambda(this, [this, InTilePath]()
+	{
+		if (!InTilePath.ResolveObject())
+		{
+			UE_LOG(LogAutoPaintTerrain, Warning, TEXT("%s: failed to load tile %s"), *GetPathName(), *InTilePath.ToString());
+			// Retried by the next update that needs it
+			TileHandles.Remove(InTilePath);
+			return;
+		}
+
+		// Regions skipped while the tile was loading are only filled by another update
+		FAutoPaintLandscapeUpdateScheduler::Get().RequestReapply(this);
+	}));
+	if (Handle)
+	{
+		TileHandles.Add(InTilePath, MoveTemp(Handle));
+	}
+}
+
+void UAutoPaintLandscapePatchComponent::TrimResidentTiles(int32 InNumInUse)
+{
+	// Tiles in use were just touched, so they are at the back and never evicted
+	const int32 MaxTiles = FMath::Max(MaxResidentTiles, InNumInUse);
+	while (ResidentTileOrder.Num() > MaxTiles)
+	{
+		const FSoftObjectPath TilePath = ResidentTileOrder[0];
+		ResidentTileOrder.RemoveAt(0);
+		ResidentTiles.Remove(TilePath);
+
+		// Only this patch lets go, the tile unloads once no other patch, editor or handle references it
+		TSharedPtr<FStreamableHandle> Handle;
+		if (TileHandles.RemoveAndCopyValue(TilePath, Handle) && Handle)
+		{
+			Handle->ReleaseHandle();
+		}
+	}
+}
+
+FGuid UAutoPaintLandscapePatchComponent::GetPatchContentId(const UTexture* InTexture)
+{
+#if WITH_EDITORONLY_DATA
+	return FGuid::Combine(InTexture->GetLightingGuid(), InTexture->Source.GetId());
+#else
+	return InTexture->GetLightingGuid();
+#endif
+}
+
+void UAutoPaintLandscapePatchComponent::RequestLandscapeUpdate(bool bInUserTriggeredUpdate)
+{
+	if (!IsRegistered() || !GetDefault<UAutoPaintTerrainSettings>()->bCoalesceLandscapeUpdates)
+	{
+		// Registration changes must reach the landscape, whatever the inputs
+		IssueLandscapeUpdate(bInUserTriggeredUpdate);
+		return;
+	}
+
+	FAutoPaintLandscapeUpdateScheduler::Get().Request(this, bInUserTriggeredUpdate);
+}
+
+uint32 UAutoPaintLandscapePatchComponent::HashAssetInputs(const UAutoPaintData* InAsset, uint32 InHash)
+{
+	uint32 Hash = InHash;
+	if (!InAsset)
+	{
+		return Hash;
+	}
+
+	if (IsValid(InAsset->TextureAsset))
+	{
+		Hash = HashCombine(Hash, GetTypeHash(GetPatchContentId(InAsset->TextureAsset)));
+	}
+	for (const TSoftObjectPtr<UTexture>& Tile : InAsset->TextureTiles)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(Tile.ToSoftObjectPath()));
+	}
+	Hash = FCrc::MemCrc32(&InAsset->TextureWorldSize, sizeof(InAsset->TextureWorldSize), Hash);
+	Hash = FCrc::MemCrc32(&InAsset->WorldOffset, sizeof(InAsset->WorldOffset), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(InAsset->SceneCaptureResolution));
+	Hash = HashCombine(Hash, GetTypeHash(InAsset->Falloff));
+	Hash = HashCombine(Hash, GetTypeHash(InAsset->HeightWPO));
+	Hash = HashCombine(Hash, GetTypeHash(InAsset->UsesShapeFalloff()));
+	// FBox2D has padding after bIsValid, only the corners are hashed
+	Hash = HashCombine(Hash, HashCombine(GetTypeHash(InAsset->MaskUVBounds.Min), GetTypeHash(InAsset->MaskUVBounds.Max)));
+	if (IsValid(InAsset->SectionMaskTexture))
+	{
+		Hash = HashCombine(Hash, GetTypeHash(GetPatchContentId(InAsset->SectionMaskTexture)));
+	}
+	for (const FName& SectionMaskLayer : InAsset->SectionMaskLayers)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(SectionMaskLayer));
+	}
+	return Hash;
+}
+
+uint32 UAutoPaintLandscapePatchComponent::GetUpdateInputHash() const
+{
+	const FTransform PatchToWorld = GetPatchToWorldTransform();
+	const FVector3d Translation = PatchToWorld.GetTranslation();
+	const FQuat4d Rotation = PatchToWorld.GetRotation();
+	const FVector3d Scale = PatchToWorld.GetScale3D();
+
+	uint32 Hash = FCrc::MemCrc32(&Translation, sizeof(Translation));
+	Hash = FCrc::MemCrc32(&Rotation, sizeof(Rotation), Hash);
+	Hash = FCrc::MemCrc32(&Scale, sizeof(Scale), Hash);
+	Hash = HashCombine(Hash, GetTypeHash(PatchManager.Get()));
+	Hash = HashCombine(Hash, GetTypeHash(IsEnabled()));
+
+	Hash = HashCombine(Hash, GetTypeHash(Asset.ToSoftObjectPath()));
+	Hash = HashAssetInputs(Asset.Get(), Hash);
+
+	Hash = HashCombine(Hash, GetTypeHash(bAffectHeightmap));
+	for (const FName& WeightmapLayerName : AffectWeightmap)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(WeightmapLayerName));
+	}
+	for (const FAutoPaintDerivedWeightmap& DerivedWeightmap : DerivedWeightmaps)
+	{
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.LayerName));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.MinSlope));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.MaxSlope));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.SlopeTransition));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.bUseCurvature));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.MinCurvature));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.MaxCurvature));
+		Hash = HashCombine(Hash, GetTypeHash(DerivedWeightmap.CurvatureTransition));
+	}
+	return Hash;
+}
+
+bool UAutoPaintLandscapePatchComponent::ConsumeUpdateInputChange()
+{
+	const uint32 Hash = GetUpdateInputHash();
+	if (LastUpdateInputHash == Hash)
+	{
+		return false;
+	}
+
+	// The first update after load or registration isn't an interaction
+	if (LastUpdateInputHash.IsSet())
+	{
+		LastUpdateInputChangeTime = FPlatformTime::Seconds();
+	}
+	LastUpdateInputHash = Hash;
+	return true;
+}
+
+bool UAutoPaintLandscapePatchComponent::IsInteractive() const
+{
+	const UAutoPaintTerrainSettings* Settings = GetDefault<UAutoPaintTerrainSettings>();
+	return Settings->bCoalesceLandscapeUpdates && Settings->bInteractivePreview
+		&& FPlatformTime::Seconds() - LastUpdateInputChangeTime < Settings->PreviewIdleSeconds;
+}
+
+void UAutoPaintLandscapePatchComponent::IssueLandscapeUpdate(bool bInUserTriggeredUpdate)
+{
+	// Unregistered patches don't apply anymore, only their previous footprint needs updating
+	FUpdateFootprint Footprint;
+	if (IsRegistered() && IsEnabled())
+	{
+		Footprint.WorldBounds = GetPatchWorldBounds();
+		Footprint.bHeightmap = bAffectHeightmap;
+		// Visibility is stored in the weightmaps
+		Footprint.bWeightmap = !AffectWeightmap.IsEmpty() || AffectsVisibilityLayer();
+	}
+
+	ULandscapeInfo* LandscapeInfo = Landscape.IsValid() ? Landscape->GetLandscapeInfo() : nullptr;
+	if (!LandscapeInfo)
+	{
+		LastUpdateFootprint.Reset();
+		PendingFullUpdateFootprint.Reset();
+		Super::RequestLandscapeUpdate(bInUserTriggeredUpdate);
+		return;
+	}
+
+	FUpdateFootprint UpdateFootprint = Footprint;
+	if (LastUpdateFootprint.IsSet())
+	{
+		UpdateFootprint += *LastUpdateFootprint;
+	}
+	LastUpdateFootprint = Footprint;
+
+	if (bInUserTriggeredUpdate)
+	{
+		// The per component requests have no user triggered flag, the landscape has to know about undo, redo and edits
+		PendingFullUpdateFootprint.Reset();
+		Super::RequestLandscapeUpdate(bInUserTriggeredUpdate);
+		return;
+	}
+
+	// Collision, grass and the rest of the derived data only follow once the patch stops moving, then for the whole
+	// trail of the interactive updates since the last full one
+	const bool bUpdateAll = !IsInteractive();
+	if (bUpdateAll)
+	{
+		if (PendingFullUpdateFootprint.IsSet())
+		{
+			UpdateFootprint += *PendingFullUpdateFootprint;
+			PendingFullUpdateFootprint.Reset();
+		}
+	}
+	else if (PendingFullUpdateFootprint.IsSet())
+	{
+		*PendingFullUpdateFootprint += UpdateFootprint;
+	}
+	else
+	{
+		PendingFullUpdateFootprint = UpdateFootprint;
+	}
+
+	if (!UpdateFootprint.WorldBounds.IsValid || (!UpdateFootprint.bHeightmap && !UpdateFootprint.bWeightmap))
+	{
+		return;
+	}
+
+	const FBox2D UpdateArea(FVector2D(UpdateFootprint.WorldBounds.Min), FVector2D(UpdateFootprint.WorldBounds.Max));
+	LandscapeInfo->ForAllLandscapeComponents([&UpdateArea, &UpdateFootprint, bUpdateAll](ULandscapeComponent* LandscapeComponent)
+	{
+		const FBox ComponentBounds = LandscapeComponent->Bounds.GetBox();
+		if (!UpdateArea.Intersect(FBox2D(FVector2D(ComponentBounds.Min), FVector2D(ComponentBounds.Max))))
+		{
+			return;
+		}
+
+		if (UpdateFootprint.bHeightmap)
+		{
+			LandscapeComponent->RequestHeightmapUpdate(bUpdateAll);
+		}
+		if (UpdateFootprint.bWeightmap)
+		{
+			LandscapeComponent->RequestWeightmapUpdate(bUpdateAll);
+		}
+	});
+}
+
+FBox UAutoPaintLandscapePatchComponent::GetPatchWorldBounds() const
+{
+	return GetAssetWorldBounds(GetPatchToWorldTransform(), Asset.Get());
+}
+
+FBox UAutoPaintLandscapePatchComponent::GetAssetWorldBounds(const FTransform& InPatchToWorld, const UAutoPaintData* InAsset)
+{
+	if (!InAsset)
+	{
+		return FBox(ForceInit);
+	}
+
+	// Falloff is applied inside of the patch, it is only added as a safety margin for rounding to landscape vertices
+	const FBox2D UVBounds = InAsset->GetFalloffUVBounds();
+	const FVector2D Size = GetAssetUnscaledWorldSize(InAsset);
+	const FVector2D Min = (UVBounds.Min - 0.5) * Size - FVector2D(InAsset->Falloff);
+	const FVector2D Max = (UVBounds.Max - 0.5) * Size + FVector2D(InAsset->Falloff);
+	return FBox(FVector(Min.X, Min.Y, 0), FVector(Max.X, Max.Y, 0)).TransformBy(InPatchToWorld);
 }
 
 FTransform UAutoPaintLandscapePatchComponent::GetPatchToWorldTransform() const
 {
-	FTransform PatchToWorld = GetComponentTransform();
+	return AlignPatchToLandscape(GetComponentTransform(), Asset.Get());
+}
 
-	if (Asset)
+FTransform UAutoPaintLandscapePatchComponent::AlignPatchToLandscape(FTransform PatchToWorld, const UAutoPaintData* InAsset) const
+{
+	if (InAsset)
 	{
-		PatchToWorld.AddToTranslation(-Asset->WorldOffset);
+		PatchToWorld.AddToTranslation(-InAsset->WorldOffset);
 	}
 
 	if (Landscape.IsValid())
@@ -244,15 +822,20 @@ FTransform UAutoPaintLandscapePatchComponent::GetPatchToWorldTransform() const
 
 FVector2D UAutoPaintLandscapePatchComponent::GetFullUnscaledWorldSize() const
 {
-	if (!Asset)
+	return GetAssetUnscaledWorldSize(Asset.Get());
+}
+
+FVector2D UAutoPaintLandscapePatchComponent::GetAssetUnscaledWorldSize(const UAutoPaintData* InAsset)
+{
+	if (!InAsset)
 		return FVector2d::One();
 	
 	// FVector2D Resolution = GetResolution();
-	FVector2D Resolution = FVector2D(Asset->SceneCaptureResolution);
+	FVector2D Resolution = FVector2D(InAsset->SceneCaptureResolution);
 
 	// UnscaledPatchCoverage is meant to represent the distance between the centers of the extremal pixels.
 	// That distance in pixels is Resolution-1.
-	FVector2d UnscaledPatchCoverage = Asset->TextureWorldSize;
+	FVector2d UnscaledPatchCoverage = InAsset->TextureWorldSize;
 	FVector2D TargetPixelSize(UnscaledPatchCoverage / FVector2D::Max(Resolution - 1, FVector2D(1, 1)));
 	return TargetPixelSize * Resolution;
 }
@@ -261,6 +844,8 @@ void UAutoPaintLandscapePatchComponent::GetCommonShaderParams(const FIntPoint& S
 	FTransform& PatchToWorldOut, FVector2f& PatchWorldDimensionsOut, FMatrix44f& HeightmapToPatchOut, FIntRect& DestinationBoundsOut, 
 	FVector2f& EdgeUVDeadBorderOut, float& FalloffWorldMarginOut) const
 {
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_GetCommonShaderParams);
+
 	PatchToWorldOut = GetPatchToWorldTransform();
 
 	FVector2D FullPatchDimensions = GetFullUnscaledWorldSize();
@@ -290,11 +875,13 @@ void UAutoPaintLandscapePatchComponent::GetCommonShaderParams(const FIntPoint& S
 		FVector HeightmapCoordinates = LandscapeHeightmapToWorld.InverseTransformPosition(WorldPosition);
 		return FVector2d(HeightmapCoordinates.X, HeightmapCoordinates.Y);
 	};
+	// With shape falloff nothing outside of the mask rect is touched
+	const FBox2f UVBounds = FBox2f(Asset ? Asset->GetFalloffUVBounds() : FBox2D(FVector2D::ZeroVector, FVector2D::UnitVector));
 	FBox2D FloatBounds(ForceInit);
-	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(0, 0));
-	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(0, 1));
-	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(1, 0));
-	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(1, 1));
+	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(UVBounds.Min.X, UVBounds.Min.Y));
+	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(UVBounds.Min.X, UVBounds.Max.Y));
+	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(UVBounds.Max.X, UVBounds.Min.Y));
+	FloatBounds += PatchUVToHeightmap2DCoordinates(FVector2f(UVBounds.Max.X, UVBounds.Max.Y));
 
 	DestinationBoundsOut = FIntRect(
 		FMath::Clamp(FMath::Floor(FloatBounds.Min.X), 0, DestinationResolutionIn.X - 1),
@@ -0,0 +1,157 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintLandscapeUpdateScheduler.h"
+
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintStats.h"
+#include "AutoPaintTerrainSettings.h"
+#include "Misc/CoreDelegates.h"
+
+DECLARE_CYCLE_STAT(TEXT("Landscape Update Scheduler"), STAT_AutoPaint_LandscapeUpdateScheduler, STATGROUP_AutoPaint);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pending Landscape Updates"), STAT_AutoPaint_PendingLandscapeUpdates, STATGROUP_AutoPaint);
+
+TUniquePtr<FAutoPaintLandscapeUpdateScheduler> FAutoPaintLandscapeUpdateScheduler::Instance;
+
+FAutoPaintLandscapeUpdateScheduler& FAutoPaintLandscapeUpdateScheduler::Get()
+{
+	if (!Instance)
+	{
+		Instance = MakeUnique<FAutoPaintLandscapeUpdateScheduler>();
+	}
+	return *Instance;
+}
+
+void FAutoPaintLandscapeUpdateScheduler::Shutdown()
+{
+	Instance.Reset();
+}
+
+FAutoPaintLandscapeUpdateScheduler::FAutoPaintLandscapeUpdateScheduler()
+{
+	FCoreDelegates::OnEndFrame.AddRaw(this, &FAutoPaintLandscapeUpdateScheduler::OnEndFrame);
+}
+
+FAutoPaintLandscapeUpdateScheduler::~FAutoPaintLandscapeUpdateScheduler()
+{
+	FCoreDelegates::OnEndFrame.RemoveAll(this);
+}
+
+TStatId FAutoPaintLandscapeUpdateScheduler::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(FAutoPaintLandscapeUpdateScheduler, STATGROUP_Tickables);
+}
+
+void FAutoPaintLandscapeUpdateScheduler::Request(UAutoPaintLandscapePatchComponent* InPatch, bool bInUserTriggeredUpdate)
+{
+	FPendingPatch* Pending = PendingPatches.FindByPredicate([InPatch](const FPendingPatch& Other) { return Other.Patch == InPatch; });
+	if (Pending)
+	{
+		Pending->bUserTriggeredUpdate |= bInUserTriggeredUpdate;
+		return;
+	}
+
+	PendingPatches.Add({ InPatch, bInUserTriggeredUpdate });
+}
+
+void FAutoPaintLandscapeUpdateScheduler::RequestRefine(UAutoPaintLandscapePatchComponent* InPatch)
+{
+	PreviewPatches.AddUnique(InPatch);
+}
+
+void FAutoPaintLandscapeUpdateScheduler::RequestReapply(UAutoPaintLandscapePatchComponent* InPatch, double InDelaySeconds)
+{
+	const double ExecuteTime = FPlatformTime::Seconds() + InDelaySeconds;
+	FReapplyPatch* Reapply = ReapplyPatches.FindByPredicate([InPatch](const FReapplyPatch& Other) { return Other.Patch == InPatch; });
+	if (Reapply)
+	{
+		// A patch still being dragged keeps pushing its settle update back
+		Reapply->ExecuteTime = ExecuteTime;
+		return;
+	}
+
+	ReapplyPatches.Add({ InPatch, ExecuteTime });
+}
+
+void FAutoPaintLandscapeUpdateScheduler::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_LandscapeUpdateScheduler);
+	CSV_SCOPED_TIMING_STAT(AutoPaint, LandscapeUpdateScheduler);
+	SET_DWORD_STAT(STAT_AutoPaint_PendingLandscapeUpdates, PendingPatches.Num());
+
+	if (!UpdateFence.IsFenceComplete())
+	{
+		// Previous update is still rendering, keep collecting
+		return;
+	}
+
+	const double EndTime = FPlatformTime::Seconds() + GetDefault<UAutoPaintTerrainSettings>()->LandscapeUpdateBudgetMs / 1000.0;
+
+	// Every patch only updates the landscape components under its old and new footprint
+	int32 NumIssued = 0;
+	int32 NumProcessed = 0;
+	for (; NumProcessed < PendingPatches.Num(); ++NumProcessed)
+	{
+		if (NumProcessed > 0 && FPlatformTime::Seconds() > EndTime)
+		{
+			break;
+		}
+
+		const FPendingPatch& Pending = PendingPatches[NumProcessed];
+		UAutoPaintLandscapePatchComponent* Patch = Pending.Patch.Get();
+		if (!Patch || !Patch->ConsumeUpdateInputChange())
+		{
+			// Gone, or same inputs as the last update
+			continue;
+		}
+
+		Patch->IssueLandscapeUpdate(Pending.bUserTriggeredUpdate);
+		++NumIssued;
+	}
+	PendingPatches.RemoveAt(0, NumProcessed);
+
+	for (int32 Index = PreviewPatches.Num() - 1; Index >= 0; --Index)
+	{
+		UAutoPaintLandscapePatchComponent* Patch = PreviewPatches[Index].Get();
+		if (Patch && Patch->IsInteractive())
+		{
+			continue;
+		}
+		PreviewPatches.RemoveAtSwap(Index);
+
+		if (Patch)
+		{
+			Patch->IssueLandscapeUpdate(/*bInUserTriggeredUpdate = */false);
+			++NumIssued;
+		}
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	for (int32 Index = ReapplyPatches.Num() - 1; Index >= 0; --Index)
+	{
+		UAutoPaintLandscapePatchComponent* Patch = ReapplyPatches[Index].Patch.Get();
+		if (Patch && ReapplyPatches[Index].ExecuteTime > Now)
+		{
+			continue;
+		}
+		ReapplyPatches.RemoveAtSwap(Index);
+
+		if (Patch && Patch->IsRegistered())
+		{
+			Patch->IssueLandscapeUpdate(/*bInUserTriggeredUpdate = */false);
+			++NumIssued;
+		}
+	}
+
+	bIssuedThisFrame |= NumIssued > 0;
+}
+
+void FAutoPaintLandscapeUpdateScheduler::OnEndFrame()
+{
+	if (bIssuedThisFrame)
+	{
+		// The landscape ticked after us, so its render commands for the update are queued by now
+		UpdateFence.BeginFence(/*bSyncToRHIAndGPU = */true);
+		bIssuedThisFrame = false;
+	}
+}
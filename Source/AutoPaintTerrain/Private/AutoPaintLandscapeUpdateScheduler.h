@@ -0,0 +1,71 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "RenderCommandFence.h"
+#include "TickableEditorObject.h"
+
+class UAutoPaintLandscapePatchComponent;
+
+/**
+ * Coalesces landscape update requests of AutoPaint patches. Requests only mark the patch pending, once per frame
+ * the pending patches are evaluated within the budget of UAutoPaintTerrainSettings and issue their update,
+ * skipping patches whose inputs hash the same as the last update. No update is issued while the
+ * previous one is still rendering, so intermediate states of a drag are dropped instead of queued.
+ */
+class FAutoPaintLandscapeUpdateScheduler : public FTickableEditorObject
+{
+public:
+	static FAutoPaintLandscapeUpdateScheduler& Get();
+	static void Shutdown();
+
+	FAutoPaintLandscapeUpdateScheduler();
+	virtual ~FAutoPaintLandscapeUpdateScheduler() override;
+
+	//~ Begin FTickableEditorObject Interface
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override { return PendingPatches.Num() > 0 || PreviewPatches.Num() > 0 || ReapplyPatches.Num() > 0; }
+	virtual ETickableTickType GetTickableTickType() const override { return ETickableTickType::Conditional; }
+	virtual TStatId GetStatId() const override;
+	//~ End FTickableEditorObject Interface
+
+	void Request(UAutoPaintLandscapePatchComponent* InPatch, bool bInUserTriggeredUpdate);
+
+	/** The patch was applied as an interactive preview, updates its landscape again once the patch stops being interactive */
+	void RequestRefine(UAutoPaintLandscapePatchComponent* InPatch);
+
+	/**
+	 * Updates the landscape of the patch again after InDelaySeconds although its inputs didn't change, e.g. once its
+	 * tiles are resident or it settled into the precomposite. A pending reapply of the patch is moved to the new time.
+	 */
+	void RequestReapply(UAutoPaintLandscapePatchComponent* InPatch, double InDelaySeconds = 0.0);
+
+private:
+	void OnEndFrame();
+
+	struct FPendingPatch
+	{
+		TWeakObjectPtr<UAutoPaintLandscapePatchComponent> Patch;
+		bool bUserTriggeredUpdate = false;
+	};
+	/** In request order */
+	TArray<FPendingPatch> PendingPatches;
+
+	/** Rendered as a preview, waiting for the full resolution update */
+	TArray<TWeakObjectPtr<UAutoPaintLandscapePatchComponent>> PreviewPatches;
+
+	struct FReapplyPatch
+	{
+		TWeakObjectPtr<UAutoPaintLandscapePatchComponent> Patch;
+		/** FPlatformTime::Seconds() after which the update is issued */
+		double ExecuteTime = 0.0;
+	};
+	TArray<FReapplyPatch> ReapplyPatches;
+
+	/** Covers the landscape work of the frame the last update was issued in */
+	FRenderCommandFence UpdateFence;
+	bool bIssuedThisFrame = false;
+
+	static TUniquePtr<FAutoPaintLandscapeUpdateScheduler> Instance;
+};
@@ -0,0 +1,295 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintPatchCompositeCache.h"
+
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintPatchCompositePS.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "AutoPaintLandscapeUpdateScheduler.h"
+#include "AutoPaintStats.h"
+#include "LandscapePatchManager.h"
+#include "Engine/TextureRenderTarget2D.h"
+#include "UObject/UObjectIterator.h"
+
+DECLARE_CYCLE_STAT(TEXT("Composite Begin Pass"), STAT_AutoPaint_CompositeBeginPass, STATGROUP_AutoPaint);
+DECLARE_CYCLE_STAT(TEXT("Composite Dispatch"), STAT_AutoPaint_CompositeDispatch, STATGROUP_AutoPaint);
+
+TUniquePtr<FAutoPaintPatchCompositeCache> FAutoPaintPatchCompositeCache::Instance;
+
+FAutoPaintPatchCompositeCache& FAutoPaintPatchCompositeCache::Get()
+{
+	if (!Instance)
+	{
+		Instance = MakeUnique<FAutoPaintPatchCompositeCache>();
+	}
+	return *Instance;
+}
+
+void FAutoPaintPatchCompositeCache::Shutdown()
+{
+	Instance.Reset();
+}
+
+void FAutoPaintPatchCompositeCache::GatherMemory(TArray<FAutoPaintMemoryEntry>& OutEntries)
+{
+	if (!Instance)
+	{
+		return;
+	}
+
+	for (const TPair<TObjectKey<ALandscapePatchManager>, FComposite>& Pair : Instance->Composites)
+	{
+		const ALandscapePatchManager* PatchManager = Pair.Key.ResolveObjectPtr();
+		OutEntries.Add({ TEXT("Landscape"), FString::Printf(TEXT("Precomposite %s"), PatchManager ? *PatchManager->GetActorNameOrLabel() : TEXT("(removed)")),
+			AutoPaintMemory::GetTextureBytes(Pair.Value.Target) });
+	}
+}
+
+void FAutoPaintPatchCompositeCache::AddReferencedObjects(FReferenceCollector& Collector)
+{
+	for (TPair<TObjectKey<ALandscapePatchManager>, FComposite>& Pair : Composites)
+	{
+		Collector.AddReferencedObject(Pair.Value.Target);
+	}
+}
+
+bool FAutoPaintPatchCompositeCache::ApplyToHeightmap(UAutoPaintLandscapePatchComponent* InPatch, ALandscapePatchManager* InPatchManager, UTextureRenderTarget2D* InCombinedResult)
+{
+	if (!InPatch->CanPrecomposite() || !InPatchManager)
+	{
+		return false;
+	}
+
+	for (auto It = Composites.CreateIterator(); It; ++It)
+	{
+		if (!It.Key().ResolveObjectPtr())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	FComposite& Composite = Composites.FindOrAdd(InPatchManager);
+	const FPatchKey PatchKey(InPatch);
+
+	// Patches are rendered in order once per pass, seeing one again means the landscape started over
+	if (Composite.PassFrame != GFrameCounter || Composite.PassTarget != InCombinedResult || Composite.PassVisited.Contains(PatchKey))
+	{
+		BeginPass(Composite, InPatchManager, InCombinedResult);
+	}
+	Composite.PassVisited.Add(PatchKey);
+
+	const FPatchState* State = Composite.Patches.Find(PatchKey);
+	if (!State || !State->bInComposite)
+	{
+		return false;
+	}
+
+	if (Composite.Members[0] == PatchKey)
+	{
+		// The whole composite is charged to the patch applying it
+		FAutoPaintPatchCostTracker::Get().AddPixels(InPatch, DispatchComposite(Composite, InCombinedResult));
+	}
+	return true;
+}
+
+void FAutoPaintPatchCompositeCache::BeginPass(FComposite& Composite, ALandscapePatchManager* InPatchManager, UTextureRenderTarget2D* InCombinedResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CompositeBeginPass);
+
+	Composite.PassFrame = GFrameCounter;
+	Composite.PassTarget = InCombinedResult;
+	Composite.PassVisited.Reset();
+
+	const double Now = FPlatformTime::Seconds();
+	const FIntPoint Resolution(InCombinedResult->SizeX, InCombinedResult->SizeY);
+	const FIntRect FullBounds(FIntPoint::ZeroValue, Resolution);
+
+	if (!Composite.Target || Composite.Target->SizeX != Resolution.X || Composite.Target->SizeY != Resolution.Y)
+	{
+		LLM_SCOPE_BYTAG(AutoPaint);
+
+		if (!Composite.Target)
+		{
+			Composite.Target = NewObject<UTextureRenderTarget2D>(GetTransientPackage(), NAME_None, RF_Transient);
+			Composite.Target->ClearColor = FLinearColor::Transparent;
+		}
+		Composite.Target->InitCustomFormat(Resolution.X, Resolution.Y, PF_G32R32F, /*bInForceLinearGamma = */true);
+
+		Composite.NumRegions = FIntPoint(FMath::DivideAndRoundUp(Resolution.X, RegionSize), FMath::DivideAndRoundUp(Resolution.Y, RegionSize));
+		Composite.DirtyRegions.Init(true, Composite.NumRegions.X * Composite.NumRegions.Y);
+	}
+
+	// Every patch of the landscape in application order, including ones AutoPaint knows nothing about
+	struct FOrderedPatch
+	{
+		ULandscapePatchComponent* Patch;
+		int32 Index;
+	};
+	TArray<FOrderedPatch> OrderedPatches;
+	for (ULandscapePatchComponent* Patch : TObjectRange<ULandscapePatchComponent>())
+	{
+		if (Patch->GetWorld() != InPatchManager->GetWorld() || Patch->GetPatchManager() != InPatchManager || !Patch->IsEnabled())
+		{
+			continue;
+		}
+
+		const int32 Index = InPatchManager->GetIndexOfPatch(Patch);
+		if (Index != INDEX_NONE)
+		{
+			OrderedPatches.Add({ Patch, Index });
+		}
+	}
+	OrderedPatches.Sort([](const FOrderedPatch& A, const FOrderedPatch& B) { return A.Index < B.Index; });
+
+	TMap<FPatchKey, FPatchState> PreviousStates = MoveTemp(Composite.Patches);
+	Composite.Patches.Reset();
+	Composite.Members.Reset();
+	Composite.ApplyBounds = FIntRect();
+
+	// Pixels written by patches applied on their own. A patch after one of them can't join the composite
+	// where they overlap, because the composite is applied earlier, at the position of its first patch.
+	TArray<FIntRect> IndividualBounds;
+	auto OverlapsIndividual = [&IndividualBounds](const FIntRect& Bounds)
+	{
+		return IndividualBounds.ContainsByPredicate([&Bounds](const FIntRect& Other) { return Bounds.Intersect(Other); });
+	};
+
+	for (const FOrderedPatch& OrderedPatch : OrderedPatches)
+	{
+		UAutoPaintLandscapePatchComponent* Patch = Cast<UAutoPaintLandscapePatchComponent>(OrderedPatch.Patch);
+		if (Patch && !Patch->bAffectHeightmap)
+		{
+			continue;
+		}
+		if (!Patch || !Patch->CanPrecomposite())
+		{
+			// Unknown footprint
+			IndividualBounds.Add(FullBounds);
+			continue;
+		}
+
+		const FPatchKey PatchKey(Patch);
+
+		FAutoPaintTexturePatchProxyPtr Proxy = Patch->GetHeightmapProxy(InCombinedResult);
+		const uint32 Hash = Proxy->InputHash;
+		const FIntRect Bounds = Proxy->DestinationBounds;
+
+		// Patches seen for the first time count as settled, so a freshly loaded landscape starts composited
+		FPatchState State;
+		if (!PreviousStates.RemoveAndCopyValue(PatchKey, State))
+		{
+			State.Hash = Hash;
+		}
+		else if (State.Hash != Hash)
+		{
+			State.Hash = Hash;
+			State.LastChangeTime = Now;
+		}
+
+		const bool bWasInComposite = State.bInComposite;
+		const bool bSettled = Now - State.LastChangeTime >= SettleSeconds;
+		State.bInComposite = bSettled && !Bounds.IsEmpty() && !OverlapsIndividual(Bounds);
+
+		if (!bSettled && !Bounds.IsEmpty())
+		{
+			// Nothing else may update the landscape once the patch stops changing, ask for the update that lets it join
+			FAutoPaintLandscapeUpdateScheduler::Get().RequestReapply(Patch, SettleSeconds - (Now - State.LastChangeTime));
+		}
+
+		if (State.bInComposite != bWasInComposite)
+		{
+			MarkDirty(Composite, bWasInComposite ? State.Bounds : Bounds);
+		}
+
+		if (State.bInComposite)
+		{
+			Composite.Members.Add(PatchKey);
+			if (Composite.ApplyBounds.IsEmpty())
+			{
+				Composite.ApplyBounds = Bounds;
+			}
+			else
+			{
+				Composite.ApplyBounds.Union(Bounds);
+			}
+		}
+		else if (!Bounds.IsEmpty())
+		{
+			IndividualBounds.Add(Bounds);
+		}
+
+		State.Bounds = Bounds;
+		State.Proxy = MoveTemp(Proxy);
+		Composite.Patches.Add(PatchKey, MoveTemp(State));
+	}
+
+	// Removed or disabled patches
+	for (const TPair<FPatchKey, FPatchState>& Pair : PreviousStates)
+	{
+		if (Pair.Value.bInComposite)
+		{
+			MarkDirty(Composite, Pair.Value.Bounds);
+		}
+	}
+}
+
+void FAutoPaintPatchCompositeCache::MarkDirty(FComposite& Composite, const FIntRect& InBounds) const
+{
+	if (InBounds.IsEmpty())
+	{
+		return;
+	}
+
+	const FIntPoint FirstRegion = InBounds.Min / RegionSize;
+	const FIntPoint LastRegion = (InBounds.Max - FIntPoint(1, 1)) / RegionSize;
+	for (int32 RegionY = FirstRegion.Y; RegionY <= FMath::Min(LastRegion.Y, Composite.NumRegions.Y - 1); ++RegionY)
+	{
+		for (int32 RegionX = FirstRegion.X; RegionX <= FMath::Min(LastRegion.X, Composite.NumRegions.X - 1); ++RegionX)
+		{
+			Composite.DirtyRegions[RegionY * Composite.NumRegions.X + RegionX] = true;
+		}
+	}
+}
+
+int64 FAutoPaintPatchCompositeCache::DispatchComposite(FComposite& Composite, UTextureRenderTarget2D* InCombinedResult)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_CompositeDispatch);
+
+	FAutoPaintPatchCompositeDispatchParams Params;
+	Params.Composite = Composite.Target->GetResource();
+	Params.CombinedResult = InCombinedResult->GetResource();
+	Params.ApplyBounds = Composite.ApplyBounds;
+
+	int64 Pixels = Params.ApplyBounds.Area();
+
+	const FIntRect FullBounds(0, 0, Composite.Target->SizeX, Composite.Target->SizeY);
+	for (TConstSetBitIterator<> It(Composite.DirtyRegions); It; ++It)
+	{
+		const FIntPoint RegionMin(It.GetIndex() % Composite.NumRegions.X * RegionSize, It.GetIndex() / Composite.NumRegions.X * RegionSize);
+		FIntRect Region(RegionMin, RegionMin + FIntPoint(RegionSize, RegionSize));
+		Region.Clip(FullBounds);
+		Params.ClearRegions.Add(Region);
+
+		// Every member is accumulated again in order, clipped to the region so clean regions aren't blended twice
+		for (const FPatchKey& Member : Composite.Members)
+		{
+			for (const FAutoPaintTexturePatchDispatchParams& MemberParams : Composite.Patches[Member].Proxy->Regions)
+			{
+				FIntRect Bounds = MemberParams.DestinationBounds;
+				Bounds.Clip(Region);
+				if (!Bounds.IsEmpty())
+				{
+					FAutoPaintTexturePatchDispatchParams& RegionParams = Params.Patches.Add_GetRef(MemberParams);
+					RegionParams.DestinationBounds = Bounds;
+					Pixels += Bounds.Area();
+				}
+			}
+		}
+	}
+	Composite.DirtyRegions.SetRange(0, Composite.DirtyRegions.Num(), false);
+
+	FAutoPaintPatchCompositeGPUInterface::Dispatch(Params);
+
+	return Pixels;
+}
@@ -0,0 +1,84 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintMemory.h"
+#include "AutoPaintTexturePatchPS.h"
+#include "UObject/GCObject.h"
+#include "UObject/ObjectKey.h"
+
+class ALandscapePatchManager;
+class UAutoPaintLandscapePatchComponent;
+class UTextureRenderTarget2D;
+
+/**
+ * Per landscape precomposite of the AutoPaint height patches that haven't changed for SettleSeconds.
+ * Their contribution is kept at landscape resolution as premultiplied height plus alpha and re-applied in
+ * a single blend at the position of the first of them, only patches being edited are applied on their own.
+ * The composite is rebuilt per RegionSize square when a patch inside it changes, joins or leaves. A patch that
+ * hasn't settled yet has the update scheduler reapply it after SettleSeconds, so it joins without waiting for another edit.
+ */
+class FAutoPaintPatchCompositeCache : public FGCObject
+{
+public:
+	static constexpr double SettleSeconds = 0.5;
+	static constexpr int32 RegionSize = 256;
+
+	static FAutoPaintPatchCompositeCache& Get();
+	static void Shutdown();
+
+	/** Composite target of every landscape, for AutoPaintMemory */
+	static void GatherMemory(TArray<FAutoPaintMemoryEntry>& OutEntries);
+
+	//~ Begin FGCObject Interface
+	virtual void AddReferencedObjects(FReferenceCollector& Collector) override;
+	virtual FString GetReferencerName() const override { return TEXT("FAutoPaintPatchCompositeCache"); }
+	//~ End FGCObject Interface
+
+	/**
+	 * Called in place of applying the patch to the heightmap. Returns true when the patch is part of the composite,
+	 * which is then applied by its first patch, false when the caller has to apply the patch itself.
+	 */
+	bool ApplyToHeightmap(UAutoPaintLandscapePatchComponent* InPatch, ALandscapePatchManager* InPatchManager, UTextureRenderTarget2D* InCombinedResult);
+
+private:
+	using FPatchKey = TObjectKey<UAutoPaintLandscapePatchComponent>;
+
+	struct FPatchState
+	{
+		uint32 Hash = 0;
+		double LastChangeTime = 0.0;
+		FIntRect Bounds;
+		FAutoPaintTexturePatchProxyPtr Proxy;
+		bool bInComposite = false;
+	};
+
+	struct FComposite
+	{
+		/** RG32F at landscape resolution */
+		TObjectPtr<UTextureRenderTarget2D> Target;
+		FIntPoint NumRegions = FIntPoint::ZeroValue;
+		TBitArray<> DirtyRegions;
+
+		TMap<FPatchKey, FPatchState> Patches;
+		/** Patches in the composite, in application order */
+		TArray<FPatchKey> Members;
+		FIntRect ApplyBounds;
+
+		/** Identifies the landscape render pass the state was gathered for */
+		uint64 PassFrame = MAX_uint64;
+		const UTextureRenderTarget2D* PassTarget = nullptr;
+		TSet<FPatchKey> PassVisited;
+	};
+
+	/** Gathers every patch of the manager in order and updates composite membership and dirty regions */
+	void BeginPass(FComposite& Composite, ALandscapePatchManager* InPatchManager, UTextureRenderTarget2D* InCombinedResult);
+	void MarkDirty(FComposite& Composite, const FIntRect& InBounds) const;
+	/** Rebuilds the dirty regions and blends the composite over the heightmap, returns the number of pixels written */
+	int64 DispatchComposite(FComposite& Composite, UTextureRenderTarget2D* InCombinedResult);
+
+	TMap<TObjectKey<ALandscapePatchManager>, FComposite> Composites;
+
+	static TUniquePtr<FAutoPaintPatchCompositeCache> Instance;
+};
@@ -0,0 +1,89 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintPatchCostTracker.h"
+
+#include "LandscapePatchComponent.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY(LogAutoPaintTerrain);
+
+TUniquePtr<FAutoPaintPatchCostTracker> FAutoPaintPatchCostTracker::Instance;
+
+static FAutoConsoleCommand GAutoPaintDumpPatchCostsCommand(
+	TEXT("AutoPaint.DumpPatchCosts"),
+	TEXT("Logs the most expensive AutoPaint patches of the last landscape update. Optional argument: number of patches, 10 by default."),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 MaxPatches = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 10;
+		FAutoPaintPatchCostTracker::Get().Dump(MaxPatches > 0 ? MaxPatches : 10);
+	}));
+
+FAutoPaintPatchCostTracker& FAutoPaintPatchCostTracker::Get()
+{
+	if (!Instance)
+	{
+		Instance = MakeUnique<FAutoPaintPatchCostTracker>();
+	}
+	return *Instance;
+}
+
+void FAutoPaintPatchCostTracker::Shutdown()
+{
+	Instance.Reset();
+}
+
+void FAutoPaintPatchCostTracker::AddRender(const ULandscapePatchComponent* InPatch, double InSeconds)
+{
+	FPatchCost& Cost = FindOrAdd(InPatch);
+	Cost.Seconds += InSeconds;
+	++Cost.NumRenders;
+}
+
+void FAutoPaintPatchCostTracker::AddPixels(const ULandscapePatchComponent* InPatch, int64 InPixels)
+{
+	FindOrAdd(InPatch).Pixels += InPixels;
+}
+
+FAutoPaintPatchCostTracker::FPatchCost& FAutoPaintPatchCostTracker::FindOrAdd(const ULandscapePatchComponent* InPatch)
+{
+	if (Frame != GFrameCounter)
+	{
+		Frame = GFrameCounter;
+		Costs.Reset();
+	}
+
+	FPatchCost& Cost = Costs.FindOrAdd(InPatch);
+	if (Cost.Name.IsEmpty())
+	{
+		const AActor* Owner = InPatch->GetOwner();
+		Cost.Name = Owner ? FString::Printf(TEXT("%s.%s"), *Owner->GetActorNameOrLabel(), *InPatch->GetName()) : InPatch->GetName();
+	}
+	return Cost;
+}
+
+void FAutoPaintPatchCostTracker::Dump(int32 InMaxPatches) const
+{
+	if (Costs.IsEmpty())
+	{
+		UE_LOG(LogAutoPaintTerrain, Display, TEXT("No AutoPaint patch rendered yet"));
+		return;
+	}
+
+	TArray<const FPatchCost*> Sorted;
+	double TotalSeconds = 0.0;
+	for (const TPair<TObjectKey<ULandscapePatchComponent>, FPatchCost>& Pair : Costs)
+	{
+		Sorted.Add(&Pair.Value);
+		TotalSeconds += Pair.Value.Seconds;
+	}
+	Sorted.Sort([](const FPatchCost& A, const FPatchCost& B) { return A.Seconds > B.Seconds; });
+
+	UE_LOG(LogAutoPaintTerrain, Display, TEXT("AutoPaint patch costs of frame %llu: %d patches, %.3f ms"), Frame, Sorted.Num(), TotalSeconds * 1000.0);
+	for (int32 Index = 0; Index < FMath::Min(InMaxPatches, Sorted.Num()); ++Index)
+	{
+		const FPatchCost& Cost = *Sorted[Index];
+		UE_LOG(LogAutoPaintTerrain, Display, TEXT("  %.3f ms, %d renders, %.2f Mpx: %s"),
+			Cost.Seconds * 1000.0, Cost.NumRenders, Cost.Pixels / 1.0e6, *Cost.Name);
+	}
+}
@@ -0,0 +1,45 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+class ULandscapePatchComponent;
+
+DECLARE_LOG_CATEGORY_EXTERN(LogAutoPaintTerrain, Log, All);
+
+/**
+ * Game thread cost of every patch in the most recent landscape update, dumped with AutoPaint.DumpPatchCosts.
+ * Costs are reset when the first patch of a new frame renders, so the dump always shows the last frame that rendered patches.
+ */
+class FAutoPaintPatchCostTracker
+{
+public:
+	static FAutoPaintPatchCostTracker& Get();
+	static void Shutdown();
+
+	/** One RenderLayer_Native call of the patch */
+	void AddRender(const ULandscapePatchComponent* InPatch, double InSeconds);
+	/** Destination pixels the patch dispatched, the GPU cost roughly follows them */
+	void AddPixels(const ULandscapePatchComponent* InPatch, int64 InPixels);
+
+	/** Logs the InMaxPatches most expensive patches */
+	void Dump(int32 InMaxPatches) const;
+
+private:
+	struct FPatchCost
+	{
+		FString Name;
+		double Seconds = 0.0;
+		int32 NumRenders = 0;
+		int64 Pixels = 0;
+	};
+
+	FPatchCost& FindOrAdd(const ULandscapePatchComponent* InPatch);
+
+	uint64 Frame = MAX_uint64;
+	TMap<TObjectKey<ULandscapePatchComponent>, FPatchCost> Costs;
+
+	static TUniquePtr<FAutoPaintPatchCostTracker> Instance;
+};
@@ -0,0 +1,65 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintPoissonScatter.h"
+
+#include "Math/RandomStream.h"
+
+void FAutoPaintPoissonScatter::Sample(const FBox2D& InRegion, double InMinDistance, int32 InNumCandidates, int32 InSeed,
+	TFunctionRef<bool(const FVector2D&)> InFilter, TArray<FVector2D>& OutPoints)
+{
+	if (!InRegion.bIsValid || InMinDistance <= 0 || InNumCandidates <= 0)
+	{
+		return;
+	}
+
+	// The cell diagonal is the minimum distance, two kept points can't share a cell
+	const double CellSize = InMinDistance / UE_DOUBLE_SQRT_2;
+	const double MinDistanceSquared = InMinDistance * InMinDistance;
+	const FVector2D RegionSize = InRegion.GetSize();
+
+	auto GetCell = [&InRegion, CellSize](const FVector2D& Point)
+	{
+		return FIntPoint(FMath::FloorToInt((Point.X - InRegion.Min.X) / CellSize), FMath::FloorToInt((Point.Y - InRegion.Min.Y) / CellSize));
+	};
+
+	// Cell to index in OutPoints
+	TMap<FIntPoint, int32> SpatialHash;
+	SpatialHash.Reserve(FMath::Min<int64>(InNumCandidates, FMath::CeilToInt64(RegionSize.X * RegionSize.Y / MinDistanceSquared)));
+
+	FRandomStream RandomStream(InSeed);
+	for (int32 Candidate = 0; Candidate < InNumCandidates; ++Candidate)
+	{
+		const FVector2D Point = InRegion.Min + FVector2D(RandomStream.GetFraction(), RandomStream.GetFraction()) * RegionSize;
+		if (!InFilter(Point))
+		{
+			continue;
+		}
+
+		const FIntPoint Cell = GetCell(Point);
+		bool bTooClose = false;
+		for (int32 OffsetY = -2; OffsetY <= 2 && !bTooClose; ++OffsetY)
+		{
+			for (int32 OffsetX = -2; OffsetX <= 2; ++OffsetX)
+			{
+				// Corner cells are always further than the minimum distance
+				if (FMath::Abs(OffsetX) == 2 && FMath::Abs(OffsetY) == 2)
+				{
+					continue;
+				}
+
+				const int32* Neighbor = SpatialHash.Find(Cell + FIntPoint(OffsetX, OffsetY));
+				if (Neighbor && FVector2D::DistSquared(OutPoints[*Neighbor], Point) < MinDistanceSquared)
+				{
+					bTooClose = true;
+					break;
+				}
+			}
+		}
+
+		if (!bTooClose)
+		{
+			SpatialHash.Add(Cell, OutPoints.Add(Point));
+		}
+	}
+}
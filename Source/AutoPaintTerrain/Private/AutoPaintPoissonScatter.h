@@ -0,0 +1,20 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Poisson-disk dart throwing: uniform candidates are tested in order and kept when no kept point is closer than
+ * the minimum distance. Kept points are found in a spatial hash of cells small enough to hold a single point,
+ * so each candidate only looks at the 21 cells around it and the cost stays linear in the number of candidates.
+ */
+struct FAutoPaintPoissonScatter
+{
+	/**
+	 * Appends to OutPoints the kept candidates of InRegion, at least InMinDistance apart. Candidates rejected by
+	 * InFilter are dropped before the distance test. The same seed gives the same points.
+	 */
+	static void Sample(const FBox2D& InRegion, double InMinDistance, int32 InNumCandidates, int32 InSeed,
+		TFunctionRef<bool(const FVector2D&)> InFilter, TArray<FVector2D>& OutPoints);
+};
@@ -0,0 +1,189 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintScatterLandscapePatchComponent.h"
+
+#include "AutoPaintPoissonScatter.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "AutoPaintStats.h"
+#include "AutoPaintData.h"
+#include "Landscape.h"
+#include "LandscapeInfo.h"
+#include "LandscapeEdit.h"
+#include "LandscapeDataAccess.h"
+#include "Algo/BinarySearch.h"
+#include "Math/RandomStream.h"
+
+DECLARE_CYCLE_STAT(TEXT("Scatter Patches"), STAT_AutoPaint_ScatterPatches, STATGROUP_AutoPaint);
+
+namespace AutoPaintScatter
+{
+	/** Landscape heights and exclusion weights of the scattered region, read once instead of per candidate */
+	struct FRegionData
+	{
+		/** Inclusive landscape vertex coordinates */
+		FIntRect Region;
+		int32 Stride = 0;
+		TArray<uint16> Heights;
+		TArray<uint8> Exclusion;
+
+		float GetLocalHeight(int32 X, int32 Y) const
+		{
+			X = FMath::Clamp(X, Region.Min.X, Region.Max.X) - Region.Min.X;
+			Y = FMath::Clamp(Y, Region.Min.Y, Region.Max.Y) - Region.Min.Y;
+			return LandscapeDataAccess::GetLocalHeight(Heights[Y * Stride + X]);
+		}
+
+		/** Bilinear between the vertices around the landscape space position */
+		float GetLocalHeight(const FVector2D& LocalPosition) const
+		{
+			const int32 X = FMath::FloorToInt(LocalPosition.X);
+			const int32 Y = FMath::FloorToInt(LocalPosition.Y);
+			const float FracX = static_cast<float>(LocalPosition.X - X);
+			const float FracY = static_cast<float>(LocalPosition.Y - Y);
+			return FMath::BiLerp(GetLocalHeight(X, Y), GetLocalHeight(X + 1, Y), GetLocalHeight(X, Y + 1), GetLocalHeight(X + 1, Y + 1), FracX, FracY);
+		}
+	};
+}
+
+void UAutoPaintScatterLandscapePatchComponent::Scatter()
+{
+	using namespace AutoPaintScatter;
+
+	SCOPE_CYCLE_COUNTER(STAT_AutoPaint_ScatterPatches);
+	const double StartTime = FPlatformTime::Seconds();
+
+	ULandscapeInfo* LandscapeInfo = Landscape.IsValid() ? Landscape->GetLandscapeInfo() : nullptr;
+	int32 LandscapeMinX, LandscapeMinY, LandscapeMaxX, LandscapeMaxY;
+	if (!LandscapeInfo || !LandscapeInfo->GetLandscapeExtent(LandscapeMinX, LandscapeMinY, LandscapeMaxX, LandscapeMaxY))
+	{
+		UE_LOG(LogAutoPaintTerrain, Warning, TEXT("%s: no landscape to scatter on"), *GetPathName());
+		return;
+	}
+
+	TArray<const FAutoPaintScatterEntry*> Entries;
+	TArray<double> CumulativeWeights;
+	double TotalWeight = 0;
+	for (const FAutoPaintScatterEntry& Entry : ScatterAssets)
+	{
+		if (Entry.Weight > 0 && !Entry.Asset.IsNull())
+		{
+			TotalWeight += Entry.Weight;
+			Entries.Add(&Entry);
+			CumulativeWeights.Add(TotalWeight);
+		}
+	}
+	if (Entries.IsEmpty())
+	{
+		UE_LOG(LogAutoPaintTerrain, Warning, TEXT("%s: no scatter asset with a weight"), *GetPathName());
+		return;
+	}
+
+	// Sampled in landscape space scaled to world units, so the minimum distance holds with any landscape scale
+	const FTransform LandscapeToWorld = Landscape->LandscapeActorToWorld();
+	const FVector LandscapeScale = LandscapeToWorld.GetScale3D();
+	const FVector2D LandscapeScale2D(LandscapeScale.X, LandscapeScale.Y);
+	const FVector2D LocalCenter = FVector2D(LandscapeToWorld.InverseTransformPosition(GetComponentLocation()));
+	const FVector2D LocalExtent = ScatterExtent / LandscapeScale2D;
+
+	FRegionData RegionData;
+	RegionData.Region = FIntRect(
+		FMath::Max(FMath::FloorToInt(LocalCenter.X - LocalExtent.X), LandscapeMinX),
+		FMath::Max(FMath::FloorToInt(LocalCenter.Y - LocalExtent.Y), LandscapeMinY),
+		FMath::Min(FMath::CeilToInt(LocalCenter.X + LocalExtent.X), LandscapeMaxX),
+		FMath::Min(FMath::CeilToInt(LocalCenter.Y + LocalExtent.Y), LandscapeMaxY));
+	const FIntRect& Region = RegionData.Region;
+	if (Region.Max.X <= Region.Min.X || Region.Max.Y <= Region.Min.Y)
+	{
+		UE_LOG(LogAutoPaintTerrain, Warning, TEXT("%s: the scatter region is outside of the landscape"), *GetPathName());
+		return;
+	}
+
+	RegionData.Stride = Region.Width() + 1;
+	const int32 NumVertices = RegionData.Stride * (Region.Height() + 1);
+	{
+		FLandscapeEditDataInterface LandscapeEdit(LandscapeInfo);
+
+		// Holes in the landscape are left at mid height
+		RegionData.Heights.Init(LandscapeDataAccess::MidValue, NumVertices);
+		LandscapeEdit.GetHeightDataFast(Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y, RegionData.Heights.GetData(), 0);
+
+		RegionData.Exclusion.Init(0, NumVertices);
+		TArray<uint8> LayerWeights;
+		for (const FName& LayerName : ExclusionLayers)
+		{
+			ULandscapeLayerInfoObject* LayerInfo = LandscapeInfo->GetLayerInfoByName(LayerName);
+			if (!LayerInfo)
+			{
+				UE_LOG(LogAutoPaintTerrain, Warning, TEXT("%s: exclusion layer %s isn't painted on the landscape"), *GetPathName(), *LayerName.ToString());
+				continue;
+			}
+
+			LayerWeights.Init(0, NumVertices);
+			LandscapeEdit.GetWeightDataFast(LayerInfo, Region.Min.X, Region.Min.Y, Region.Max.X, Region.Max.Y, LayerWeights.GetData(), 0);
+			for (int32 Index = 0; Index < NumVertices; ++Index)
+			{
+				RegionData.Exclusion[Index] = FMath::Max(RegionData.Exclusion[Index], LayerWeights[Index]);
+			}
+		}
+	}
+
+	const uint8 ExclusionLimit = static_cast<uint8>(FMath::Clamp(FMath::RoundToInt(ExclusionThreshold * 255.f), 0, 255));
+	const bool bTestSlope = MaxSlope < 90.f;
+	const double MaxSlopeTangentSquared = FMath::Square(FMath::Tan(FMath::DegreesToRadians(static_cast<double>(MaxSlope))));
+
+	auto IsValidOrigin = [&](const FVector2D& ScaledPosition)
+	{
+		const FVector2D LocalPosition = ScaledPosition / LandscapeScale2D;
+		const int32 X = FMath::Clamp(FMath::RoundToInt(LocalPosition.X), Region.Min.X, Region.Max.X);
+		const int32 Y = FMath::Clamp(FMath::RoundToInt(LocalPosition.Y), Region.Min.Y, Region.Max.Y);
+		if (RegionData.Exclusion[(Y - Region.Min.Y) * RegionData.Stride + X - Region.Min.X] > ExclusionLimit)
+		{
+			return false;
+		}
+		if (!bTestSlope)
+		{
+			return true;
+		}
+
+		// Central differences on the nearest vertex, compared as tangents to stay clear of trigonometry per candidate
+		const double SlopeX = (RegionData.GetLocalHeight(X + 1, Y) - RegionData.GetLocalHeight(X - 1, Y)) * LandscapeScale.Z / (2 * LandscapeScale.X);
+		const double SlopeY = (RegionData.GetLocalHeight(X, Y + 1) - RegionData.GetLocalHeight(X, Y - 1)) * LandscapeScale.Z / (2 * LandscapeScale.Y);
+		return SlopeX * SlopeX + SlopeY * SlopeY <= MaxSlopeTangentSquared;
+	};
+
+	const FBox2D ScaledRegion(FVector2D(Region.Min) * LandscapeScale2D, FVector2D(Region.Max) * LandscapeScale2D);
+	TArray<FVector2D> Points;
+	FAutoPaintPoissonScatter::Sample(ScaledRegion, MinDistance, NumCandidates, Seed, IsValidOrigin, Points);
+
+	// Separate stream, the asset picks don't shift the candidates when entries change
+	FRandomStream RandomStream(static_cast<int32>(HashCombine(GetTypeHash(Seed), GetTypeHash(NumCandidates))));
+	const FTransform ComponentToWorld = GetComponentTransform();
+	const FQuat LandscapeRotation = LandscapeToWorld.GetRotation();
+
+	TArray<FAutoPaintPatchStamp> NewStamps;
+	NewStamps.Reserve(Points.Num());
+	for (const FVector2D& ScaledPosition : Points)
+	{
+		const int32 EntryIndex = FMath::Min(Algo::UpperBound(CumulativeWeights, RandomStream.GetFraction() * TotalWeight), Entries.Num() - 1);
+		const FAutoPaintScatterEntry& Entry = *Entries[EntryIndex];
+
+		const FVector2D LocalPosition = ScaledPosition / LandscapeScale2D;
+		const FVector WorldPosition = LandscapeToWorld.TransformPosition(FVector(LocalPosition, RegionData.GetLocalHeight(LocalPosition)));
+		const FQuat Rotation = LandscapeRotation * FQuat(FVector::UpVector, bRandomYaw ? RandomStream.FRandRange(0, UE_DOUBLE_TWO_PI) : 0);
+		const double Scale = RandomStream.FRandRange(Entry.ScaleRange.X, Entry.ScaleRange.Y);
+
+		FAutoPaintPatchStamp& Stamp = NewStamps.AddDefaulted_GetRef();
+		Stamp.Asset = Entry.Asset;
+		Stamp.Priority = Entry.Priority;
+		Stamp.Transform = FTransform(Rotation, WorldPosition, FVector(Scale)).GetRelativeTransform(ComponentToWorld);
+	}
+
+	Modify();
+	Stamps = MoveTemp(NewStamps);
+	LoadStampAssets();
+	RequestLandscapeUpdate();
+
+	UE_LOG(LogAutoPaintTerrain, Display, TEXT("%s: scattered %d stamps from %d candidates in %.2f ms"),
+		*GetPathName(), Stamps.Num(), NumCandidates, (FPlatformTime::Seconds() - StartTime) * 1000.0);
+}
@@ -0,0 +1,122 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintShapeLandscapePatchComponent.h"
+
+#include "AutoPaintPatchCostTracker.h"
+#include "LandscapePatchManager.h"
+#include "LandscapeDataAccess.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+UTextureRenderTarget2D* UAutoPaintShapeLandscapePatchComponent::ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult)
+{
+	const FVector3d Location = GetPatchToWorldTransform().GetTranslation();
+	const FVector3d OriginInHeightmapCoords = PatchManager->GetHeightmapCoordsToWorld().InverseTransformPosition(Location);
+	return ApplyShape(InCombinedResult, /*bInWeightmap = */false, BlendMode, OriginInHeightmapCoords.Z - LandscapeDataAccess::MidValue);
+}
+
+UTextureRenderTarget2D* UAutoPaintShapeLandscapePatchComponent::ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName)
+{
+	return ApplyShape(InCombinedResult, /*bInWeightmap = */true, BlendMode, Weight);
+}
+
+UTextureRenderTarget2D* UAutoPaintShapeLandscapePatchComponent::ApplyToVisibility(UTextureRenderTarget2D* InCombinedResult)
+{
+	// Never fills holes cut by something else
+	return ApplyShape(InCombinedResult, /*bInWeightmap = */true, EAutoPaintShapeBlendMode::Max, 1.f);
+}
+
+UTextureRenderTarget2D* UAutoPaintShapeLandscapePatchComponent::ApplyShape(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, EAutoPaintShapeBlendMode InBlendMode, float InValue)
+{
+	FAutoPaintShapePatchDispatchParams Params;
+	Params.CombinedResult = InCombinedResult->GetResource();
+	Params.bWeightmap = bInWeightmap;
+	Params.Shape = static_cast<EAutoPaintShapePatchType>(Shape);
+	Params.BlendMode = static_cast<EAutoPaintShapePatchBlendMode>(InBlendMode);
+	Params.Extents = GetShapeExtents();
+	Params.Falloff = Falloff;
+	Params.Value = InValue;
+
+	const FTransform PatchToWorld = GetPatchToWorldTransform();
+	const FTransform LandscapeHeightmapToWorld = PatchManager->GetHeightmapCoordsToWorld();
+
+	// Transposed for the shader, see GetCommonShaderParams
+	const FMatrix44d HeightmapToShapeTransposed = LandscapeHeightmapToWorld.ToMatrixWithScale() * PatchToWorld.ToInverseMatrixWithScale();
+	Params.HeightmapToShape = (FMatrix44f)HeightmapToShapeTransposed.GetTransposed();
+
+	// Only the pixels inside the shape box and its falloff are touched
+	const FVector2f HalfSize = FAutoPaintShapePatchGPUInterface::GetShapeHalfSize(Params.Shape, Params.Extents, Params.Falloff);
+	FBox2D FloatBounds(ForceInit);
+	for (const FVector2f& Corner : { FVector2f(-1.f, -1.f), FVector2f(-1.f, 1.f), FVector2f(1.f, -1.f), FVector2f(1.f, 1.f) })
+	{
+		const FVector WorldPosition = PatchToWorld.TransformPosition(FVector(Corner.X * HalfSize.X, Corner.Y * HalfSize.Y, 0));
+		FloatBounds += FVector2D(LandscapeHeightmapToWorld.InverseTransformPosition(WorldPosition));
+	}
+
+	const FIntPoint DestinationResolution(InCombinedResult->SizeX, InCombinedResult->SizeY);
+	Params.DestinationBounds = FIntRect(
+		FMath::Clamp(FMath::FloorToInt(FloatBounds.Min.X), 0, DestinationResolution.X - 1),
+		FMath::Clamp(FMath::FloorToInt(FloatBounds.Min.Y), 0, DestinationResolution.Y - 1),
+		FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.X) + 1, 0, DestinationResolution.X),
+		FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.Y) + 1, 0, DestinationResolution.Y));
+	if (Params.DestinationBounds.IsEmpty())
+	{
+		return InCombinedResult;
+	}
+
+	FAutoPaintPatchCostTracker::Get().AddPixels(this, Params.DestinationBounds.Area());
+
+	FAutoPaintShapePatchGPUInterface::Dispatch(Params);
+
+	return InCombinedResult;
+}
+
+FVector2f UAutoPaintShapeLandscapePatchComponent::GetShapeExtents() const
+{
+	switch (Shape)
+	{
+	case EAutoPaintPatchShape::Rectangle:
+		return FVector2f(Size * 0.5);
+	case EAutoPaintPatchShape::Capsule:
+		return FVector2f(Length * 0.5f, Radius);
+	case EAutoPaintPatchShape::Ring:
+		return FVector2f(FMath::Min(InnerRadius, Radius), Radius);
+	case EAutoPaintPatchShape::Circle:
+	default:
+		return FVector2f(Radius, 0.f);
+	}
+}
+
+FTransform UAutoPaintShapeLandscapePatchComponent::GetPatchToWorldTransform() const
+{
+	return AlignPatchToLandscape(GetComponentTransform(), /*InAsset = */nullptr);
+}
+
+FVector2D UAutoPaintShapeLandscapePatchComponent::GetFullUnscaledWorldSize() const
+{
+	const FVector2f HalfSize = FAutoPaintShapePatchGPUInterface::GetShapeHalfSize(
+		static_cast<EAutoPaintShapePatchType>(Shape), GetShapeExtents(), /*InFalloff = */0.f);
+	return FVector2D(HalfSize * 2.f);
+}
+
+uint32 UAutoPaintShapeLandscapePatchComponent::GetUpdateInputHash() const
+{
+	uint32 Hash = Super::GetUpdateInputHash();
+	Hash = HashCombine(Hash, GetTypeHash(Shape));
+	Hash = HashCombine(Hash, GetTypeHash(Radius));
+	Hash = HashCombine(Hash, GetTypeHash(InnerRadius));
+	Hash = HashCombine(Hash, GetTypeHash(Length));
+	Hash = HashCombine(Hash, GetTypeHash(Size));
+	Hash = HashCombine(Hash, GetTypeHash(Falloff));
+	Hash = HashCombine(Hash, GetTypeHash(BlendMode));
+	Hash = HashCombine(Hash, GetTypeHash(Weight));
+	Hash = HashCombine(Hash, GetTypeHash(bAffectVisibility));
+	return Hash;
+}
+
+FBox UAutoPaintShapeLandscapePatchComponent::GetPatchWorldBounds() const
+{
+	const FVector2f HalfSize = FAutoPaintShapePatchGPUInterface::GetShapeHalfSize(
+		static_cast<EAutoPaintShapePatchType>(Shape), GetShapeExtents(), Falloff);
+	return FBox(FVector(-HalfSize.X, -HalfSize.Y, 0), FVector(HalfSize.X, HalfSize.Y, 0)).TransformBy(GetPatchToWorldTransform());
+}
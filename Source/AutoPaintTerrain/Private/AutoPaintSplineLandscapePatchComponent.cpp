@@ -0,0 +1,170 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "AutoPaintSplineLandscapePatchComponent.h"
+
+#include "AutoPaintSplinePatchPS.h"
+#include "AutoPaintPatchCostTracker.h"
+#include "AutoPaintStats.h"
+#include "LandscapePatchManager.h"
+#include "LandscapeDataAccess.h"
+#include "AutoPaintData.h"
+#include "Landscape.h"
+#include "Components/SplineComponent.h"
+#include "Engine/Texture.h"
+#include "Engine/TextureRenderTarget2D.h"
+
+DECLARE_CYCLE_STAT(TEXT("Get Spline Shader Params"), STAT_AutoPaint_GetSplineShaderParams, STATGROUP_AutoPaint);
+
+UTextureRenderTarget2D* UAutoPaintSplineLandscapePatchComponent::ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult)
+{
+	return ApplySpline(InCombinedResult, /*bInWeightmap = */false);
+}
+
+UTextureRenderTarget2D* UAutoPaintSplineLandscapePatchComponent::ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName)
+{
+	return ApplySpline(InCombinedResult, /*bInWeightmap = */true);
+}
+
+UTextureRenderTarget2D* UAutoPaintSplineLandscapePatchComponent::ApplySpline(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap)
+{
+	FAutoPaintSplinePatchDispatchParams Params;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_AutoPaint_GetSplineShaderParams);
+
+		const UAutoPaintData* LoadedAsset = Asset.Get();
+		FIntPoint SourceResolution;
+		if (!LoadedAsset || LoadedAsset->HasTextureTiles() || !GetPatchSourceResolution(SourceResolution))
+		{
+			return InCombinedResult;
+		}
+
+		TArray<FVector> WorldPoints;
+		if (!GetSplineWorldPoints(WorldPoints))
+		{
+			return InCombinedResult;
+		}
+
+		const FTransform HeightmapCoordsToWorld = PatchManager->GetHeightmapCoordsToWorld();
+		const FVector2D HeightmapToWorldScale = FVector2D(HeightmapCoordsToWorld.GetScale3D());
+		const FVector2D ProfileWorldDimensions = GetProfileWorldDimensions();
+		const FVector2D Reach = FVector2D(0.5 * ProfileWorldDimensions.X) / HeightmapToWorldScale;
+
+		Params.CombinedResult = InCombinedResult->GetResource();
+		Params.ProfileTexture = LoadedAsset->TextureAsset->GetResource();
+		Params.bWeightmap = bInWeightmap;
+		Params.HeightmapToWorldScale = FVector2f(HeightmapToWorldScale);
+		Params.ProfileWorldDimensions = FVector2f(ProfileWorldDimensions);
+		Params.EdgeUVDeadBorder = FVector2f(0.5f / SourceResolution.X, 0.5f / SourceResolution.Y);
+		Params.FalloffWorldMargin = LoadedAsset->Falloff;
+		Params.bShapeFalloff = LoadedAsset->UsesShapeFalloff();
+
+		// Same height scale as the texture patch, the spline height takes the place of the patch origin
+		double LandscapeHeightScale = Landscape.IsValid() ? Landscape->GetTransform().GetScale3D().Z : 1;
+		LandscapeHeightScale = LandscapeHeightScale == 0 ? 1 : LandscapeHeightScale;
+		Params.HeightScale = LANDSCAPE_INV_ZSCALE / LandscapeHeightScale * LoadedAsset->HeightWPO * GetComponentTransform().GetScale3D().Z;
+		Params.ZeroInEncoding = 0;
+
+		FVector3d Previous = HeightmapCoordsToWorld.InverseTransformPosition(WorldPoints[0]);
+		FBox2D FloatBounds(ForceInit);
+		FloatBounds += FVector2D(Previous);
+		Params.Segments.Reserve(WorldPoints.Num() - 1);
+		for (int32 Index = 1; Index < WorldPoints.Num(); ++Index)
+		{
+			const FVector3d Current = HeightmapCoordsToWorld.InverseTransformPosition(WorldPoints[Index]);
+
+			FAutoPaintSplineSegment& Segment = Params.Segments.AddDefaulted_GetRef();
+			Segment.Start = FVector2f(FVector2D(Previous) * HeightmapToWorldScale);
+			Segment.End = FVector2f(FVector2D(Current) * HeightmapToWorldScale);
+			Segment.StartHeight = static_cast<float>(Previous.Z);
+			Segment.EndHeight = static_cast<float>(Current.Z);
+
+			FloatBounds += FVector2D(Current);
+			Previous = Current;
+		}
+		FloatBounds = FBox2D(FloatBounds.Min - Reach, FloatBounds.Max + Reach);
+
+		const FIntPoint DestinationResolution(InCombinedResult->SizeX, InCombinedResult->SizeY);
+		Params.DestinationBounds = FIntRect(
+			FMath::Clamp(FMath::FloorToInt(FloatBounds.Min.X), 0, DestinationResolution.X - 1),
+			FMath::Clamp(FMath::FloorToInt(FloatBounds.Min.Y), 0, DestinationResolution.Y - 1),
+			FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.X) + 1, 0, DestinationResolution.X),
+			FMath::Clamp(FMath::CeilToInt(FloatBounds.Max.Y) + 1, 0, DestinationResolution.Y));
+	}
+
+	if (Params.DestinationBounds.IsEmpty() || !Params.ProfileTexture)
+	{
+		return InCombinedResult;
+	}
+
+	FAutoPaintPatchCostTracker::Get().AddPixels(this, Params.DestinationBounds.Area());
+
+	FAutoPaintSplinePatchGPUInterface::Dispatch(Params);
+
+	return InCombinedResult;
+}
+
+USplineComponent* UAutoPaintSplineLandscapePatchComponent::GetSplineComponent() const
+{
+	AActor* Owner = GetOwner();
+	if (!Owner)
+	{
+		return nullptr;
+	}
+
+	if (USplineComponent* Referenced = Cast<USplineComponent>(Spline.GetComponent(Owner)))
+	{
+		return Referenced;
+	}
+	return Owner->FindComponentByClass<USplineComponent>();
+}
+
+bool UAutoPaintSplineLandscapePatchComponent::GetSplineWorldPoints(TArray<FVector>& OutPoints) const
+{
+	const USplineComponent* SplineComponent = GetSplineComponent();
+	if (!SplineComponent || SplineComponent->GetNumberOfSplinePoints() < 2)
+	{
+		return false;
+	}
+
+	const float SplineLength = SplineComponent->GetSplineLength();
+	const int32 NumSegments = FMath::Max(FMath::CeilToInt(SplineLength / FMath::Max(SegmentLength, 1.f)), 1);
+
+	OutPoints.Reset(NumSegments + 1);
+	for (int32 Index = 0; Index <= NumSegments; ++Index)
+	{
+		OutPoints.Add(SplineComponent->GetLocationAtDistanceAlongSpline(SplineLength * Index / NumSegments, ESplineCoordinateSpace::World));
+	}
+	return true;
+}
+
+FVector2D UAutoPaintSplineLandscapePatchComponent::GetProfileWorldDimensions() const
+{
+	return GetAssetUnscaledWorldSize(Asset.Get()) * FVector2D(GetComponentTransform().GetScale3D());
+}
+
+uint32 UAutoPaintSplineLandscapePatchComponent::GetUpdateInputHash() const
+{
+	uint32 Hash = Super::GetUpdateInputHash();
+	Hash = HashCombine(Hash, GetTypeHash(SegmentLength));
+
+	TArray<FVector> WorldPoints;
+	if (GetSplineWorldPoints(WorldPoints))
+	{
+		Hash = FCrc::MemCrc32(WorldPoints.GetData(), WorldPoints.Num() * WorldPoints.GetTypeSize(), Hash);
+	}
+	return Hash;
+}
+
+FBox UAutoPaintSplineLandscapePatchComponent::GetPatchWorldBounds() const
+{
+	TArray<FVector> WorldPoints;
+	if (!Asset.Get() || !GetSplineWorldPoints(WorldPoints))
+	{
+		return FBox(ForceInit);
+	}
+
+	const FVector Reach(0.5 * GetProfileWorldDimensions().X, 0.5 * GetProfileWorldDimensions().X, 0);
+	const FBox PointBounds(WorldPoints);
+	return FBox(PointBounds.Min - Reach, PointBounds.Max + Reach);
+}
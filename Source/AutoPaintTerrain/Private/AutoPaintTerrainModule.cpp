@@ -1,15 +1,24 @@
 ﻿#include "AutoPaintTerrainModule.h"
 
+#include "AutoPaintLandscapeUpdateScheduler.h"
+#include "AutoPaintMemory.h"
+#include "AutoPaintPatchCompositeCache.h"
+#include "AutoPaintPatchCostTracker.h"
+
 #define LOCTEXT_NAMESPACE "FAutoPaintTerrainModule"
 
 void FAutoPaintTerrainModule::StartupModule()
 {
-    
+    GatherMemoryHandle = AutoPaintMemory::OnGather().AddStatic(&FAutoPaintPatchCompositeCache::GatherMemory);
 }
 
 void FAutoPaintTerrainModule::ShutdownModule()
 {
-    
+    AutoPaintMemory::OnGather().Remove(GatherMemoryHandle);
+
+    FAutoPaintLandscapeUpdateScheduler::Shutdown();
+    FAutoPaintPatchCompositeCache::Shutdown();
+    FAutoPaintPatchCostTracker::Shutdown();
 }
 
 #undef LOCTEXT_NAMESPACE
@@ -0,0 +1,87 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintInstancedLandscapePatchComponent.generated.h"
+
+struct FAutoPaintInstancedTexturePatchSource;
+struct FAutoPaintTexturePatchInstance;
+
+/** Patch of any asset, applied in the same pass as the component instances */
+USTRUCT(BlueprintType)
+struct AUTOPAINTTERRAIN_API FAutoPaintPatchStamp
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	TSoftObjectPtr<UAutoPaintData> Asset = nullptr;
+
+	/** Relative to the component */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (MakeEditWidget))
+	FTransform Transform;
+
+	/** Higher priority is applied later, over lower ones. Instances of the component asset have priority 0. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	int32 Priority = 0;
+};
+
+/**
+ * Stamps one AutoPaintData at many transforms, plus stamps of other assets. All instances are evaluated in
+ * one CPU loop and applied in a single pass against one snapshot of the landscape, instead of one patch
+ * component per stamp. Patch textures are sampled from a shared texture array atlas, so different assets
+ * can share the pass. Tiled assets are not supported, only TextureAsset is used, so section layer masks aren't painted.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup = Landscape, meta=(BlueprintSpawnableComponent))
+class AUTOPAINTTERRAIN_API UAutoPaintInstancedLandscapePatchComponent : public UAutoPaintLandscapePatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Relative to the component, yaw is aligned to the landscape like a single patch */
+	UPROPERTY(EditAnywhere, Category = AutoPaint, meta = (MakeEditWidget))
+	TArray<FTransform> Instances;
+
+	UPROPERTY(EditAnywhere, Category = AutoPaint)
+	TArray<FAutoPaintPatchStamp> Stamps;
+
+	/** Loads the assets of Stamps, only stamps whose asset is loaded are applied. Call after changing Stamps from code. */
+	void LoadStampAssets();
+
+	//~ Begin UActorComponent Interface
+	virtual void OnRegister() override;
+	//~ End UActorComponent Interface
+
+#if WITH_EDITOR
+	//~ Begin UObject Interface
+	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
+	//~ End UObject Interface
+#endif
+
+	/** Instances are already applied in a single pass */
+	virtual bool CanPrecomposite() const override { return false; }
+
+	virtual uint32 GetUpdateInputHash() const override;
+
+	/** Union of all instances and stamps */
+	virtual FBox GetPatchWorldBounds() const override;
+
+protected:
+	virtual UTextureRenderTarget2D* ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult) override;
+	virtual UTextureRenderTarget2D* ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName) override;
+
+	UTextureRenderTarget2D* ApplyInstances(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, const FName& InLayerName = NAME_None);
+
+	/**
+	 * Patch sources of all used assets, then heightmap to patch transforms, destination bounds and
+	 * height params of every instance in priority order.
+	 */
+	void GetInstanceShaderParams(const FIntPoint& DestinationResolutionIn, bool bInWeightmap,
+		TArray<FAutoPaintInstancedTexturePatchSource>& PatchesOut, TArray<FAutoPaintTexturePatchInstance>& InstancesOut) const;
+
+private:
+	/** Keeps the assets of Stamps loaded, so rendering never loads packages */
+	UPROPERTY(Transient)
+	TArray<TObjectPtr<UAutoPaintData>> StampAssets;
+};
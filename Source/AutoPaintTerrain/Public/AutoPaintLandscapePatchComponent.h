@@ -4,9 +4,50 @@
 
 #include "CoreMinimal.h"
 #include "LandscapePatchComponent.h"
+#include "AutoPaintTexturePatchPS.h"
 #include "AutoPaintLandscapePatchComponent.generated.h"
 
 class UAutoPaintData;
+struct FStreamableHandle;
+
+/**
+ * Paints an AffectWeightmap layer where the patch surface is steep or curved, instead of from the patch heights.
+ * Full weight inside [Min, Max], fading out over Transition past either end. Needs a capture saved with derivatives.
+ */
+USTRUCT(BlueprintType)
+struct AUTOPAINTTERRAIN_API FAutoPaintDerivedWeightmap
+{
+	GENERATED_BODY()
+
+	/** Layer of AffectWeightmap */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	FName LayerName;
+
+	/** Degrees */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (ClampMin = "0", ClampMax = "90", Units = "Degrees"))
+	float MinSlope = 30.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (ClampMin = "0", ClampMax = "90", Units = "Degrees"))
+	float MaxSlope = 90.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (ClampMin = "0", Units = "Degrees"))
+	float SlopeTransition = 5.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	bool bUseCurvature = false;
+
+	/** 1/m, positive on ridges and negative in gullies */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (EditCondition = "bUseCurvature"))
+	float MinCurvature = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (EditCondition = "bUseCurvature"))
+	float MaxCurvature = 1.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (ClampMin = "0", EditCondition = "bUseCurvature"))
+	float CurvatureTransition = 0.1f;
+
+	FAutoPaintDerivedWeightParams ToParams() const;
+};
 
 UCLASS(Blueprintable, BlueprintType, ClassGroup = Landscape, meta=(BlueprintSpawnableComponent))
 class AUTOPAINTTERRAIN_API UAutoPaintLandscapePatchComponent : public ULandscapePatchComponent
@@ -19,25 +60,34 @@ public:
 	UPROPERTY(EditAnywhere, Category = AutoPaint)
 	TSoftObjectPtr<UAutoPaintData> Asset = nullptr;
 
-	// DEBUG ONLY
-	// UPROPERTY(EditAnywhere, Category = AutoPaint)
-	// float Radius = 500;
-	//
-	// /** Distance across which the alpha will go from 1 down to 0 outside of circle. */
-	// UPROPERTY(EditAnywhere, Category = AutoPaint)
-	// float Falloff = 500;
-	//
-	// /** When true, only the vertices in the circle have alpha 1. If false, the radius is expanded slightly so that neighboring 
-	//   vertices are also included and the whole circle is able to lie flat. */
-	// UPROPERTY(EditAnywhere, Category = AutoPaint, AdvancedDisplay)
-	// bool bExclusiveRadius = false;
-
 	UPROPERTY(EditAnywhere, Category = AutoPaint)
 	bool bAffectHeightmap = true;
 
+	/**
+	 * Layers painted from the patch heights. Section layers of the asset paint their captured mask instead,
+	 * and DerivedWeightmaps their slope and curvature range.
+	 */
 	UPROPERTY(EditAnywhere, Category = AutoPaint)
 	TArray<FName> AffectWeightmap;
 
+	/** AffectWeightmap layers painted from the patch slope and curvature */
+	UPROPERTY(EditAnywhere, Category = AutoPaint)
+	TArray<FAutoPaintDerivedWeightmap> DerivedWeightmaps;
+
+	/**
+	 * Tiles of a tiled patch kept loaded between applies, least recently used are released first.
+	 * Tiles needed by the current apply are always kept, so memory follows the region being recomposed.
+	 */
+	UPROPERTY(EditAnywhere, Category = AutoPaint, AdvancedDisplay, meta = (ClampMin = "1"))
+	int32 MaxResidentTiles = 16;
+
+	/**
+	 * Once unchanged for a moment, the heightmap contribution is baked into the landscape precomposite
+	 * together with the other unmoving patches and applied in a single blend. Patches being edited always run on their own.
+	 */
+	UPROPERTY(EditAnywhere, Category = AutoPaint, AdvancedDisplay)
+	bool bAllowPrecomposite = true;
+
 	/**
 	 * Gets the transform from patch to world. The transform is based off of the component
 	 * transform, but with rotation changed to align to the landscape, only using the yaw
@@ -52,13 +102,67 @@ public:
 	 */
 	UFUNCTION(BlueprintCallable, Category = LandscapePatch)
 	virtual FVector2D GetFullUnscaledWorldSize() const;
+
+	virtual bool CanPrecomposite() const { return bAllowPrecomposite && bAffectHeightmap; }
+
+	/**
+	 * Render proxy with the params of every patch texture region applied to the heightmap, no regions when the patch
+	 * doesn't apply. Rebuilt only when the inputs change, the proxy can be dispatched without touching the component.
+	 */
+	FAutoPaintTexturePatchProxyPtr GetHeightmapProxy(UTextureRenderTarget2D* InCombinedResult);
+
+	/** Changes with the texture pixels */
+	static FGuid GetPatchContentId(const UTexture* InTexture);
+
+	//~ Begin ULandscapePatchComponent Interface
+	virtual void RequestLandscapeUpdate(bool bInUserTriggeredUpdate = false) override;
+	//~ End ULandscapePatchComponent Interface
+
+	/** Hash of everything the landscape result depends on: transform, asset and affected layers */
+	virtual uint32 GetUpdateInputHash() const;
+
+	/** Returns true and remembers the inputs when they changed since the last issued update */
+	bool ConsumeUpdateInputChange();
+
+	/**
+	 * Requests the landscape update right away, bypassing FAutoPaintLandscapeUpdateScheduler. Only the landscape components
+	 * intersecting the footprint of the last update or the current one are updated. Once the patch isn't interactive,
+	 * everything the interactive updates covered is updated fully too. User triggered updates go to the whole landscape.
+	 */
+	void IssueLandscapeUpdate(bool bInUserTriggeredUpdate);
+
+	/** World space area the patch can affect, including the falloff. Only XY is meaningful. */
+	virtual FBox GetPatchWorldBounds() const;
+
+	/** Inputs changed less than PreviewIdleSeconds ago, the heightmap is applied as a reduced resolution preview */
+	bool IsInteractive() const;
 	
 protected:
 
 	virtual UTextureRenderTarget2D* RenderLayer_Native(const FLandscapeBrushParameters& InParameters) override;
 
-	UTextureRenderTarget2D* ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult);
-	UTextureRenderTarget2D* ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult);
+	virtual UTextureRenderTarget2D* ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult);
+	virtual UTextureRenderTarget2D* ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName);
+	/** Only called when AffectsVisibilityLayer */
+	virtual UTextureRenderTarget2D* ApplyToVisibility(UTextureRenderTarget2D* InCombinedResult) { return InCombinedResult; }
+
+	/** Derived weight of the layer, disabled unless the layer is in DerivedWeightmaps */
+	FAutoPaintDerivedWeightParams GetDerivedWeightParams(const FName& InLayerName) const;
+
+	/** World height of a stored height of 1 and the planar scale of a patch applied at PatchToWorld */
+	static FVector2f GetDerivedHeightScale(const FTransform& InPatchToWorld, const UAutoPaintData* InAsset);
+
+	/** Offsets by the asset WorldOffset and keeps only the yaw relative to the landscape */
+	FTransform AlignPatchToLandscape(FTransform PatchToWorld, const UAutoPaintData* InAsset) const;
+
+	/** GetFullUnscaledWorldSize for any asset */
+	static FVector2D GetAssetUnscaledWorldSize(const UAutoPaintData* InAsset);
+
+	/** GetPatchWorldBounds of the asset applied at PatchToWorld */
+	static FBox GetAssetWorldBounds(const FTransform& InPatchToWorld, const UAutoPaintData* InAsset);
+
+	/** Combines everything of the asset the landscape result depends on into InHash: texture content, size and render settings */
+	static uint32 HashAssetInputs(const UAutoPaintData* InAsset, uint32 InHash);
 
 	void GetCommonShaderParams(const FIntPoint& SourceResolutionIn, const FIntPoint& DestinationResolutionIn, 
 		FTransform& PatchToWorldOut, FVector2f& PatchWorldDimensionsOut, FMatrix44f& HeightmapToPatchOut, 
@@ -67,4 +171,69 @@ protected:
 	virtual bool AffectsWeightmapLayer(const FName& InLayerName) const override;
 	virtual bool AffectsVisibilityLayer() const override { return false; }
 
+	/** Patch texture and the part of the patch it covers */
+	struct FPatchTextureRegion
+	{
+		UTexture* Texture = nullptr;
+		FVector4f PatchUVToTextureUV = FVector4f(1.f, 1.f, 0.f, 0.f);
+		FVector4f PatchUVBounds = FVector4f(0.f, 0.f, 1.f, 1.f);
+		FIntRect DestinationBounds;
+	};
+
+	/** Resolution of the whole patch, either the single texture or all tiles together */
+	bool GetPatchSourceResolution(FIntPoint& OutResolution) const;
+
+	/**
+	 * Textures to apply over DestinationBounds. For a tiled patch only the intersecting tiles are loaded, asynchronously.
+	 * Tiles that aren't resident yet are left out and the landscape is updated again once they are.
+	 */
+	void GetPatchTextureRegions(const FMatrix44f& InHeightmapToPatch, const FIntRect& InDestinationBounds, TArray<FPatchTextureRegion>& OutRegions);
+
+	/** Null while the tile is loading or building, never blocks */
+	UTexture* GetResidentTile(const TSoftObjectPtr<UTexture>& InTile);
+	void RequestTileLoad(const FSoftObjectPath& InTilePath);
+	void TrimResidentTiles(int32 InNumInUse);
+
+private:
+	/** Returns the cached proxy while its InputHash matches, builds a new one otherwise */
+	FAutoPaintTexturePatchProxyPtr GetPatchProxy(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap);
+	FAutoPaintTexturePatchProxyPtr BuildPatchProxy(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, uint32 InInputHash);
+	/** GetUpdateInputHash plus the landscape state the shader params depend on */
+	uint32 GetPatchProxyInputHash(UTextureRenderTarget2D* InCombinedResult) const;
+
+	/** Not cached for tiled assets, tiles can be evicted between renders */
+	FAutoPaintTexturePatchProxyPtr HeightmapProxy;
+	FAutoPaintTexturePatchProxyPtr WeightmapProxy;
+
+	UPROPERTY(Transient)
+	TMap<FSoftObjectPath, TObjectPtr<UTexture>> ResidentTiles;
+
+	/** GetUpdateInputHash at the last issued landscape update */
+	TOptional<uint32> LastUpdateInputHash;
+	double LastUpdateInputChangeTime = 0.0;
+
+	/** What the last issued landscape update covered, it has to be updated again when the patch moves away */
+	struct FUpdateFootprint
+	{
+		FBox WorldBounds = FBox(ForceInit);
+		bool bHeightmap = false;
+		bool bWeightmap = false;
+
+		FUpdateFootprint& operator+=(const FUpdateFootprint& Other)
+		{
+			WorldBounds += Other.WorldBounds;
+			bHeightmap |= Other.bHeightmap;
+			bWeightmap |= Other.bWeightmap;
+			return *this;
+		}
+	};
+	TOptional<FUpdateFootprint> LastUpdateFootprint;
+	/** Everything interactive updates covered since the last full update, fully updated once the patch stops moving */
+	TOptional<FUpdateFootprint> PendingFullUpdateFootprint;
+
+	/** Least recently used first */
+	TArray<FSoftObjectPath> ResidentTileOrder;
+
+	/** Loaded or loading tiles of this patch. Residency is per patch, tiles are shared assets and never unloaded directly. */
+	TMap<FSoftObjectPath, TSharedPtr<FStreamableHandle>> TileHandles;
 };
\ No newline at end of file
@@ -0,0 +1,78 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintInstancedLandscapePatchComponent.h"
+#include "AutoPaintScatterLandscapePatchComponent.generated.h"
+
+/** Asset picked by the scatter, with its odds and the scale range of its stamps */
+USTRUCT(BlueprintType)
+struct AUTOPAINTTERRAIN_API FAutoPaintScatterEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	TSoftObjectPtr<UAutoPaintData> Asset = nullptr;
+
+	/** Relative to the weights of the other entries */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint, meta = (ClampMin = "0"))
+	float Weight = 1.f;
+
+	/** Uniform scale of the stamps, picked between x and y */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	FVector2D ScaleRange = FVector2D::UnitVector;
+
+	/** See FAutoPaintPatchStamp::Priority */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = AutoPaint)
+	int32 Priority = 0;
+};
+
+/**
+ * Scatters stamps of weighted assets over the landscape around the component with Poisson-disk sampling, so
+ * hundreds of footprints are placed without overlapping and without a component per stamp. Candidates on slopes
+ * steeper than MaxSlope or painted with an exclusion layer are dropped. Scatter replaces Stamps, they can be
+ * edited by hand afterwards like any other stamp and are only regenerated when Scatter is run again.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup = Landscape, meta=(BlueprintSpawnableComponent))
+class AUTOPAINTTERRAIN_API UAutoPaintScatterLandscapePatchComponent : public UAutoPaintInstancedLandscapePatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, Category = Scatter)
+	TArray<FAutoPaintScatterEntry> ScatterAssets;
+
+	/** Half size of the scattered region around the component, along the landscape axes */
+	UPROPERTY(EditAnywhere, Category = Scatter, meta = (Units = "Centimeters"))
+	FVector2D ScatterExtent = FVector2D(5000.0, 5000.0);
+
+	/** Stamp origins are never closer than this */
+	UPROPERTY(EditAnywhere, Category = Scatter, meta = (ClampMin = "1", Units = "Centimeters"))
+	float MinDistance = 500.f;
+
+	/** More candidates fill the region more densely, up to the minimum distance */
+	UPROPERTY(EditAnywhere, Category = Scatter, meta = (ClampMin = "1"))
+	int32 NumCandidates = 100000;
+
+	UPROPERTY(EditAnywhere, Category = Scatter)
+	int32 Seed = 0;
+
+	/** Steepest landscape slope at a stamp origin */
+	UPROPERTY(EditAnywhere, Category = Scatter, meta = (ClampMin = "0", ClampMax = "90", Units = "Degrees"))
+	float MaxSlope = 30.f;
+
+	/** Nothing is scattered where any of these paint layers is above ExclusionThreshold */
+	UPROPERTY(EditAnywhere, Category = Scatter)
+	TArray<FName> ExclusionLayers;
+
+	UPROPERTY(EditAnywhere, Category = Scatter, meta = (ClampMin = "0", ClampMax = "1"))
+	float ExclusionThreshold = 0.5f;
+
+	UPROPERTY(EditAnywhere, Category = Scatter)
+	bool bRandomYaw = true;
+
+	/** Replaces Stamps with a new scatter and updates the landscape */
+	UFUNCTION(CallInEditor, BlueprintCallable, Category = Scatter)
+	void Scatter();
+};
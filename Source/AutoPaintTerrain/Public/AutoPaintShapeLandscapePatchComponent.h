@@ -0,0 +1,102 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintShapePatchPS.h"
+#include "AutoPaintShapeLandscapePatchComponent.generated.h"
+
+/** Same values as EAutoPaintShapePatchType */
+UENUM(BlueprintType)
+enum class EAutoPaintPatchShape : uint8
+{
+	Circle,
+	Rectangle,
+	/** Two half circles joined along the component X axis */
+	Capsule,
+	Ring
+};
+
+/** Same values as EAutoPaintShapePatchBlendMode */
+UENUM(BlueprintType)
+enum class EAutoPaintShapeBlendMode : uint8
+{
+	/** Blends toward the component height or Weight */
+	AlphaBlend,
+	/** Adds the component height above the landscape or Weight */
+	Additive,
+	/** Like AlphaBlend, but only lowers the landscape */
+	Min,
+	/** Like AlphaBlend, but only raises the landscape */
+	Max
+};
+
+/**
+ * Flattens, cuts or paints a circle, rectangle, capsule or ring at the component height. Alpha comes from the
+ * distance to the shape edge, so there is no patch texture and only the pixels inside the shape and its
+ * falloff are read and written. Sizes are in unscaled units, the component scale applies. Asset is not used.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup = Landscape, meta=(BlueprintSpawnableComponent))
+class AUTOPAINTTERRAIN_API UAutoPaintShapeLandscapePatchComponent : public UAutoPaintLandscapePatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape)
+	EAutoPaintPatchShape Shape = EAutoPaintPatchShape::Circle;
+
+	/** Outer radius of a ring */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (ClampMin = "0", EditCondition = "Shape != EAutoPaintPatchShape::Rectangle", EditConditionHides))
+	float Radius = 500.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (ClampMin = "0", EditCondition = "Shape == EAutoPaintPatchShape::Ring", EditConditionHides))
+	float InnerRadius = 250.f;
+
+	/** Distance between the centers of the caps */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (ClampMin = "0", EditCondition = "Shape == EAutoPaintPatchShape::Capsule", EditConditionHides))
+	float Length = 1000.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (EditCondition = "Shape == EAutoPaintPatchShape::Rectangle", EditConditionHides))
+	FVector2D Size = FVector2D(1000.0, 1000.0);
+
+	/** Distance outside of the shape across which the alpha goes from 1 down to 0 */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (ClampMin = "0"))
+	float Falloff = 500.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape)
+	EAutoPaintShapeBlendMode BlendMode = EAutoPaintShapeBlendMode::AlphaBlend;
+
+	/** Painted into the AffectWeightmap layers */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape, meta = (ClampMin = "0", ClampMax = "1"))
+	float Weight = 1.f;
+
+	/** Cuts a landscape hole inside of the shape */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = Shape)
+	bool bAffectVisibility = false;
+
+	/** The shape is cheaper to apply than to precomposite */
+	virtual bool CanPrecomposite() const override { return false; }
+
+	/** Component transform with the yaw aligned to the landscape */
+	virtual FTransform GetPatchToWorldTransform() const override;
+
+	/** Size of the shape, without the falloff */
+	virtual FVector2D GetFullUnscaledWorldSize() const override;
+
+	virtual uint32 GetUpdateInputHash() const override;
+
+	virtual FBox GetPatchWorldBounds() const override;
+
+protected:
+	virtual UTextureRenderTarget2D* ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult) override;
+	virtual UTextureRenderTarget2D* ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName) override;
+	virtual UTextureRenderTarget2D* ApplyToVisibility(UTextureRenderTarget2D* InCombinedResult) override;
+
+	virtual bool AffectsVisibilityLayer() const override { return bAffectVisibility; }
+
+	UTextureRenderTarget2D* ApplyShape(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap, EAutoPaintShapeBlendMode InBlendMode, float InValue);
+
+	/** Extents as expected by FAutoPaintShapePatchDispatchParams */
+	FVector2f GetShapeExtents() const;
+};
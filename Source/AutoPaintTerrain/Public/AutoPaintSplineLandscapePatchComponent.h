@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "AutoPaintLandscapePatchComponent.h"
+#include "AutoPaintSplineLandscapePatchComponent.generated.h"
+
+class USplineComponent;
+
+/**
+ * Sweeps the cross section of Asset along a spline to flatten roads or carve riverbeds. The row through the middle
+ * of the asset texture is the profile, its width spans the spline and its heights are added to the spline height.
+ * The whole spline is applied in one bounded pass however long it is, instead of chaining patches along it.
+ * AffectWeightmap layers are painted from the profile heights, derived weightmaps, section layers and tiled assets
+ * aren't supported. Spline point edits reach the landscape when the owner is rebuilt, or on RequestLandscapeUpdate.
+ */
+UCLASS(Blueprintable, BlueprintType, ClassGroup = Landscape, meta=(BlueprintSpawnableComponent))
+class AUTOPAINTTERRAIN_API UAutoPaintSplineLandscapePatchComponent : public UAutoPaintLandscapePatchComponent
+{
+	GENERATED_BODY()
+
+public:
+	/** Spline component of the owner, the first one when not set */
+	UPROPERTY(EditAnywhere, Category = Spline, meta = (UseComponentPicker, AllowedClasses = "/Script/Engine.SplineComponent"))
+	FComponentReference Spline;
+
+	/** The spline is evaluated as straight segments of about this length */
+	UPROPERTY(EditAnywhere, Category = Spline, meta = (ClampMin = "10", Units = "Centimeters"))
+	float SegmentLength = 200.f;
+
+	/** Segments are already applied in a single pass */
+	virtual bool CanPrecomposite() const override { return false; }
+
+	virtual uint32 GetUpdateInputHash() const override;
+
+	/** Segment bounds widened by half the profile width */
+	virtual FBox GetPatchWorldBounds() const override;
+
+	USplineComponent* GetSplineComponent() const;
+
+protected:
+	virtual UTextureRenderTarget2D* ApplyToHeightmap(UTextureRenderTarget2D* InCombinedResult) override;
+	virtual UTextureRenderTarget2D* ApplyToWeightmap(UTextureRenderTarget2D* InCombinedResult, const FName& InLayerName) override;
+
+	UTextureRenderTarget2D* ApplySpline(UTextureRenderTarget2D* InCombinedResult, bool bInWeightmap);
+
+	/** Ends of the segments in world space, in order along the spline */
+	bool GetSplineWorldPoints(TArray<FVector>& OutPoints) const;
+
+	/** World size of the profile, x across the spline. Scaled by the component scale. */
+	FVector2D GetProfileWorldDimensions() const;
+};
@@ -8,4 +8,7 @@ class FAutoPaintTerrainModule : public IModuleInterface
 public:
     virtual void StartupModule() override;
     virtual void ShutdownModule() override;
+
+protected:
+    FDelegateHandle GatherMemoryHandle;
 };
@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/Object.h"
+
+#include "AutoPaintTerrainSettings.generated.h"
+
+UCLASS(Config = Engine, DefaultConfig)
+class AUTOPAINTTERRAIN_API UAutoPaintTerrainSettings : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Patch changes (e.g. dragging a patch) are collected and turned into at most one landscape update per frame,
+	 * issued only once the previous one finished rendering. Changes that leave the patch inputs unchanged are dropped.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = LandscapeUpdate)
+	bool bCoalesceLandscapeUpdates = true;
+
+	/** Game thread milliseconds per frame spent evaluating pending patch changes, the rest carries over to the next frame */
+	UPROPERTY(EditAnywhere, config, Category = LandscapeUpdate, meta = (EditCondition = "bCoalesceLandscapeUpdates", ClampMin = "0.1", UIMax = "16"))
+	float LandscapeUpdateBudgetMs = 2.f;
+
+	/**
+	 * While a patch keeps changing (e.g. dragged, or its asset falloff edited) its height is evaluated at reduced resolution
+	 * and upsampled. The full resolution result is rendered once the patch was left alone for Preview Idle Seconds.
+	 */
+	UPROPERTY(EditAnywhere, config, Category = LandscapeUpdate, meta = (EditCondition = "bCoalesceLandscapeUpdates"))
+	bool bInteractivePreview = true;
+
+	/** Texels along the longer side of the patch footprint in the preview, independent of the landscape resolution */
+	UPROPERTY(EditAnywhere, config, Category = LandscapeUpdate, meta = (EditCondition = "bCoalesceLandscapeUpdates && bInteractivePreview", ClampMin = "16", UIMax = "2048"))
+	int32 PreviewResolution = 256;
+
+	UPROPERTY(EditAnywhere, config, Category = LandscapeUpdate, meta = (EditCondition = "bCoalesceLandscapeUpdates && bInteractivePreview", ClampMin = "0", UIMax = "2"))
+	float PreviewIdleSeconds = 0.2f;
+};